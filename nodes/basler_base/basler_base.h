@@ -3,13 +3,27 @@
 
 #include <pylon/PylonIncludes.h>
 #include <pylon/BaslerUniversalInstantCamera.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <limits>
+#include <memory>
 #include <string>
+#include <vector>
 #include <yaml-cpp/yaml.h>
 #include "../third_party/zmq.hpp"
-#include "../third_party/msgpack.hpp"
 #include "../utils/logging.h"
 #include "../utils/pylon_utils.h"
-#include "../utils/types.h"
+#include "../utils/frame_header.h"
+#include "../utils/zmq_utils.h"
+#include "../utils/thread_utils.h"
+#include "../utils/string_utils.h"
+#include "../utils/clock_mapper.h"
+#include "../utils/in_flight.h"
+#include "../utils/timer.h"
+#include "frame_buffer_factory.h"
 
 namespace vert {
     
@@ -41,8 +55,9 @@ public:
                 vert::logger->warn("name not provided.");
             }
     
+            std::string addr;
             if (config["port"]) {
-                auto addr = config["port"].as<std::string>();
+                addr = config["port"].as<std::string>();
                 publisher_.connect(addr);
                 vert::logger->info("{} bound to {}", name_, addr);
             } else {
@@ -52,10 +67,74 @@ public:
     
             if (config["user_id"]) {
                 user_id_ = config["user_id"].as<std::string>(); 
+                device_ = vert::intern_device(user_id_);
             } else {
                 vert::logger->critical("Failed to init '{}'. Reason: user_id is empty", name_);
                 return false;
             }
+
+            if (config["meta_encoding"]) {
+                auto encoding = config["meta_encoding"].as<std::string>();
+                if (!vert::meta_encoding_from_string(encoding, meta_encoding_)) {
+                    vert::logger->warn("unknown meta_encoding {}, use default {}", encoding, vert::meta_encoding_to_string(meta_encoding_));
+                }
+            }
+            if (vert::meta_encoding_for(meta_encoding_, addr) != meta_encoding_) {
+                vert::logger->warn("{} port {} leaves the process, meta_encoding set to msgpack", name_, addr);
+                meta_encoding_ = vert::MetaEncoding::Msgpack;
+            }
+
+            if (config["zero_copy"]) {
+                zero_copy_ = config["zero_copy"].as<bool>();
+            } else {
+                vert::logger->warn("zero_copy not provided, use default {}.", zero_copy_);
+            }
+
+            if (config["max_in_flight"]) {
+                max_in_flight_ = std::max(1, config["max_in_flight"].as<int>());
+            } else if (zero_copy_) {
+                vert::logger->warn("max_in_flight not provided, use default {}.", max_in_flight_);
+            }
+
+            if (zero_copy_) {
+                vert::logger->info("{} zero copy enabled, max {} frames in flight", name_, max_in_flight_);
+            }
+
+            if (config["num_buffers"]) {
+                num_buffers_ = std::max(0, config["num_buffers"].as<int>());
+            } else {
+                vert::logger->warn("num_buffers not provided, use pylon default buffers.");
+            }
+
+            if (config["hugepages"]) {
+                hugepages_ = config["hugepages"].as<bool>();
+            }
+
+            if (config["grab_strategy"]) {
+                auto strategy = config["grab_strategy"].as<std::string>();
+                if (!vert::grab_strategy_from_string(strategy, grab_strategy_)) {
+                    vert::logger->critical("Failed to init '{}'. Reason: unknown grab_strategy '{}'", name_, strategy);
+                    return false;
+                }
+            } else {
+                vert::logger->warn("grab_strategy not provided, use default {}.", vert::grab_strategy_to_string(grab_strategy_));
+            }
+
+            if (config["output_queue_size"]) {
+                output_queue_size_ = std::max(1, config["output_queue_size"].as<int>());
+            }
+
+            if (config["log_interval"]) {
+                log_interval_ = static_cast<size_t>(std::max(0, config["log_interval"].as<int>()));
+            }
+
+            if (config["clock_sync_period"]) {
+                clock_sync_period_ = std::chrono::milliseconds(std::max(0, config["clock_sync_period"].as<int>()));
+            }
+
+            if (config["cpu_affinity"]) {
+                cpu_affinity_ = vert::cpus_from_yaml(config["cpu_affinity"]);
+            }
             
         } catch (const YAML::Exception& e) {
             vert::logger->critical("Failed to init '{}'. Reason: {}", name_, e.what());
@@ -65,7 +144,10 @@ public:
             return false; 
         }
     
-        return device_specific_init(config);
+        if (!device_specific_init(config))
+            return false;
+
+        return setup_buffers();
     }
 
     bool is_open() const { return camera_.IsOpen(); }
@@ -73,64 +155,99 @@ public:
 
     void close() {
         stop();
+        if (publisher_) {
+            publisher_.set(zmq::sockopt::linger, 0); // frames not sent yet are released with the socket
+            publisher_.close();
+        }
+        wait_in_flight();
         m_ptrGrabResult.Release();
         camera_.DestroyDevice();
     }
     virtual void start() = 0;
 
-    void stop() {
+    virtual void stop() {
+        stop_clock_sync();
         camera_.StopGrabbing();
+        if (dropped_count_ > 0) {
+            vert::logger->warn("{} dropped {} frames (in flight limit {})", name_, dropped_count_.load(), max_in_flight_);
+        }
+        if (skipped_count_ > 0) {
+            vert::logger->info("{} skipped {} frames ({})", name_, skipped_count_.load(), vert::grab_strategy_to_string(grab_strategy_));
+        }
+        callback_stats_.report(name_, "grab callback");
     }
 
+    size_t dropped_count() const { return dropped_count_.load(); }
+    size_t skipped_count() const { return skipped_count_.load(); }
+    const vert::LatencyStats &callback_stats() const { return callback_stats_; }
+
     virtual void OnImageGrabbed(Pylon::CInstantCamera & _camera, const Pylon::CGrabResultPtr &ptr) override {
+        int64_t grab_ns = vert::steady_now_ns();
+        if (!grab_thread_setup_) {
+            setup_grab_thread();
+        }
         if (!ptr->GrabSucceeded()) {
             error_count_++;
             return; 
         }
-        std::string user_id = camera_.DeviceUserID.GetValue();
+        // Drop before anything is sent, a meta without its image would confuse the adapter
+        if (zero_copy_ && in_flight_->count() >= max_in_flight_) {
+            dropped_count_++;
+            error_count_++;
+            return;
+        }
+
         int64_t frame_id = ptr->GetID();
         uint32_t width = ptr->GetWidth();
         uint32_t height = ptr->GetHeight();
         Pylon::EPixelType pixel_type = ptr->GetPixelType();
         uint64_t timestamp = ptr->GetTimeStamp();
         size_t bufsize = ptr->GetBufferSize();
-        
-        vert::logger->debug("Grab from Device: '{}' ID: {} Size: {}x{} Type: {} Timestamp: {}",
-            user_id, frame_id, width, height, vert::pixel_type_to_string(pixel_type), timestamp);
-            
-        // Send meta
-        auto meta_data = msgpack::pack(vert::GrabMeta{user_id,
-                                                      frame_id,
-                                                      height,
-                                                      width,
-                                                      (int)pixel_type,
-                                                      timestamp,
-                                                      error_count_,
-                                                      ptr->GetPaddingX(),
-                                                      bufsize});
-    
-        zmq::message_t meta_msg(meta_data.data(), meta_data.size());
-        publisher_.send(meta_msg, zmq::send_flags::sndmore);
-    
-    
-        // Send image
+
+        // sampled, the grab thread should go back to pylon as fast as possible
+        if (log_interval_ > 0 && ++log_counter_ >= log_interval_ && vert::logger->should_log(spdlog::level::debug)) {
+            log_counter_ = 0;
+            if (pixel_type != log_pixel_type_) {
+                log_pixel_type_ = pixel_type;
+                log_pixel_name_ = vert::pixel_type_to_string(pixel_type);
+            }
+            vert::logger->debug("Grab from Device: '{}' ID: {} Size: {}x{} Type: {} Timestamp: {}",
+                user_id_, frame_id, width, height, log_pixel_name_, timestamp);
+        }
+
+        vert::FrameHeader header;
+        header.device = device_;
+        header.id = frame_id;
+        header.timestamp = timestamp;
+        header.error_cnt = error_count_;
+        header.buffer_size = bufsize;
+        header.height = height;
+        header.width = width;
+        header.pixel_type = (int)pixel_type;
+        header.padding_x = ptr->GetPaddingX();
+        header.grab_ns = grab_ns;
+        header.exposure_ns = clock_mapper_.to_host_ns(static_cast<int64_t>(timestamp));
+
         zmq::message_t msg;
-        msg.rebuild(ptr->GetBuffer(),
-                    bufsize,
-                    [](void*, void* hint) {/*deconstruction*/}, 
-                    nullptr);
-        publisher_.send(msg, zmq::send_flags::dontwait);
-    
-        vert::logger->trace("Send: meta {} bytes, image {} bytes", meta_msg.size(), msg.size());
-    
+        if (zero_copy_) {
+            // buffer goes back to pylon only when the last consumer drops the message
+            msg = vert::make_owned_message(ptr->GetBuffer(), bufsize, InFlightFrame(ptr, in_flight_, buffer_factory_));
+        } else {
+            msg.rebuild(ptr->GetBuffer(), bufsize); // copy, pylon may requeue the buffer right after return
+        }
+        send_frame(header, msg);
+        callback_stats_.add(vert::steady_now_ns() - grab_ns);
     }
 
+    // latest_only / latest: pylon reports the frames it overwrote before this callback
     virtual void OnImagesSkipped(Pylon::CInstantCamera & _camera, size_t countOfSkippedImages) override {
         error_count_ += countOfSkippedImages;
+        skipped_count_ += countOfSkippedImages;
     }
 
     virtual void OnGrabStart(Pylon::CInstantCamera & _camera) override {
         error_count_ = 0; 
+        grab_thread_setup_ = false; // pylon starts a new grab loop thread per StartGrabbing
     }
 
     virtual void OnGrabError(Pylon::CInstantCamera & _camera, const char* errmsg) override {
@@ -140,13 +257,235 @@ public:
     std::string name_;
 
 protected:
+    // Keeps a grab result (and so its pylon buffer) alive while zmq holds the frame, together with
+    // the arena the buffer lives in and the shared in flight count close() waits on
+    class InFlightFrame {
+    public:
+        InFlightFrame(const Pylon::CGrabResultPtr &ptr, vert::InFlightCounter::Ptr counter,
+                      std::shared_ptr<vert::FrameBufferFactory> factory)
+            : ptr_(ptr), factory_(std::move(factory)), token_(std::move(counter)) {
+        }
+        InFlightFrame(InFlightFrame &&other) noexcept
+            : ptr_(other.ptr_), factory_(std::move(other.factory_)), token_(std::move(other.token_)) {
+            other.ptr_.Release();
+        }
+        InFlightFrame(const InFlightFrame &) = delete;
+        InFlightFrame &operator=(const InFlightFrame &) = delete;
+        InFlightFrame &operator=(InFlightFrame &&) = delete;
+        ~InFlightFrame() {
+            ptr_.Release(); // hands the buffer back to factory_, still alive here; token_ counts it out after
+        }
+    private:
+        Pylon::CGrabResultPtr ptr_;
+        std::shared_ptr<vert::FrameBufferFactory> factory_;
+        vert::InFlightToken token_;
+    };
+
+    // meta + image, image is moved out
+    bool send_frame(const vert::FrameHeader &header, zmq::message_t &image) {
+        zmq::message_t meta_msg = vert::make_grab_meta_msg(header, meta_encoding_);
+        publisher_.send(meta_msg, zmq::send_flags::sndmore);
+        size_t image_size = image.size();
+        bool ok = static_cast<bool>(publisher_.send(image, zmq::send_flags::dontwait));
+        vert::logger->trace("Send: meta {} bytes, image {} bytes", meta_msg.size(), image_size);
+        return ok;
+    }
+
+    // Shared by the start() of every device, `max_images` 0 means until stop()
+    bool start_grabbing(size_t max_images = 0) {
+        try {
+            if (grab_strategy_ == Pylon::GrabStrategy_LatestImages) {
+                if (num_buffers_ > 0 && output_queue_size_ > num_buffers_) {
+                    vert::logger->warn("{} output_queue_size {} > num_buffers {}", name_, output_queue_size_, num_buffers_);
+                }
+                camera_.OutputQueueSize.SetValue(output_queue_size_);
+            }
+
+            skipped_count_ = 0;
+            callback_stats_.reset();
+            log_counter_ = 0;
+            if (max_images > 0) {
+                camera_.StartGrabbing(max_images, grab_strategy_, Pylon::GrabLoop_ProvidedByInstantCamera);
+            } else {
+                camera_.StartGrabbing(grab_strategy_, Pylon::GrabLoop_ProvidedByInstantCamera);
+            }
+        } catch (const Pylon::GenericException& e) {
+            // e.g. upcoming is not supported by USB3 Vision cameras
+            vert::logger->error("{} failed to start grabbing ({}). Reason: {}", name_,
+                                vert::grab_strategy_to_string(grab_strategy_), e.what());
+            return false;
+        }
+
+        vert::logger->info("{} grabbing with {}", name_, vert::grab_strategy_to_string(grab_strategy_));
+        start_clock_sync();
+        return true;
+    }
+
+    // Periodic TimestampLatch against steady_clock, keeps clock_mapper_ fitted while grabbing
+    void start_clock_sync() {
+        if (clock_sync_period_.count() == 0 || clock_thread_.joinable())
+            return;
+
+        double ns_per_tick = 1.0; // USB3 Vision / SFNC cameras count in ns
+        try {
+            if (camera_.GevTimestampTickFrequency.IsReadable() && camera_.GevTimestampTickFrequency.GetValue() > 0)
+                ns_per_tick = 1e9 / static_cast<double>(camera_.GevTimestampTickFrequency.GetValue());
+        } catch (const Pylon::GenericException&) {
+        }
+        clock_mapper_.reset(ns_per_tick);
+
+        int64_t ticks = 0, host_ns = 0, round_trip_ns = 0;
+        if (!latch_timestamp(ticks, host_ns, round_trip_ns)) {
+            vert::logger->info("{} has no timestamp latch, exposure time not mapped to host clock", name_);
+            return;
+        }
+        clock_mapper_.add_sample(ticks, host_ns);
+
+        clock_syncing_ = true;
+        clock_thread_ = std::thread(&BaslerBase::clock_sync_loop, this);
+    }
+
+    void stop_clock_sync() {
+        {
+            std::lock_guard<std::mutex> lock(clock_mutex_);
+            clock_syncing_ = false;
+        }
+        clock_cv_.notify_all();
+        if (clock_thread_.joinable())
+            clock_thread_.join();
+    }
+
+    void clock_sync_loop() {
+        int64_t best_round_trip_ns = std::numeric_limits<int64_t>::max();
+        std::unique_lock<std::mutex> lock(clock_mutex_);
+        while (clock_syncing_) {
+            clock_cv_.wait_for(lock, clock_sync_period_, [this] { return !clock_syncing_; });
+            if (!clock_syncing_)
+                break;
+
+            int64_t ticks = 0, host_ns = 0, round_trip_ns = 0;
+            if (!latch_timestamp(ticks, host_ns, round_trip_ns))
+                continue;
+            // a latch delayed by a busy link or scheduler would bend the line, skip it
+            best_round_trip_ns = std::min(best_round_trip_ns, round_trip_ns);
+            if (round_trip_ns > 2 * best_round_trip_ns + 200000)
+                continue;
+            clock_mapper_.add_sample(ticks, host_ns);
+            vert::logger->trace("{} clock sync: round trip {} us, drift {:.2f} ppm", name_, round_trip_ns / 1000, clock_mapper_.drift_ppm());
+        }
+    }
+
+    // host time is taken halfway through the latch command
+    bool latch_timestamp(int64_t &ticks, int64_t &host_ns, int64_t &round_trip_ns) {
+        try {
+            int64_t before = vert::steady_now_ns();
+            if (camera_.TimestampLatch.IsWritable()) {
+                camera_.TimestampLatch.Execute();
+                ticks = camera_.TimestampLatchValue.GetValue();
+            } else if (camera_.GevTimestampControlLatch.IsWritable()) {
+                camera_.GevTimestampControlLatch.Execute();
+                ticks = camera_.GevTimestampValue.GetValue();
+            } else {
+                return false;
+            }
+            int64_t after = vert::steady_now_ns();
+            host_ns = before + (after - before) / 2;
+            round_trip_ns = after - before;
+        } catch (const Pylon::GenericException& e) {
+            vert::logger->debug("{} timestamp latch failed. Reason: {}", name_, e.what());
+            return false;
+        }
+        return true;
+    }
+
+    // The grab loop thread belongs to pylon, so it is set up from inside the first callback
+    void setup_grab_thread() {
+        grab_thread_setup_ = true;
+        vert::set_current_thread_name(user_id_);
+        if (cpu_affinity_.empty())
+            return;
+        if (vert::set_current_thread_affinity(cpu_affinity_)) {
+            vert::logger->info("{} grab thread pinned to cpu {}", name_, vert::join(cpu_affinity_, ","));
+        } else {
+            vert::logger->warn("{} failed to pin grab thread to cpu {}", name_, vert::join(cpu_affinity_, ","));
+        }
+    }
+
+    // Must be called after the device is attached and before grabbing starts
+    bool setup_buffers() {
+        if (num_buffers_ == 0 || !camera_.IsPylonDeviceAttached())
+            return true;
+
+        try {
+            if (zero_copy_ && max_in_flight_ >= num_buffers_) {
+                vert::logger->warn("{} max_in_flight {} >= num_buffers {}, pylon will run out of buffers",
+                                   name_, max_in_flight_, num_buffers_);
+            }
+
+            camera_.MaxNumBuffer.SetValue(num_buffers_);
+            buffer_factory_->configure(num_buffers_, hugepages_);
+            buffer_factory_->reserve(camera_.PayloadSize.GetValue());
+            camera_.SetBufferFactory(buffer_factory_.get(), Pylon::Cleanup_None);
+        } catch (const Pylon::GenericException& e) {
+            vert::logger->error("{} failed to set buffer factory. Reason: {}", name_, e.what());
+            return false;
+        }
+
+        vert::logger->info("{} uses {} grab buffers, arena {} MB", name_, num_buffers_,
+                           buffer_factory_->arena_size() / (1024 * 1024));
+        return true;
+    }
+
+    // Grab results must be released before the device is destroyed, so this blocks until the
+    // consumers let go of every frame
+    void wait_in_flight() {
+        while (!in_flight_->wait_idle(std::chrono::milliseconds(1000))) {
+            vert::logger->warn("{} waiting for {} frames still in flight to close the device",
+                               name_, in_flight_->count());
+        }
+    }
+
+    // Declared before camera_ so it outlives it (registered with Cleanup_None). Shared with every
+    // in flight frame: the arena is only freed once the last one is released, whenever that is.
+    std::shared_ptr<vert::FrameBufferFactory> buffer_factory_ = std::make_shared<vert::FrameBufferFactory>();
     Pylon::CBaslerUniversalInstantCamera camera_;
     Pylon::CGrabResultPtr m_ptrGrabResult;
     zmq::socket_t publisher_;
     std::string user_id_;
+    uint16_t device_ = vert::kUnknownDevice;
+    vert::MetaEncoding meta_encoding_ = vert::MetaEncoding::Binary;
 
     size_t error_count_ = 0;
 
+    bool zero_copy_ = false;
+    size_t max_in_flight_ = 8;
+    vert::InFlightCounter::Ptr in_flight_ = vert::InFlightCounter::create();
+    std::atomic<size_t> dropped_count_{0};
+    std::atomic<size_t> skipped_count_{0};
+
+    Pylon::EGrabStrategy grab_strategy_ = Pylon::GrabStrategy_OneByOne;
+    size_t output_queue_size_ = 1; // latest only
+
+    size_t num_buffers_ = 0; // 0: let pylon allocate
+    bool hugepages_ = false;
+
+    // grab callback, only touched by the grab thread
+    size_t log_interval_ = 0; // debug log every n-th frame, 0: off
+    size_t log_counter_ = 0;
+    Pylon::EPixelType log_pixel_type_ = Pylon::PixelType_Undefined;
+    std::string log_pixel_name_;
+    vert::LatencyStats callback_stats_;
+
+    vert::ClockMapper clock_mapper_;
+    std::chrono::milliseconds clock_sync_period_{1000}; // 0: off
+    std::thread clock_thread_;
+    std::mutex clock_mutex_;
+    std::condition_variable clock_cv_;
+    bool clock_syncing_ = false;
+
+    std::vector<int> cpu_affinity_; // empty: let the OS schedule the grab thread
+    bool grab_thread_setup_ = false; // only touched by the grab thread
+
     virtual bool device_specific_init(const YAML::Node& config) = 0;
 
 };
@@ -0,0 +1,154 @@
+#ifndef _FRAME_BUFFER_FACTORY_H_
+#define _FRAME_BUFFER_FACTORY_H_
+
+#include <pylon/PylonIncludes.h>
+#include <mutex>
+#include <vector>
+#include <algorithm>
+#include "../utils/logging.h"
+#include "../utils/memory_utils.h"
+
+namespace vert {
+
+// Hands out pylon grab buffers from one pre-reserved, page aligned arena.
+// Slot size is the payload size rounded up to the (huge) page size,
+// so every frame starts on its own page.
+// Allocation only happens at grab start / stop, a mutex is good enough.
+class FrameBufferFactory : public Pylon::IBufferFactory
+{
+public:
+    FrameBufferFactory() = default;
+
+    ~FrameBufferFactory() {
+        release_arena();
+        for (auto &[ptr, size] : overflow_) {
+            vert::free_pages(ptr, size, false);
+        }
+    }
+
+    FrameBufferFactory(const FrameBufferFactory &) = delete;
+    FrameBufferFactory &operator=(const FrameBufferFactory &) = delete;
+
+    void configure(size_t num_buffers, bool hugepages) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        num_buffers_ = num_buffers;
+        hugepages_ = hugepages;
+    }
+
+    // Reserve arena up front so grab start does not touch the allocator
+    bool reserve(size_t buffer_size) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return reserve_locked(buffer_size);
+    }
+
+    size_t num_buffers() const { return num_buffers_; }
+    size_t slot_size() const { return slot_size_; }
+    size_t arena_size() const { return slot_size_ * num_buffers_; }
+    bool is_huge() const { return is_huge_; }
+
+    void AllocateBuffer(size_t bufferSize, void **pCreatedBuffer, intptr_t &bufferContext) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        if (!arena_ || (bufferSize > slot_size_ && free_slots_.size() == num_buffers_)) {
+            // payload grew (ROI / pixel format change) and nothing is handed out, re-reserve
+            reserve_locked(bufferSize);
+        }
+
+        if (bufferSize <= slot_size_ && !free_slots_.empty()) {
+            size_t index = free_slots_.back();
+            free_slots_.pop_back();
+            *pCreatedBuffer = arena_ + index * slot_size_;
+            bufferContext = static_cast<intptr_t>(index);
+            return;
+        }
+
+        // more buffers than configured (MaxNumBuffer not applied?), serve outside of the arena
+        vert::logger->warn("Buffer arena exhausted ({} x {} bytes), allocating {} bytes outside",
+                           num_buffers_, slot_size_, bufferSize);
+        void *ptr = vert::alloc_pages(bufferSize, false);
+        if (!ptr)
+            throw std::bad_alloc();
+        overflow_.emplace_back(ptr, bufferSize);
+        *pCreatedBuffer = ptr;
+        bufferContext = -1;
+    }
+
+    void FreeBuffer(void *pCreatedBuffer, intptr_t bufferContext) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (bufferContext >= 0) {
+            free_slots_.push_back(static_cast<size_t>(bufferContext));
+            return;
+        }
+
+        auto it = std::find_if(overflow_.begin(), overflow_.end(),
+                               [pCreatedBuffer](const auto &item) { return item.first == pCreatedBuffer; });
+        if (it != overflow_.end()) {
+            vert::free_pages(it->first, it->second, false);
+            overflow_.erase(it);
+        }
+    }
+
+    void DestroyBufferFactory() override {
+        // owned by BaslerBase, registered with Cleanup_None
+    }
+
+private:
+    bool reserve_locked(size_t buffer_size) {
+        if (num_buffers_ == 0 || buffer_size == 0)
+            return false;
+
+        size_t align = vert::page_size();
+        if (hugepages_ && vert::huge_page_size() > 0)
+            align = vert::huge_page_size();
+        size_t slot_size = vert::align_up(buffer_size, align);
+
+        if (arena_ && slot_size <= slot_size_)
+            return true;
+
+        release_arena();
+
+        bool is_huge = false;
+        auto *arena = static_cast<uint8_t *>(vert::alloc_pages(slot_size * num_buffers_, hugepages_, &is_huge));
+        if (!arena) {
+            vert::logger->error("Failed to reserve buffer arena of {} x {} bytes", num_buffers_, slot_size);
+            return false;
+        }
+
+        arena_ = arena;
+        slot_size_ = slot_size;
+        is_huge_ = is_huge;
+        free_slots_.clear();
+        for (size_t i = num_buffers_; i > 0; --i) {
+            free_slots_.push_back(i - 1);
+        }
+
+        vert::logger->info("Buffer arena reserved: {} x {} bytes ({} pages)",
+                           num_buffers_, slot_size_, is_huge_ ? "huge" : "normal");
+        if (hugepages_ && !is_huge_) {
+            vert::logger->warn("Huge pages requested but not available, using normal pages");
+        }
+        return true;
+    }
+
+    void release_arena() {
+        if (arena_) {
+            vert::free_pages(arena_, slot_size_ * num_buffers_, is_huge_);
+            arena_ = nullptr;
+        }
+        slot_size_ = 0;
+        free_slots_.clear();
+    }
+
+    std::mutex mutex_;
+    uint8_t *arena_ = nullptr;
+    size_t num_buffers_ = 0;
+    size_t slot_size_ = 0;
+    bool hugepages_ = false;
+    bool is_huge_ = false;
+    std::vector<size_t> free_slots_;
+    std::vector<std::pair<void *, size_t>> overflow_;
+};
+
+} // namespace vert
+
+#endif /* _FRAME_BUFFER_FACTORY_H_ */
@@ -13,7 +13,7 @@ vert::BaslerCamera::~BaslerCamera()
 
 void vert::BaslerCamera::start()
 {
-    camera_.StartGrabbing(Pylon::GrabStrategy_OneByOne, Pylon::GrabLoop_ProvidedByInstantCamera);
+    start_grabbing();
 }
 
 bool vert::BaslerCamera::device_specific_init(const YAML::Node &config)
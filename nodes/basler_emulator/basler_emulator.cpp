@@ -1,4 +1,11 @@
 #include "basler_emulator.h"
+#include <algorithm>
+#include <filesystem>
+#include <set>
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+#include "../utils/cv_utils.h"
+#include "../utils/memory_utils.h"
 
 using namespace vert;
 using namespace std;
@@ -12,18 +19,34 @@ vert::BaslerEmulator::BaslerEmulator(zmq::context_t *ctx)
 
 vert::BaslerEmulator::~BaslerEmulator()
 {
+    stop();
 }
 
 void vert::BaslerEmulator::start()
 {
-    if (cfg_.max_images > 0) {
-        camera_.StartGrabbing(cfg_.max_images, GrabStrategy_OneByOne, GrabLoop_ProvidedByInstantCamera);
-    } else {
-        camera_.StartGrabbing(GrabStrategy_OneByOne, GrabLoop_ProvidedByInstantCamera);
+    if (cfg_.mode == Mode::Preload) {
+        if (!is_replaying_) {
+            is_replaying_ = true;
+            replay_thread_ = std::thread(&BaslerEmulator::replay_loop, this);
+        }
+        return;
     }
+
+    start_grabbing(cfg_.max_images > 0 ? cfg_.max_images : 0);
 }
 
 
+void vert::BaslerEmulator::stop()
+{
+    if (is_replaying_) {
+        is_replaying_ = false;
+        if (replay_thread_.joinable()) {
+            replay_thread_.join();
+        }
+    }
+    BaslerBase::stop();
+}
+
 bool vert::BaslerEmulator::set_image_filename(std::string_view filename)
 {
     return vert::set_image_filename(camera_, filename);
@@ -81,37 +104,27 @@ bool vert::BaslerEmulator::device_specific_init(const YAML::Node &config)
             vert::logger->warn("pixel_format not provided, use default {}.", cfg_.pixel_format); 
         }
 
-        Pylon::CDeviceInfo di;
-        di.SetDeviceClass(Pylon::BaslerCamEmuDeviceClass);
-        camera_.Attach( Pylon::CTlFactory::GetInstance().CreateFirstDevice(di), Pylon::Cleanup_Delete );
-
-        // DON'T open camera before register
-        
-        vert::register_default_events(camera_);
-
-        if (!camera_.DeviceUserID.TrySetValue(user_id_.c_str())) {
-            vert::logger->error("{} failed to set user_id: {}", name_, user_id_);
-            return false; 
+        if (config["mode"]) {
+            auto mode = vert::to_lower(config["mode"].as<string>());
+            if (mode == "preload") {
+                cfg_.mode = Mode::Preload;
+            } else if (mode == "camemu") {
+                cfg_.mode = Mode::CamEmu;
+            } else {
+                vert::logger->warn("unknown mode {}, use default camemu.", mode);
+            }
         }
-        // Disable standard test images
-        camera_.TestImageSelector.SetValue(TestImageSelector_Off);
-        // Enable custom test images
-        camera_.ImageFileMode.SetValue(ImageFileMode_On);
-        
-        camera_.AcquisitionMode.SetValue(AcquisitionMode_Continuous);
 
-        // ** Force Failed Buffer (only for test)**
-        // camera_.ForceFailedBufferCount.SetValue(10);
-        // camera_.ForceFailedBuffer.Execute();
-
-        if (!set_image_filename(cfg_.file_path))
-            return false;
-
-        set_fps(cfg_.fps);
+        if (config["honor_timestamps"]) {
+            cfg_.honor_timestamps = config["honor_timestamps"].as<bool>();
+        }
 
-        if (!set_pixel_format(cfg_.pixel_format))
+        if (cfg_.mode == Mode::Preload) {
+            if (!preload_frames())
+                return false;
+        } else if (!camemu_init()) {
             return false;
-
+        }
 
     } catch (const YAML::Exception& e) {
         vert::logger->critical("Failed to init '{}'. Reason: {}", name_, e.what());
@@ -128,3 +141,191 @@ bool vert::BaslerEmulator::device_specific_init(const YAML::Node &config)
 
     return true;
 }
+
+bool vert::BaslerEmulator::camemu_init()
+{
+    Pylon::CDeviceInfo di;
+    di.SetDeviceClass(Pylon::BaslerCamEmuDeviceClass);
+    camera_.Attach( Pylon::CTlFactory::GetInstance().CreateFirstDevice(di), Pylon::Cleanup_Delete );
+
+    // DON'T open camera before register
+    
+    vert::register_default_events(camera_);
+
+    if (!camera_.DeviceUserID.TrySetValue(user_id_.c_str())) {
+        vert::logger->error("{} failed to set user_id: {}", name_, user_id_);
+        return false; 
+    }
+    // Disable standard test images
+    camera_.TestImageSelector.SetValue(TestImageSelector_Off);
+    // Enable custom test images
+    camera_.ImageFileMode.SetValue(ImageFileMode_On);
+    
+    camera_.AcquisitionMode.SetValue(AcquisitionMode_Continuous);
+
+    // ** Force Failed Buffer (only for test)**
+    // camera_.ForceFailedBufferCount.SetValue(10);
+    // camera_.ForceFailedBuffer.Execute();
+
+    if (!set_image_filename(cfg_.file_path))
+        return false;
+
+    set_fps(cfg_.fps);
+
+    if (!set_pixel_format(cfg_.pixel_format))
+        return false;
+
+    return true;
+}
+
+bool vert::BaslerEmulator::preload_frames()
+{
+    namespace fs = std::filesystem;
+
+    Pylon::EPixelType pixel_type = vert::string_to_pixel_type(cfg_.pixel_format);
+    if (vert::pixel_type_to_cv_type(pixel_type) == -1) {
+        vert::logger->critical("Failed to init '{}'. Reason: pixel_format {} not supported in preload mode", name_, cfg_.pixel_format);
+        return false;
+    }
+
+    const std::set<std::string> allowed_ext {".bmp", ".jpg", ".jpeg", ".png", ".tif", ".tiff"};
+    std::vector<fs::path> files;
+    fs::path file_path(cfg_.file_path);
+    if (fs::is_regular_file(file_path)) {
+        files.push_back(file_path);
+    } else if (fs::is_directory(file_path)) {
+        for (const auto& entry : fs::directory_iterator(file_path)) {
+            if (entry.is_regular_file() && allowed_ext.count(vert::to_lower(entry.path().extension().string())))
+                files.push_back(entry.path());
+        }
+        std::sort(files.begin(), files.end());
+    }
+
+    if (files.empty()) {
+        vert::logger->critical("Failed to init '{}'. Reason: no image found in {}", name_, cfg_.file_path);
+        return false;
+    }
+
+    // 1. decode and convert to the emulated pixel format
+    std::vector<cv::Mat> images;
+    std::vector<fs::file_time_type> write_times;
+    images.reserve(files.size());
+    for (const auto& file : files) {
+        cv::Mat bgr = cv::imread(file.string(), cv::IMREAD_COLOR);
+        if (bgr.empty()) {
+            vert::logger->warn("{} skipped unreadable {}", name_, file.string());
+            continue;
+        }
+
+        cv::Mat frame;
+        switch (pixel_type) {
+            case Pylon::PixelType_Mono8: cv::cvtColor(bgr, frame, cv::COLOR_BGR2GRAY); break;
+            case Pylon::PixelType_RGB8packed: cv::cvtColor(bgr, frame, cv::COLOR_BGR2RGB); break;
+            case Pylon::PixelType_BayerRG8: vert::bgr_to_bayer(bgr, frame, vert::BayerPattern::RG); break;
+            case Pylon::PixelType_BayerGR8: vert::bgr_to_bayer(bgr, frame, vert::BayerPattern::GR); break;
+            case Pylon::PixelType_BayerGB8: vert::bgr_to_bayer(bgr, frame, vert::BayerPattern::GB); break;
+            case Pylon::PixelType_BayerBG8: vert::bgr_to_bayer(bgr, frame, vert::BayerPattern::BG); break;
+            default: frame = bgr; break;
+        }
+        images.push_back(frame);
+        write_times.push_back(fs::last_write_time(file));
+    }
+
+    if (images.empty()) {
+        vert::logger->critical("Failed to init '{}'. Reason: no image decoded from {}", name_, cfg_.file_path);
+        return false;
+    }
+
+    // 2. copy into one contiguous bank, every frame starts on a cache line
+    constexpr size_t kAlign = 64;
+    auto bank = std::make_shared<FrameBank>();
+    bank->pixel_type = pixel_type;
+    size_t total = 0;
+    for (const auto& image : images) {
+        total += vert::align_up(image.total() * image.elemSize(), kAlign);
+    }
+
+    bank->data = static_cast<uint8_t *>(vert::alloc_pages(total, hugepages_, &bank->is_huge));
+    if (!bank->data) {
+        vert::logger->critical("Failed to init '{}'. Reason: cannot allocate {} MB frame bank", name_, total / (1024 * 1024));
+        return false;
+    }
+    bank->size = total;
+
+    size_t offset = 0;
+    for (size_t i = 0; i < images.size(); ++i) {
+        const cv::Mat& image = images[i];
+        size_t size = image.total() * image.elemSize();
+        cv::Mat dst(image.rows, image.cols, image.type(), bank->data + offset);
+        image.copyTo(dst);
+
+        int64_t gap_ns = 0;
+        if (i > 0) {
+            gap_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(write_times[i] - write_times[i - 1]).count();
+            gap_ns = std::max<int64_t>(gap_ns, 0);
+        }
+        bank->frames.push_back({offset, size, (uint32_t)image.cols, (uint32_t)image.rows, gap_ns});
+        offset += vert::align_up(size, kAlign);
+    }
+
+    bank_ = bank;
+
+    vert::logger->info("{} preloaded {} frames ({} MB) from {}", name_, bank_->frames.size(), total / (1024 * 1024), cfg_.file_path);
+    return true;
+}
+
+void vert::BaslerEmulator::replay_loop()
+{
+    pacer_.configure(cfg_.fps);
+    pacer_.reset();
+    error_count_ = 0;
+
+    const auto& frames = bank_->frames;
+    int64_t frame_id = 0;
+    int64_t replay_ns = 0; // emulated camera clock
+    auto t_start = std::chrono::steady_clock::now();
+
+    while (is_replaying_ && (cfg_.max_images <= 0 || frame_id < cfg_.max_images)) {
+        size_t index = frame_id % frames.size();
+        const auto& frame = frames[index];
+
+        if (cfg_.honor_timestamps && index > 0) {
+            pacer_.wait_for(std::chrono::nanoseconds(frame.gap_ns));
+            replay_ns += frame.gap_ns;
+        } else {
+            pacer_.wait_next();
+            replay_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t_start).count();
+        }
+
+        // same back-pressure as the grab callback, a camera keeps exposing while consumers hold frames
+        if (bank_in_flight_->count() >= max_in_flight_) {
+            dropped_count_++;
+            error_count_++;
+            frame_id++;
+            continue;
+        }
+
+        vert::FrameHeader header;
+        header.device = device_;
+        header.id = frame_id;
+        header.timestamp = replay_ns;
+        header.error_cnt = error_count_;
+        header.buffer_size = frame.size;
+        header.height = frame.height;
+        header.width = frame.width;
+        header.pixel_type = (int)bank_->pixel_type;
+        header.grab_ns = vert::steady_now_ns();
+
+        // bank is read only, frames in flight keep it alive
+        zmq::message_t msg = vert::make_owned_message(bank_->data + frame.offset, frame.size, BankFrame(bank_, bank_in_flight_));
+        if (!send_frame(header, msg)) {
+            error_count_++;
+        }
+
+        frame_id++;
+    }
+
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - t_start).count();
+    vert::logger->info("{} replayed {} frames in {:.2f} s ({:.1f} fps), errors {}",
+                       name_, frame_id, elapsed, elapsed > 0 ? frame_id / elapsed : 0.0, error_count_);
+}
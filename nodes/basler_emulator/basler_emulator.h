@@ -2,18 +2,60 @@
 #define _BASLER_EMULATOR_H_
 #include <string>
 #include <string_view>
+#include <memory>
+#include <vector>
 #include "../basler_base/basler_base.h"
+#include "../utils/frame_pacer.h"
 
 namespace vert {
 
     class BaslerEmulator : public BaslerBase
     {
         
+        enum class Mode {
+            CamEmu = 0,  // pylon camemu decodes files from disk per frame
+            Preload = 1  // decode once into RAM, replay from a frame bank
+        };
+
         struct BaslerEmulatorConfig {
             std::string file_path;
             std::string pixel_format = "BGR8Packed";
             int max_images = -1;
-            double fps = 30.0;
+            double fps = 30.0;       // preload: <= 0 means unthrottled
+            Mode mode = Mode::CamEmu;
+            bool honor_timestamps = false; // preload: replay with the files' write time gaps
+        };
+
+        // All decoded frames in one contiguous, page aligned block
+        struct FrameBank {
+            struct Frame {
+                size_t offset;
+                size_t size;
+                uint32_t width;
+                uint32_t height;
+                int64_t gap_ns; // to previous frame, from file write time
+            };
+
+            ~FrameBank() { vert::free_pages(data, size, is_huge); }
+
+            uint8_t *data = nullptr;
+            size_t size = 0;
+            bool is_huge = false;
+            Pylon::EPixelType pixel_type = Pylon::PixelType_Undefined;
+            std::vector<Frame> frames;
+        };
+
+        // Keeps the bank alive while zmq holds a frame of it and counts the frame in flight, like
+        // BaslerBase::InFlightFrame does for pylon buffers. The count is the bank's own, so close()
+        // does not wait on frames that need no device.
+        class BankFrame {
+        public:
+            BankFrame(std::shared_ptr<const FrameBank> bank, vert::InFlightCounter::Ptr counter)
+                : bank_(std::move(bank)), token_(std::move(counter)) {
+            }
+        private:
+            std::shared_ptr<const FrameBank> bank_;
+            vert::InFlightToken token_;
         };
 
     public:
@@ -21,6 +63,7 @@ namespace vert {
         ~BaslerEmulator();
 
         void start();
+        void stop() override;
 
         bool set_image_filename(std::string_view filename);
         bool set_fps(double fps);
@@ -31,8 +74,20 @@ namespace vert {
     private:
         bool device_specific_init(const YAML::Node& config) override;
 
+        bool camemu_init();
+
+        bool preload_frames();
+
+        void replay_loop();
+
         BaslerEmulatorConfig cfg_;
 
+        std::shared_ptr<const FrameBank> bank_; // shared with frames in flight
+        vert::InFlightCounter::Ptr bank_in_flight_ = vert::InFlightCounter::create(); // same, for back-pressure
+        std::thread replay_thread_;
+        std::atomic<bool> is_replaying_{false};
+        FramePacer pacer_;
+
     };
 
 } // namespace vert
@@ -1,12 +1,20 @@
 #include <vector>
+#include <cstring>
+#include <chrono>
+#include <functional>
+#include <cmath>
 #include <opencv2/imgproc.hpp>
 #include <opencv2/highgui.hpp>
 #include "camera_adapter.h"
-#include "../third_party/msgpack.hpp"
 #include "../third_party/zmq_addon.hpp"
+#include "../utils/zmq_utils.h"
 #include "../utils/pylon_utils.h"
 #include "../utils/cv_utils.h"
 #include "../utils/logging.h"
+#include "../utils/thread_utils.h"
+#include "../utils/downscale.h"
+#include "../utils/unpack.h"
+#include "../utils/lazy_frame.h"
 
 using namespace std;
 
@@ -16,10 +24,9 @@ using namespace std;
 
 vert::CameraAdapter::CameraAdapter(zmq::context_t *ctx)
     : publisher_(*ctx, zmq::socket_type::pub),
+      ui_preview_(ctx),
       subscriber_(*ctx, zmq::socket_type::pull)
 {
-    converter_.OutputOrientation = Pylon::OutputOrientation_Unchanged;
-    converter_.MaxNumThreads = 1;
 }
 
 vert::CameraAdapter::~CameraAdapter()
@@ -33,6 +40,8 @@ bool vert::CameraAdapter::init(const YAML::Node &config)
     vert::logger->info("Initializing CameraAdapter ...");
 
     try {
+        string ui_address;
+        string node_address;
         if (!config) {
             vert::logger->critical("Failed to init CameraAdapter. Reason: config is empty");
             return false; 
@@ -43,6 +52,7 @@ bool vert::CameraAdapter::init(const YAML::Node &config)
         } else {
             vert::logger->warn("name not provided.");
         }
+        node_ = vert::intern_node(name_);
 
         if (config["port"]) {
 
@@ -57,20 +67,17 @@ bool vert::CameraAdapter::init(const YAML::Node &config)
             }
 
             if (config["port"]["to_ui"]) {
-                string address = config["port"]["to_ui"].as<string>();
-                publisher_.connect(address);
-                // publisher_.set(zmq::sockopt::sndhwm, 10);      // limited watermark
-                vert::logger->info("{} publisher connected to {}", name_, address);
+                ui_address = config["port"]["to_ui"].as<string>(); // connected by ui_preview_ with the preview settings
             } else {
                 vert::logger->critical("Failed to init '{}'. Reason: port.to_ui is empty", name_); // TODO: temp return false
                 return false;
             }
 
             if (config["port"]["to_node"]) {
-                string address = config["port"]["to_node"].as<string>();
-                publisher_.bind(address);
+                node_address = config["port"]["to_node"].as<string>();
+                publisher_.bind(node_address);
                 // publisher_.set(zmq::sockopt::sndhwm, 100);      // high warermark
-                vert::logger->info("{} publisher bound to {}", name_, address);
+                vert::logger->info("{} publisher bound to {}", name_, node_address);
             } else {
                 vert::logger->critical("Failed to init '{}'. Reason: port.to_node is empty", name_);
                 return false;
@@ -81,6 +88,14 @@ bool vert::CameraAdapter::init(const YAML::Node &config)
             return false; 
         }
 
+        if (config["meta_encoding"]) {
+            auto encoding = config["meta_encoding"].as<string>();
+            if (!vert::meta_encoding_from_string(encoding, cfg_.meta_encoding)) {
+                vert::logger->warn("unknown meta_encoding {}, use default {}", encoding, vert::meta_encoding_to_string(cfg_.meta_encoding));
+            }
+            vert::logger->info("meta_encoding set to {}", vert::meta_encoding_to_string(cfg_.meta_encoding));
+        }
+
         if (config["converter"]) {
 
             if (config["converter"]["use"]) {
@@ -90,6 +105,10 @@ bool vert::CameraAdapter::init(const YAML::Node &config)
                     cfg_.converter_choice = ConverterChoice::Pylon; 
                 } else if (choice == "opencv") {
                     cfg_.converter_choice = ConverterChoice::OpenCV; 
+                } else if (choice == "native") {
+                    cfg_.converter_choice = ConverterChoice::Native;
+                } else if (choice == "raw") {
+                    cfg_.converter_choice = ConverterChoice::Raw;
                 } else {
                     vert::logger->warn("unknown converter.use {}, use default {}", choice, (int)cfg_.converter_choice); 
                 }
@@ -97,12 +116,47 @@ bool vert::CameraAdapter::init(const YAML::Node &config)
                 vert::logger->warn("converter.use not provided, use default {}", (int)cfg_.converter_choice); 
             }
 
-            if (cfg_.converter_choice == ConverterChoice::Pylon) {
+            if (config["converter"]["num_workers"] && config["converter"]["num_workers"].as<int>() > 0) {
+                cfg_.num_workers = config["converter"]["num_workers"].as<int>();
+            }
+            if (config["converter"]["queue_size"]) {
+                cfg_.queue_size = static_cast<size_t>(max(0, config["converter"]["queue_size"].as<int>()));
+            }
+            if (config["converter"]["num_bands"] && config["converter"]["num_bands"].as<int>() > 0) {
+                cfg_.num_bands = config["converter"]["num_bands"].as<int>();
+            }
+
+            // native debayer and unpacking of packed formats
+            if (config["converter"]["simd"]) {
+                auto simd = config["converter"]["simd"].as<string>();
+                if (!vert::simd_level_from_string(simd, cfg_.native_simd)) {
+                    vert::logger->warn("unknown converter.simd {}, use default {}", simd, vert::simd_level_to_string(cfg_.native_simd));
+                }
+            }
+            vert::logger->info("converter.simd set to {}, running {}", vert::simd_level_to_string(cfg_.native_simd),
+                               vert::simd_level_to_string(vert::debayer_simd_level(cfg_.native_simd)));
+
+            if (config["converter"]["packed"]) {
+                const auto& packed = config["converter"]["packed"];
+                if (packed["output_depth"]) {
+                    int depth = packed["output_depth"].as<int>();
+                    if (depth == 8 || depth == 16) {
+                        cfg_.packed_depth = depth;
+                    } else {
+                        vert::logger->warn("converter.packed.output_depth must be 8 or 16, use default {}", cfg_.packed_depth);
+                    }
+                }
+                if (packed["gamma"] && packed["gamma"].as<double>() > 0) {
+                    cfg_.packed_gamma = packed["gamma"].as<double>();
+                }
+            }
+            vert::logger->info("converter.packed output_depth {} gamma {}", cfg_.packed_depth, cfg_.packed_gamma);
+
+            if (cfg_.converter_choice == ConverterChoice::Pylon || cfg_.converter_choice == ConverterChoice::Native) {
                 if (config["converter"]["num_threads"] && config["converter"]["num_threads"].as<int>() > 0) {
                     cfg_.pylon_thread_num = config["converter"]["num_threads"].as<int>();
                 }
-                converter_.MaxNumThreads.TrySetValue(cfg_.pylon_thread_num);
-                vert::logger->info("converter.MaxNumThreads set to {}", converter_.MaxNumThreads.GetValue());
+                vert::logger->info("converter.MaxNumThreads set to {}", cfg_.pylon_thread_num);
             } else if (cfg_.converter_choice == ConverterChoice::OpenCV) {
                 if (config["converter"]["demosaicing_flag"]) {
                     int flag = config["converter"]["demosaicing_flag"].as<int>();
@@ -119,6 +173,85 @@ bool vert::CameraAdapter::init(const YAML::Node &config)
             vert::logger->warn("converter not provided, use default {}", (int)cfg_.converter_choice);
         }
 
+        if (cfg_.converter_choice == ConverterChoice::Raw && cfg_.meta_encoding != MetaEncoding::Binary) {
+            // msgpack MatMeta has no pixel_type / padding_x to describe a raw buffer
+            vert::logger->warn("{} forwards raw frames, meta_encoding set to binary", name_);
+            cfg_.meta_encoding = MetaEncoding::Binary;
+        }
+        if (vert::meta_encoding_for(cfg_.meta_encoding, node_address) != cfg_.meta_encoding) {
+            if (cfg_.converter_choice == ConverterChoice::Raw) {
+                vert::logger->critical("Failed to init '{}'. Reason: raw frames need an inproc:// port.to_node, not {}", name_, node_address);
+                return false;
+            }
+            vert::logger->warn("{} port.to_node {} leaves the process, meta_encoding set to msgpack", name_, node_address);
+            cfg_.meta_encoding = MetaEncoding::Msgpack;
+        }
+
+        if (config["output_pool"]) {
+            const auto& pool = config["output_pool"];
+            if (pool["num_buffers"]) {
+                cfg_.pool_buffers = static_cast<size_t>(max(0, pool["num_buffers"].as<int>()));
+            }
+            if (pool["max_wait_ms"]) {
+                cfg_.pool_wait_ms = max(0, pool["max_wait_ms"].as<int>());
+            }
+            if (pool["hugepages"]) {
+                cfg_.pool_hugepages = pool["hugepages"].as<bool>();
+            }
+        } else {
+            vert::logger->warn("output_pool not provided, use default {} buffers", cfg_.pool_buffers);
+        }
+
+        if (config["preview"] && config["preview"]["scale"]) {
+            int scale = config["preview"]["scale"].as<int>();
+            if (vert::is_valid_downscale_factor(scale)) {
+                cfg_.preview_scale = scale;
+            } else {
+                vert::logger->warn("preview.scale must be 1, 2, 4 or 8, use default {}", cfg_.preview_scale);
+            }
+        } else {
+            vert::logger->warn("preview.scale not provided, use default {}", cfg_.preview_scale);
+        }
+        if (!ui_preview_.init(ui_address, config["preview"], name_)) {
+            return false;
+        }
+        if (!correction_.init(config["correction"], name_)) {
+            return false;
+        }
+        if (correction_.enabled() && cfg_.converter_choice == ConverterChoice::Raw) {
+            vert::logger->warn("{} forwards raw frames, correction is left to the consumers", name_);
+        }
+
+        if (cfg_.packed_depth == 8 && cfg_.packed_gamma != 1.0) {
+            for (int i = 0; i < 2; ++i) {
+                int bits = i == 0 ? 10 : 12;
+                double max_in = (1 << bits) - 1;
+                tone_lut_[i].resize(size_t(1) << bits);
+                for (size_t v = 0; v < tone_lut_[i].size(); ++v) {
+                    tone_lut_[i][v] = cv::saturate_cast<uint8_t>(255.0 * std::pow(v / max_in, 1.0 / cfg_.packed_gamma));
+                }
+            }
+        }
+
+        workers_.clear();
+        for (int i = 0; i < cfg_.num_workers; ++i) {
+            auto worker = std::make_unique<Worker>();
+            worker->converter.OutputOrientation = Pylon::OutputOrientation_Unchanged;
+            worker->converter.MaxNumThreads.TrySetValue(cfg_.pylon_thread_num);
+            workers_.push_back(std::move(worker));
+        }
+        if (cfg_.queue_size == 0) {
+            cfg_.queue_size = 2 * cfg_.num_workers + 2;
+        }
+        if (cfg_.pool_buffers > 0 && cfg_.pool_buffers <= static_cast<size_t>(cfg_.num_workers)) {
+            vert::logger->warn("{} output_pool.num_buffers {} leaves nothing for subscribers with {} workers", name_, cfg_.pool_buffers, cfg_.num_workers);
+        }
+        band_pool_.reset();
+        if (cfg_.num_bands > 1) {
+            band_pool_ = std::make_unique<BandPool>(cfg_.num_bands - 1, name_ + "/band");
+        }
+        vert::logger->info("{} converting on {} workers, {} frames in flight, {} bands per frame", name_, cfg_.num_workers, cfg_.queue_size, cfg_.num_bands);
+
     } catch (const YAML::Exception& e) {
         vert::logger->critical("Failed to init {}. Reason: {}", name_, e.what());
         return false;
@@ -135,8 +268,25 @@ void vert::CameraAdapter::start()
 {
     vert::logger->info("{} starting...", name_);
     if (!is_running_) {
+        num_frames_ = cfg_.queue_size;
+        frames_.reset(new Frame[num_frames_]);
+        free_frames_ = std::make_unique<MpmcQueue<int>>(num_frames_);
+        to_convert_ = std::make_unique<MpmcQueue<int>>(num_frames_);
+        converted_ = std::make_unique<MpmcQueue<int>>(num_frames_);
+        for (size_t i = 0; i < num_frames_; ++i) {
+            free_frames_->try_push(static_cast<int>(i));
+        }
+        reorder_.assign(num_frames_, -1);
+        next_recv_seq_ = 0;
+        next_send_seq_ = 0;
+
         is_running_ = true;
-        loop_thread_ = std::thread(&CameraAdapter::loop, this);
+        ui_preview_.start();
+        send_thread_ = std::thread(&CameraAdapter::send_loop, this);
+        for (size_t i = 0; i < workers_.size(); ++i) {
+            workers_[i]->thread = std::thread(&CameraAdapter::convert_loop, this, std::ref(*workers_[i]), static_cast<int>(i));
+        }
+        recv_thread_ = std::thread(&CameraAdapter::recv_loop, this);
         vert::logger->info("{} started", name_);
     }
 }
@@ -146,8 +296,31 @@ void vert::CameraAdapter::stop()
     vert::logger->info("{} stopping...", name_);
     if (is_running_) {
         is_running_ = false;
-        if (loop_thread_.joinable()) {
-            loop_thread_.join();
+        if (recv_thread_.joinable()) {
+            recv_thread_.join();
+        }
+        for (auto &worker : workers_) {
+            if (worker->thread.joinable()) {
+                worker->thread.join();
+            }
+        }
+        if (send_thread_.joinable()) {
+            send_thread_.join();
+        }
+        ui_preview_.stop();
+        // frames still queued were never published
+        for (size_t i = 0; i < num_frames_; ++i) {
+            recycle(frames_[i]);
+        }
+
+        queue_wait_.report(name_, "queue wait");
+        convert_time_.report(name_, "convert");
+        reorder_wait_.report(name_, "reorder wait");
+        if (pool_exhausted_ > 0) {
+            vert::logger->warn("{} output pool ran dry {} times, {} frames dropped", name_, pool_exhausted_.load(), dropped_count_.load());
+        }
+        if (preview_skipped_ > 0) {
+            vert::logger->warn("{} preview pool ran dry, {} frames not sent to the UI", name_, preview_skipped_.load());
         }
         vert::logger->info("{} stopped", name_);
     }
@@ -161,131 +334,586 @@ cv::Mat vert::CameraAdapter::get_curr_image() const
     return cv::Mat();
 }
 
-void vert::CameraAdapter::loop()
+bool vert::CameraAdapter::wait_pop(MpmcQueue<int> &queue, int &index) const
 {
+    // stages hand over within microseconds under load, only back off to sleeping when idle
+    for (int spins = 0; is_running_; ++spins) {
+        if (queue.try_pop(index))
+            return true;
+        if (spins < 64) {
+            std::this_thread::yield();
+        } else {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+    }
+    return false;
+}
+
+void vert::CameraAdapter::recv_loop()
+{
+    vert::set_current_thread_name(name_ + "/recv");
+
+    int index = -1;
+    while (is_running_) {
+        // no free frame: everything is in flight, leave new frames queued in zmq
+        if (index < 0 && !wait_pop(*free_frames_, index))
+            break;
+
+        Frame &frame = frames_[index];
+        if (!recv(frame)) {
+            frame.msgs.clear();
+            continue;
+        }
+
+        frame.seq = next_recv_seq_++;
+        to_convert_->push_spin(index); // holds every frame, never full for more than a moment
+        index = -1;
+    }
+
+    if (index >= 0) {
+        free_frames_->push_spin(index);
+    }
+}
+
+void vert::CameraAdapter::convert_loop(Worker &worker, int index)
+{
+    vert::set_current_thread_name(name_ + "/cvt" + std::to_string(index));
+
+    int frame_index = -1;
+    while (wait_pop(*to_convert_, frame_index)) {
+        Frame &frame = frames_[frame_index];
+
+        frame.convert_begin_ns = vert::steady_now_ns();
+        frame.to_ui = ui_preview_.claim(frame.recv_ns);
+        frame.converted = convert(worker, frame);
+        if (frame.converted) {
+            make_preview(worker, frame);
+        }
+        frame.convert_end_ns = vert::steady_now_ns();
+
+        queue_wait_.add(frame.convert_begin_ns - frame.recv_ns);
+        if (frame.converted) {
+            convert_time_.add(frame.convert_end_ns - frame.convert_begin_ns);
+        } else {
+            dropped_count_++;
+        }
+
+        converted_->push_spin(frame_index); // holds every frame, never full for more than a moment
+    }
+}
+
+void vert::CameraAdapter::send_loop()
+{
+    vert::set_current_thread_name(name_ + "/send");
+
 #ifdef VERT_DEBUG_WINDOW
     cv::namedWindow(WINDOW_NAME_SRC, cv::WINDOW_AUTOSIZE | cv::WINDOW_KEEPRATIO | cv::WINDOW_GUI_EXPANDED);
     cv::namedWindow(WINDOW_NAME, cv::WINDOW_AUTOSIZE | cv::WINDOW_KEEPRATIO | cv::WINDOW_GUI_EXPANDED);
 #endif
 
-    while (is_running_) {
-        recv();
+    int index = -1;
+    while (wait_pop(*converted_, index)) {
+        // at most num_frames_ frames exist, so pending seqs never collide modulo num_frames_
+        reorder_[frames_[index].seq % num_frames_] = index;
+
+        // publish everything that is next in line, a slow worker holds back the frames behind it
+        while ((index = reorder_[next_send_seq_ % num_frames_]) >= 0) {
+            reorder_[next_send_seq_ % num_frames_] = -1;
+            next_send_seq_++;
 
+            Frame &frame = frames_[index];
+            if (frame.converted) {
 #ifdef VERT_DEBUG_WINDOW
-        display();
+                display(frame);
 #endif
-        send();
+                reorder_wait_.add(vert::steady_now_ns() - frame.convert_end_ns);
+                send(frame);
+            }
+            recycle(frame);
+            free_frames_->push_spin(index);
+        }
     }
 }
 
-void vert::CameraAdapter::recv()
+bool vert::CameraAdapter::recv(Frame &frame)
 {
-    vector<zmq::message_t> msgs;
-    zmq::recv_result_t result = zmq::recv_multipart(subscriber_, std::back_inserter(msgs));
+    frame.msgs.clear();
+    zmq::recv_result_t result = zmq::recv_multipart(subscriber_, std::back_inserter(frame.msgs));
     if (!result)
-        return;    
+        return false;
+    frame.recv_ns = vert::steady_now_ns();
     // assert(result && "recv failed");
     assert(*result == 2);
 
-    auto meta = msgpack::unpack<vert::GrabMeta>(static_cast<const uint8_t *>(msgs[0].data()), msgs[0].size());
+    vert::FrameHeader meta;
+    if (!vert::decode_grab_meta(frame.msgs[0].data(), frame.msgs[0].size(), meta)) {
+        vert::logger->error("{} failed to decode grab meta ({} bytes)", name_, frame.msgs[0].size());
+        return false;
+    }
     auto src_type = static_cast<Pylon::EPixelType>(meta.pixel_type);
 
-    img_meta_ = MatMeta{meta.device_id, meta.id, meta.height, meta.width, get_output_cv_type(src_type), get_output_cn(src_type), meta.timestamp, meta.error_cnt};
+    frame.meta = meta;
+    frame.meta.cv_type = get_output_cv_type(src_type);
+    frame.meta.cn = get_output_cn(src_type);
+    frame.meta.bit_depth = get_output_bit_depth(src_type);
+    vert::stamp_frame(frame.meta, node_, vert::StampEvent::Ingress, frame.recv_ns);
 
-    vert::logger->debug("Recv from Device: {} Image ID: {} Timestamp: {} ({} x {} {}) Error: {}", meta.device_id, meta.id, meta.timestamp, meta.width, meta.height, vert::pixel_type_to_string(src_type), meta.error_cnt);
+    vert::logger->debug("Recv from Device: {} Image ID: {} Timestamp: {} ({} x {} {}) Error: {}", vert::device_name(meta.device), meta.id, meta.timestamp, meta.width, meta.height, vert::pixel_type_to_string(src_type), meta.error_cnt);
 
 #ifdef VERT_DEBUG_WINDOW
-    cv::Mat temp = cv::Mat(meta.height, meta.width, vert::pixel_type_to_cv_type(src_type), msgs[1].data()).clone();
-    cv::imshow(WINDOW_NAME_SRC, temp);
+    if (vert::pixel_type_to_cv_type(src_type) != -1) {
+        cv::Mat temp = cv::Mat(meta.height, meta.width, vert::pixel_type_to_cv_type(src_type), frame.msgs[1].data()).clone();
+        cv::imshow(WINDOW_NAME_SRC, temp);
+    }
 #endif
 
-    vert::logger->debug("{} ---convert--> {}", vert::pixel_type_to_string(src_type), vert::cv_type_to_str(img_meta_.cv_type));
-    convert(msgs[1].data(), meta, src_type);
-
+    return true;
 }
 
-void vert::CameraAdapter::cv_convert(void *buffer, const vert::GrabMeta &meta, Pylon::EPixelType src_type)
+bool vert::CameraAdapter::cv_convert(Frame &frame)
 {
+    const vert::FrameHeader &meta = frame.meta;
+    auto src_type = static_cast<Pylon::EPixelType>(meta.pixel_type);
     int src_cv_type = vert::pixel_type_to_cv_type(src_type);
     assert(src_cv_type != -1);
 
-    img_raw_ = cv::Mat(meta.height, meta.width, src_cv_type, buffer);
+    cv::Mat img_raw(meta.height, meta.width, src_cv_type, frame.msgs[1].data());
 
     if (Pylon::IsMonoImage(src_type)) {
-        img_cvt_ = img_raw_;
-        // img_raw_.copyTo(img_cvt_);
+        frame.img_cvt = img_raw;
+        frame.passthrough = true;
     } else if (Pylon::IsBayer(src_type)) {
 #ifdef USE_CUDA_DEBAYERING
 
 #else
         int code = get_bayer_code(src_type);
         assert(code != -1);
-        cv::demosaicing(img_raw_, img_cvt_, code);
+        if (!prepare_output(frame, CV_8UC3))
+            return false;
+        cv_demosaic(img_raw, frame.img_cvt, code);
 #endif
     } else if (Pylon::IsBGR(src_type) || Pylon::IsBGRPacked(src_type)) {
-        img_cvt_ = img_raw_;
-        // img_raw_.copyTo(img_cvt_);
+        frame.img_cvt = img_raw;
+        frame.passthrough = true;
     } else if (Pylon::IsRGB(src_type) || Pylon::IsRGBPacked(src_type)) {
-        cv::cvtColor(img_raw_, img_cvt_, cv::COLOR_RGB2BGR);
+        if (!prepare_output(frame, CV_8UC3))
+            return false;
+        cv::cvtColor(img_raw, frame.img_cvt, cv::COLOR_RGB2BGR);
     } else {
         assert(false);
     }
 
+    return true;
 }
 
-void vert::CameraAdapter::pylon_convert(void *buffer, const vert::GrabMeta &meta, Pylon::EPixelType src_type)
+bool vert::CameraAdapter::pylon_convert(Worker &worker, Frame &frame)
 {
+    const vert::FrameHeader &meta = frame.meta;
+    auto src_type = static_cast<Pylon::EPixelType>(meta.pixel_type);
+    Pylon::CImageFormatConverter &converter = worker.converter;
+
     Pylon::EPixelType dst_type = get_output_pylon_type(src_type);
-    assert(converter_.IsSupportedOutputFormat(dst_type));
-    converter_.OutputPixelFormat = dst_type;
+    assert(converter.IsSupportedOutputFormat(dst_type));
+    converter.OutputPixelFormat = dst_type;
 
-    if (converter_.ImageHasDestinationFormat(src_type, meta.padding_x, src_orientation_)) {
+    if (converter.ImageHasDestinationFormat(src_type, meta.padding_x, src_orientation_)) {
         int src_cv_type = vert::pixel_type_to_cv_type(src_type);
         assert(src_cv_type != -1);
-        img_raw_ = cv::Mat(meta.height, meta.width, src_cv_type, buffer);
-        img_cvt_ = img_raw_;
-
-    } 
+        frame.img_cvt = cv::Mat(meta.height, meta.width, src_cv_type, frame.msgs[1].data());
+        frame.passthrough = true;
+    }
     else {
-        converter_.Convert(pylon_image_, buffer, meta.buffer_size, src_type, meta.width, meta.height, meta.padding_x, src_orientation_);
-        int dst_cv_type = -1;
-        if (Pylon::IsMonoImage(src_type))
-            dst_cv_type = CV_8UC1;
-        else if (Pylon::IsColorImage(src_type))
-            dst_cv_type = CV_8UC3;
+        int dst_cv_type = get_output_cv_type(src_type);
         assert(dst_cv_type != -1);
-        img_cvt_ = cv::Mat(meta.height, meta.width, dst_cv_type, pylon_image_.GetBuffer());
+        // convert straight into the buffer that is published, no intermediate CPylonImage
+        if (!prepare_output(frame, dst_cv_type))
+            return false;
+        converter.Convert(frame.img_cvt.data, frame.img_cvt.total() * frame.img_cvt.elemSize(),
+                          frame.msgs[1].data(), meta.buffer_size, src_type, meta.width, meta.height, meta.padding_x, src_orientation_);
     }
+    return true;
 }
 
-void vert::CameraAdapter::convert(void *buffer, const vert::GrabMeta &meta, Pylon::EPixelType src_type)
+bool vert::CameraAdapter::native_convert(Worker &worker, Frame &frame)
 {
-    if (cfg_.converter_choice == ConverterChoice::Pylon) {
-        pylon_convert(buffer, meta, src_type);
+    const vert::FrameHeader &meta = frame.meta;
+    vert::BayerPattern pattern;
+    if (!vert::pixel_type_to_bayer_pattern(meta.pixel_type, pattern))
+        return pylon_convert(worker, frame);
+
+    return native_debayer(frame, static_cast<const uint8_t *>(frame.msgs[1].data()), meta.width + meta.padding_x, pattern);
+}
+
+bool vert::CameraAdapter::native_debayer(Frame &frame, const uint8_t *src, size_t src_stride, BayerPattern pattern)
+{
+    const vert::FrameHeader &meta = frame.meta;
+    if (!prepare_output(frame, CV_8UC3))
+        return false;
+    bool with_preview = frame.to_ui && cfg_.preview_scale > 1 && prepare_preview(frame, CV_8UC3);
+    const PhotometricCorrection::Tables *correction = frame.correction;
+    frame.correction = nullptr; // applied here on the way
+    // band edges on whole preview rows (and even rows, for the Bayer phase); neighbours are read across them,
+    // so the native kernel needs no halo
+    int align = max(2, cfg_.preview_scale);
+    auto band = [&](int b) {
+        auto [begin, end] = vert::band_rows(b, cfg_.num_bands, meta.height, align);
+        if (correction) {
+            // debayer, correct and downscale a few rows at a time, each step reads what the one before left in cache
+            constexpr int kChunkRows = 16;
+            int chunk = (kChunkRows + align - 1) / align * align;
+            for (int y = begin; y < end; y += chunk) {
+                int y_end = min(end, y + chunk);
+                vert::debayer_bilinear_rows(src, src_stride, frame.img_cvt.data, frame.img_cvt.step, meta.width, meta.height, pattern,
+                                            y, y_end, cfg_.native_simd);
+                PhotometricCorrection::apply(*correction, frame.img_cvt, frame.img_cvt, y, y_end, cfg_.native_simd);
+                if (with_preview) {
+                    vert::box_downscale_rows(frame.img_cvt.data, frame.img_cvt.step, meta.width, 3, cfg_.preview_scale,
+                                             frame.preview.data, frame.preview.step, y / cfg_.preview_scale, y_end / cfg_.preview_scale);
+                }
+            }
+        } else if (with_preview) {
+            // preview rows are filtered while the full resolution rows are still in cache
+            vert::debayer_bilinear_preview_rows(src, src_stride, frame.img_cvt.data, frame.img_cvt.step, meta.width, meta.height, pattern,
+                                                cfg_.preview_scale, frame.preview.data, frame.preview.step, begin, end, cfg_.native_simd);
+        } else {
+            vert::debayer_bilinear_rows(src, src_stride, frame.img_cvt.data, frame.img_cvt.step, meta.width, meta.height, pattern,
+                                        begin, end, cfg_.native_simd);
+        }
+    };
+    run_bands(band);
+    return true;
+}
+
+bool vert::CameraAdapter::unpack(const Frame &frame, int bits, cv::Mat &dst) const
+{
+    const vert::FrameHeader &meta = frame.meta;
+    const auto *src = static_cast<const uint8_t *>(frame.msgs[1].data());
+    size_t src_size = frame.msgs[1].size();
+    const auto &tone_lut = tone_lut_[bits == 12 ? 1 : 0];
+    bool ok = dst.depth() == CV_16U
+        ? vert::unpack_image_to_16(src, src_size, meta.width, meta.height, meta.padding_x, bits,
+                                   dst.ptr<uint16_t>(), dst.step, cfg_.native_simd)
+        : vert::unpack_image_to_8(src, src_size, meta.width, meta.height, meta.padding_x, bits,
+                                  dst.ptr<uint8_t>(), dst.step, tone_lut.empty() ? nullptr : tone_lut.data(), cfg_.native_simd);
+    if (!ok) {
+        vert::logger->error("{} cannot unpack frame {}: {} bytes for {} x {} at {} bit, padding {}", name_, meta.id,
+                            src_size, meta.width, meta.height, bits, meta.padding_x);
+    }
+    return ok;
+}
+
+bool vert::CameraAdapter::unpack_convert(Worker &worker, Frame &frame)
+{
+    const vert::FrameHeader &meta = frame.meta;
+    auto src_type = static_cast<Pylon::EPixelType>(meta.pixel_type);
+    int bits = vert::packed_bit_depth(src_type);
+    bool wide = cfg_.packed_depth == 16;
+
+    if (Pylon::IsMonoImage(src_type)) {
+        if (!prepare_output(frame, wide ? CV_16UC1 : CV_8UC1))
+            return false;
+        return unpack(frame, bits, frame.img_cvt);
+    }
+
+    vert::BayerPattern pattern;
+    if (!vert::pixel_type_to_bayer_pattern(src_type, pattern)) {
+        assert(false);
+        return false;
+    }
+    worker.unpacked.create(meta.height, meta.width, wide ? CV_16UC1 : CV_8UC1);
+    if (!unpack(frame, bits, worker.unpacked))
+        return false;
+    if (!wide)
+        return native_debayer(frame, worker.unpacked.data, worker.unpacked.step, pattern);
+
+    // the native kernel is 8 bit only, OpenCV's bilinear takes CV_16U
+    if (!prepare_output(frame, CV_16UC3))
+        return false;
+    cv_demosaic(worker.unpacked, frame.img_cvt, vert::cv_bayer_to_bgr_code(pattern));
+    return true;
+}
+
+void vert::CameraAdapter::cv_demosaic(const cv::Mat &src, cv::Mat &dst, int code)
+{
+    if (!band_pool_) {
+        cv::demosaicing(src, dst, code);
+        return;
+    }
+    // each band is demosaiced with kHalo extra rows on both sides (even, so the pattern does not shift)
+    // and only its own rows are kept, band edges come out as in one full frame pass
+    constexpr int kHalo = 4;
+    band_pool_->run(cfg_.num_bands, [&](int band) {
+        auto [begin, end] = vert::band_rows(band, cfg_.num_bands, src.rows);
+        if (begin >= end)
+            return;
+        int top = max(0, begin - kHalo);
+        int bottom = min(src.rows, end + kHalo);
+        thread_local cv::Mat band_dst;
+        cv::demosaicing(src.rowRange(top, bottom), band_dst, code);
+        band_dst.rowRange(begin - top, end - top).copyTo(dst.rowRange(begin, end));
+    });
+}
+
+bool vert::CameraAdapter::convert(Worker &worker, Frame &frame)
+{
+    vert::logger->debug("{} ---convert--> {}", vert::pixel_type_to_string(static_cast<Pylon::EPixelType>(frame.meta.pixel_type)), vert::cv_type_to_str(frame.meta.cv_type));
+
+    if (cfg_.converter_choice == ConverterChoice::Raw) {
+        frame.passthrough = true;
+        return true;
+    }
+
+    const vert::FrameHeader &meta = frame.meta;
+    frame.correction = correction_.tables(meta.height, meta.width, meta.cn, meta.bit_depth);
+
+    bool converted = false;
+    if (vert::packed_bit_depth(meta.pixel_type) != 0) {
+        converted = unpack_convert(worker, frame);
+    } else if (cfg_.converter_choice == ConverterChoice::Pylon) {
+        converted = pylon_convert(worker, frame);
+    } else if (cfg_.converter_choice == ConverterChoice::Native) {
+        converted = native_convert(worker, frame);
     } else if (cfg_.converter_choice == ConverterChoice::OpenCV) {
-        cv_convert(buffer, meta, src_type);
+        converted = cv_convert(frame);
     } else {
         assert(false);
     }
+    return converted && correct(frame);
+}
+
+bool vert::CameraAdapter::correct(Frame &frame)
+{
+    if (!frame.correction)
+        return true;
+    const PhotometricCorrection::Tables &tables = *frame.correction;
+    frame.correction = nullptr;
+
+    cv::Mat src = frame.img_cvt;
+    if (frame.passthrough) {
+        if (!prepare_output(frame, src.type()))
+            return false;
+        frame.passthrough = false;
+    }
+    run_bands([&](int b) {
+        auto [begin, end] = vert::band_rows(b, cfg_.num_bands, src.rows);
+        PhotometricCorrection::apply(tables, src, frame.img_cvt, begin, end, cfg_.native_simd);
+    });
+    return true;
+}
+
+void vert::CameraAdapter::run_bands(const std::function<void(int)> &band)
+{
+    if (band_pool_) {
+        band_pool_->run(cfg_.num_bands, band);
+    } else {
+        band(0);
+    }
 }
 
-void vert::CameraAdapter::display()
+vert::BufferPool::Ptr vert::CameraAdapter::output_pool(BufferPool::Ptr &pool, size_t needed, const char *what)
 {
-    cv::imshow(WINDOW_NAME, img_cvt_);
+    std::lock_guard<std::mutex> lock(pool_mutex_);
+    if (!pool || pool->buffer_size() < needed) {
+        // frames in flight keep the old pool alive until they are released
+        pool = BufferPool::create(cfg_.pool_buffers, needed, cfg_.pool_hugepages);
+        if (!pool) {
+            vert::logger->error("{} failed to allocate {} {} buffers of {} bytes", name_, cfg_.pool_buffers, what, needed);
+            return nullptr;
+        }
+        vert::logger->info("{} {} pool: {} buffers of {} KB{}", name_, what, pool->num_buffers(), needed / 1024,
+                           pool->is_huge() ? ", huge pages" : "");
+    }
+    return pool->share();
+}
+
+bool vert::CameraAdapter::prepare_output(Frame &frame, int cv_type)
+{
+    int height = frame.meta.height;
+    int width = frame.meta.width;
+    if (cfg_.pool_buffers == 0) {
+        frame.img_cvt.create(height, width, cv_type);
+        return true;
+    }
+
+    frame.pool = output_pool(pool_, kSlotImageOffset + static_cast<size_t>(height) * width * CV_ELEM_SIZE(cv_type), "output");
+    if (!frame.pool)
+        return false;
+
+    frame.slot = frame.pool->acquire();
+    if (frame.slot < 0) {
+        // every buffer is still held downstream, give consumers a moment before dropping
+        pool_exhausted_++;
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(cfg_.pool_wait_ms);
+        while (frame.slot < 0 && is_running_ && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+            frame.slot = frame.pool->acquire();
+        }
+        if (frame.slot < 0) {
+            vert::logger->debug("{} output pool exhausted, frame dropped", name_);
+            return false;
+        }
+    }
+
+    frame.img_cvt = cv::Mat(height, width, cv_type, frame.pool->data(frame.slot) + kSlotImageOffset);
+    return true;
+}
+
+bool vert::CameraAdapter::prepare_preview(Frame &frame, int cv_type)
+{
+    int height = vert::downscaled_size(frame.meta.height, cfg_.preview_scale);
+    int width = vert::downscaled_size(frame.meta.width, cfg_.preview_scale);
+    if (height == 0 || width == 0)
+        return false;
+    if (cfg_.pool_buffers == 0) {
+        frame.preview.create(height, width, cv_type);
+        return true;
+    }
+
+    frame.preview_pool = output_pool(preview_pool_, kSlotImageOffset + static_cast<size_t>(height) * width * CV_ELEM_SIZE(cv_type), "preview");
+    if (!frame.preview_pool)
+        return false;
+    frame.preview_slot = frame.preview_pool->acquire();
+    if (frame.preview_slot < 0) {
+        preview_skipped_++;
+        frame.preview_pool.reset();
+        return false;
+    }
+
+    frame.preview = cv::Mat(height, width, cv_type, frame.preview_pool->data(frame.preview_slot) + kSlotImageOffset);
+    return true;
+}
+
+void vert::CameraAdapter::make_preview(Worker &worker, Frame &frame)
+{
+    if (cfg_.converter_choice == ConverterChoice::Raw) {
+        if (!frame.to_ui)
+            return;
+        vert::LazyFrame lazy(frame.meta, frame.msgs[1].data(), frame.msgs[1].size(), cfg_.native_simd);
+        const cv::Mat &view = Pylon::IsMonoImage(static_cast<Pylon::EPixelType>(frame.meta.pixel_type)) ? lazy.gray() : lazy.bgr();
+        if (view.empty())
+            return;
+        if (cfg_.preview_scale == 1) {
+            // the received buffer is recycled after send(), the UI needs its own pixels
+            frame.preview = view.u ? view : view.clone();
+        } else if (prepare_preview(frame, view.type())) {
+            vert::box_downscale(view.data, view.step, view.cols, view.rows, view.channels(), cfg_.preview_scale,
+                                frame.preview.data, frame.preview.step);
+        }
+        return;
+    }
+    if (!frame.to_ui || cfg_.preview_scale == 1 || !frame.preview.empty())
+        return;
+    const cv::Mat &img = frame.img_cvt;
+    if (img.depth() == CV_16U) {
+        // unpacked 10 / 12 bit frames, the UI gets their top 8 bits
+        if (!prepare_preview(frame, CV_MAKETYPE(CV_8U, img.channels())))
+            return;
+        // same size every frame, resize() writes into the buffer of the last one
+        cv::resize(img, worker.preview16, frame.preview.size(), 0, 0, cv::INTER_AREA);
+        worker.preview16.convertTo(frame.preview, CV_8U, 1.0 / (1 << (frame.meta.bit_depth - 8)));
+        return;
+    }
+    if (!prepare_preview(frame, img.type()))
+        return;
+    vert::box_downscale(img.data, img.step, img.cols, img.rows, img.channels(), cfg_.preview_scale,
+                        frame.preview.data, frame.preview.step);
+}
+
+void vert::CameraAdapter::recycle(Frame &frame)
+{
+    frame.img_cvt.release();
+    if (frame.slot >= 0) {
+        frame.pool->give_back(frame.slot);
+        frame.slot = -1;
+    }
+    frame.pool.reset();
+    frame.preview.release();
+    if (frame.preview_slot >= 0) {
+        frame.preview_pool->give_back(frame.preview_slot);
+        frame.preview_slot = -1;
+    }
+    frame.preview_pool.reset();
+    frame.correction = nullptr;
+    frame.passthrough = false;
+    frame.converted = false;
+    frame.to_ui = false;
+    frame.msgs.clear(); // lets the camera reuse its grab buffer
+}
+
+void vert::CameraAdapter::display(const Frame &frame)
+{
+    if (frame.img_cvt.empty())
+        return;
+    cv::imshow(WINDOW_NAME, frame.img_cvt);
     cv::waitKey(1);
 }
 
-void vert::CameraAdapter::send()
+void vert::CameraAdapter::send(Frame &frame)
 {
-    auto meta_data = msgpack::pack(img_meta_);
-    zmq::message_t meta_msg(meta_data.data(), meta_data.size());
-    publisher_.send(meta_msg, zmq::send_flags::sndmore);
+    vert::FrameHeader &meta = frame.meta;
+    vert::stamp_frame(meta, node_, vert::StampEvent::Egress);
 
+    zmq::message_t meta_msg;
     zmq::message_t img_msg;
-    img_msg.rebuild(img_cvt_.data ,img_cvt_.total() * img_cvt_.elemSize());
+    make_messages(meta, frame.img_cvt, frame.pool.get(), frame.slot, frame.passthrough ? &frame.msgs[1] : nullptr, meta_msg, img_msg);
+
+    // the UI gets its own reference to the pixels, the sender thread encodes them off this path
+    zmq::message_t ui_img_msg;
+    vert::FrameHeader ui_meta = meta;
+    if (frame.to_ui && !frame.preview.empty()) {
+        ui_meta.width = frame.preview.cols;
+        ui_meta.height = frame.preview.rows;
+        ui_meta.padding_x = 0;
+        ui_meta.cv_type = frame.preview.type();
+        ui_meta.cn = static_cast<uint8_t>(frame.preview.channels());
+        ui_meta.bit_depth = 8;
+        ui_meta.buffer_size = frame.preview.total() * frame.preview.elemSize();
+        size_t size = static_cast<size_t>(ui_meta.buffer_size);
+        if (frame.preview_slot >= 0) {
+            frame.preview_pool->publish(frame.preview_slot, 1);
+            ui_img_msg = frame.preview_pool->make_message(frame.preview_slot, frame.preview.data, size);
+            frame.preview_slot = -1;
+        } else {
+            ui_img_msg = vert::make_owned_message(frame.preview.data, size, frame.preview);
+        }
+    } else if (frame.to_ui && cfg_.preview_scale == 1) {
+        ui_img_msg.copy(img_msg);
+    }
+
+    publisher_.send(meta_msg, zmq::send_flags::sndmore);
     publisher_.send(img_msg, zmq::send_flags::dontwait);
+    if (ui_img_msg.size() > 0) {
+        ui_preview_.offer(ui_meta, ui_img_msg);
+    }
 
-    vert::logger->debug("Send Image Device_ID: {} ID: {} Size: {}x{} Type: {} Timestamp: {} Error: {}", img_meta_.device_id, img_meta_.id, img_meta_.width, img_meta_.height, vert::cv_type_to_str(img_meta_.cv_type), img_meta_.timestamp, img_meta_.error_cnt);
+    vert::logger->debug("Send Image Device_ID: {} ID: {} Size: {}x{} Type: {} Timestamp: {} Error: {}", vert::device_name(meta.device), meta.id, meta.width, meta.height, vert::cv_type_to_str(meta.cv_type), meta.timestamp, meta.error_cnt);
+}
+
+void vert::CameraAdapter::make_messages(FrameHeader &meta, const cv::Mat &img, BufferPool *pool, int &slot, zmq::message_t *shared,
+                                        zmq::message_t &meta_msg, zmq::message_t &img_msg)
+{
+    size_t img_size = img.total() * img.elemSize();
+
+    if (slot >= 0) {
+        // binary meta lives in front of the image in the same slot, the slot is recycled after both
+        bool binary = cfg_.meta_encoding == MetaEncoding::Binary;
+        pool->publish(slot, binary ? 2 : 1);
+        if (binary) {
+            std::memcpy(pool->data(slot), &meta, sizeof(meta));
+            meta_msg = pool->make_message(slot, pool->data(slot), sizeof(meta));
+        } else {
+            meta_msg = vert::make_mat_meta_msg(meta, cfg_.meta_encoding);
+        }
+        img_msg = pool->make_message(slot, img.data, img_size);
+        slot = -1;
+    } else if (shared) {
+        meta_msg = vert::make_mat_meta_msg(meta, cfg_.meta_encoding);
+        img_msg.copy(*shared); // shares the received buffer, zmq refcounts it
+    } else {
+        meta_msg = vert::make_mat_meta_msg(meta, cfg_.meta_encoding);
+        // the message holds a Mat reference, the buffer lives as long as any subscriber needs it
+        img_msg = vert::make_owned_message(img.data, img_size, img);
+    }
 }
 
 int vert::CameraAdapter::get_bayer_code(Pylon::EPixelType from) const
@@ -320,7 +948,11 @@ bool vert::CameraAdapter::use_pylon_converter(Pylon::EPixelType from) const
 
 int vert::CameraAdapter::get_output_cv_type(Pylon::EPixelType from) const
 {
-    if (Pylon::IsMonoImage(from)) {
+    if (cfg_.converter_choice == ConverterChoice::Raw) {
+        return -1;
+    } else if (vert::packed_bit_depth(from) != 0 && cfg_.packed_depth == 16) {
+        return Pylon::IsMonoImage(from) ? CV_16UC1 : CV_16UC3;
+    } else if (Pylon::IsMonoImage(from)) {
         return CV_8UC1; 
     } else if (Pylon::IsColorImage(from)) {
         return CV_8UC3;
@@ -342,7 +974,9 @@ Pylon::EPixelType vert::CameraAdapter::get_output_pylon_type(Pylon::EPixelType f
 
 uint8_t vert::CameraAdapter::get_output_cn(Pylon::EPixelType from) const
 {
-    if (Pylon::IsMonoImage(from)) {
+    if (cfg_.converter_choice == ConverterChoice::Raw) {
+        return static_cast<uint8_t>(Pylon::SamplesPerPixel(from));
+    } else if (Pylon::IsMonoImage(from)) {
         return 1; 
     } else if (Pylon::IsColorImage(from)) {
         return 3; 
@@ -351,3 +985,10 @@ uint8_t vert::CameraAdapter::get_output_cn(Pylon::EPixelType from) const
         return -1;
     }
 }
+
+uint8_t vert::CameraAdapter::get_output_bit_depth(Pylon::EPixelType from) const
+{
+    int bits = vert::packed_bit_depth(from);
+    bool keeps_bits = cfg_.converter_choice == ConverterChoice::Raw || cfg_.packed_depth == 16;
+    return bits != 0 && keeps_bits ? static_cast<uint8_t>(bits) : 8;
+}
@@ -2,19 +2,41 @@
 #define _CAMERA_ADAPTER_H_
 #include <opencv2/core.hpp>
 #include <atomic>
+#include <functional>
 #include <thread>
+#include <memory>
 #include <mutex>
+#include <vector>
 #include <pylon/PylonIncludes.h>
 #include <yaml-cpp/yaml.h>
-#include "../utils/types.h"
+#include "../utils/frame_header.h"
+#include "../utils/buffer_pool.h"
+#include "../utils/debayer.h"
+#include "../utils/band_pool.h"
+#include "ui_preview_publisher.h"
+#include "photometric_correction.h"
+#include "../utils/mpmc_queue.h"
+#include "../utils/timer.h"
 #include "../third_party/zmq.hpp"
 
 /*
     TODO:
-    - compare converter performance: pylon thread num, opencv VNG, opencv EdgeAware
+    - compare converter performance: opencv VNG, opencv EdgeAware (native vs opencv vs pylon: test/bench_debayer)
     - mutex necessary? recv, get_curr_image, display, convert
     - BUG using opencv demosaicing (change to RGB can fix)
-    - LATER: need recv and send split to 2 threads?
+*/
+
+/*
+    Pipeline:
+        receiver ──to_convert_──> worker 0..N-1 ──converted_──> sequencer ──> publisher_
+           ^                                                        │
+           └──────────────────────── free_frames_ <─────────────────┘
+
+    A fixed ring of Frame objects circulates through bounded lock-free queues, only their indices move.
+    The receiver numbers frames in arrival order, workers convert in parallel (each with its own pylon
+    converter), the sequencer puts them back in that order before publishing, so every camera's ids
+    leave the adapter in the order they arrived. When all frames are in flight the receiver stops
+    pulling and back-pressure reaches the camera through the zmq high water mark.
 */
 
 namespace vert {
@@ -29,13 +51,55 @@ namespace vert {
 
         enum ConverterChoice {
             Pylon = 0,
-            OpenCV = 1 
+            OpenCV = 1,
+            Native = 2, // vert::debayer_bilinear for Bayer*8, pylon for the rest
+            Raw = 3     // forward the received buffer (cv_type -1), consumers convert what they need via vert::LazyFrame
         };
+        // packed 10 / 12 bit formats (Mono12p, BayerRG12p, ...) are always unpacked by vert::unpack_*,
+        // whichever converter is chosen, unless they are forwarded raw
 
         struct CameraAdapterConfig {
+            MetaEncoding meta_encoding = MetaEncoding::Binary;
             int pylon_thread_num = 1;
             CameraAdapter::DemosaicingFlag cv_demosacing_flag = CameraAdapter::DemosaicingFlag::Bilinear;
             CameraAdapter::ConverterChoice converter_choice = CameraAdapter::ConverterChoice::Pylon;
+            SimdLevel native_simd = SimdLevel::Best;
+            int num_workers = 1;      // converter threads
+            size_t queue_size = 0;    // frames in the pipeline at once, 0: 2 * num_workers + 2
+            int num_bands = 1;        // row bands of one frame demosaiced in parallel (native, opencv), 1: off
+            size_t pool_buffers = 8;  // converted frames held downstream at once, 0: allocate per frame
+            int pool_wait_ms = 5;     // back-pressure, wait this long for a free buffer before dropping
+            bool pool_hugepages = false;
+            int preview_scale = 4;    // UI gets 1/preview_scale of each side, 1: the full frame
+            int packed_depth = 8;     // packed formats to CV_16U (10 / 12 significant bits) or tone mapped CV_8U
+            double packed_gamma = 1.0; // 8 bit only, 1: keep the top 8 bits
+        };
+
+        // per frame state, owned by one stage at a time
+        struct Frame {
+            uint64_t seq = 0;                  // arrival order, output order
+            FrameHeader meta;                  // outgoing header, pixel_type still names the source format
+            std::vector<zmq::message_t> msgs;  // received meta + image, reused across frames
+            cv::Mat img_cvt;                   // pooled or fresh per frame, published zero-copy, empty for raw frames
+            const PhotometricCorrection::Tables *correction = nullptr; // still to be applied to img_cvt
+            BufferPool::Ptr pool;              // pool behind slot, alive until sent
+            int slot = -1;                     // slot behind img_cvt until send()
+            bool passthrough = false;          // img_cvt is the received buffer (msgs[1])
+            bool converted = false;            // false: dropped, the sequencer only recycles it
+            bool to_ui = false;                // claimed a UI preview slot (max_fps)
+            cv::Mat preview;                   // box filtered img_cvt for the UI, empty: none this frame
+            BufferPool::Ptr preview_pool;
+            int preview_slot = -1;
+            int64_t recv_ns = 0;
+            int64_t convert_begin_ns = 0;
+            int64_t convert_end_ns = 0;
+        };
+
+        struct Worker {
+            Pylon::CImageFormatConverter converter; // not thread safe, one per worker
+            cv::Mat unpacked;                       // packed Bayer frames before demosaicing, reused
+            cv::Mat preview16;                      // 16 bit frames downscaled for the UI, before the shift to 8 bit, reused
+            std::thread thread;
         };
 
     public:
@@ -51,19 +115,67 @@ namespace vert {
 
 
     private:
-        void loop();
+        void recv_loop();
+
+        void convert_loop(Worker &worker, int index);
+
+        void send_loop();
+
+        // false once stopped
+        bool wait_pop(MpmcQueue<int> &queue, int &index) const;
+
+        bool recv(Frame &frame);
+
+        bool cv_convert(Frame &frame);
+
+        bool pylon_convert(Worker &worker, Frame &frame);
+
+        bool native_convert(Worker &worker, Frame &frame);
 
-        void recv();
+        // Bayer*8 rows at src into img_cvt (and the preview on the way)
+        bool native_debayer(Frame &frame, const uint8_t *src, size_t src_stride, BayerPattern pattern);
 
-        void cv_convert(void *buffer, const vert::GrabMeta &meta, Pylon::EPixelType src_type);
+        bool unpack_convert(Worker &worker, Frame &frame);
 
-        void pylon_convert(void *buffer, const vert::GrabMeta &meta, Pylon::EPixelType src_type);
+        // cv::demosaicing into the preallocated dst, in row bands on band_pool_ when num_bands > 1
+        void cv_demosaic(const cv::Mat &src, cv::Mat &dst, int code);
 
-        void convert(void *buffer, const vert::GrabMeta &meta, Pylon::EPixelType src_type);
+        // packed rows of the received buffer into dst (CV_16UC1 or CV_8UC1, sized by the caller)
+        bool unpack(const Frame &frame, int bits, cv::Mat &dst) const;
 
-        void display();
+        bool convert(Worker &worker, Frame &frame);
+
+        // applies frame.correction unless the converter already did on the way, banded like the conversion;
+        // passthrough frames are corrected into an output buffer, the received one belongs to the camera
+        bool correct(Frame &frame);
+
+        // band(b) for b in [0, num_bands) on band_pool_, or band(0) without one
+        void run_bands(const std::function<void(int)> &band);
+
+        // points frame.img_cvt at a pooled buffer (or a fresh Mat without pool), false if the pool stays exhausted
+        bool prepare_output(Frame &frame, int cv_type);
+
+        // points frame.preview at a pooled buffer, never waits: the UI just misses a frame
+        bool prepare_preview(Frame &frame, int cv_type);
+
+        // downscale img_cvt unless the converter already produced the preview on the way,
+        // raw frames are converted for the UI only
+        void make_preview(Worker &worker, Frame &frame);
+
+        // share of `pool`, (re)created when frames outgrow it
+        BufferPool::Ptr output_pool(BufferPool::Ptr &pool, size_t needed, const char *what);
+
+        // releases everything the frame holds, unpublished slots go back to the pool
+        void recycle(Frame &frame);
+
+        void display(const Frame &frame);
         
-        void send();
+        void send(Frame &frame);
+
+        // meta + image messages for one Mat; a pooled slot (published here) carries the binary meta in front of
+        // the image, `shared` is the received message the Mat points into for passthrough frames
+        void make_messages(FrameHeader &meta, const cv::Mat &img, BufferPool *pool, int &slot, zmq::message_t *shared,
+                           zmq::message_t &meta_msg, zmq::message_t &img_msg);
 
         int get_bayer_code(Pylon::EPixelType from) const;
 
@@ -74,24 +186,51 @@ namespace vert {
         Pylon::EPixelType get_output_pylon_type(Pylon::EPixelType from) const;
         uint8_t get_output_cn(Pylon::EPixelType from) const;
 
-        zmq::socket_t publisher_;
+        // significant bits per sample of what convert() produces
+        uint8_t get_output_bit_depth(Pylon::EPixelType from) const;
+
+        zmq::socket_t publisher_;     // full frames to nodes
+        UiPreviewPublisher ui_preview_;  // rate limited previews to the UI
+        PhotometricCorrection correction_; // dark / flat / white balance / gamma after conversion, optional
         zmq::socket_t subscriber_;
 
         std::atomic<bool> is_running_{false};
 
-        std::thread loop_thread_;
-        mutable std::mutex image_mutex_;
-
-        cv::Mat img_raw_;
-        cv::Mat img_cvt_;
-
-        MatMeta img_meta_;
+        std::thread recv_thread_;
+        std::thread send_thread_;
+        std::vector<std::unique_ptr<Worker>> workers_;
+        std::unique_ptr<BandPool> band_pool_;  // num_bands - 1 helpers shared by all workers, workers take a band too
+
+        std::unique_ptr<Frame[]> frames_;
+        size_t num_frames_ = 0;
+        std::unique_ptr<MpmcQueue<int>> free_frames_;
+        std::unique_ptr<MpmcQueue<int>> to_convert_;
+        std::unique_ptr<MpmcQueue<int>> converted_;
+        uint64_t next_recv_seq_ = 0; // receiver only
+        std::vector<int> reorder_; // sequencer only, frame index by seq % num_frames_, -1 while missing
+        uint64_t next_send_seq_ = 0;
+
+        // per stage timing
+        LatencyStats queue_wait_;   // received -> picked up by a worker
+        LatencyStats convert_time_;
+        LatencyStats reorder_wait_; // converted -> published
+
+        // slot layout: FrameHeader (binary meta) | image
+        static constexpr size_t kSlotImageOffset = 128;
+        static_assert(sizeof(FrameHeader) <= kSlotImageOffset, "FrameHeader does not fit the pool slot");
+        std::mutex pool_mutex_;
+        BufferPool::Ptr pool_;
+        BufferPool::Ptr preview_pool_;
+        std::atomic<size_t> pool_exhausted_{0};
+        std::atomic<size_t> preview_skipped_{0};
+        std::atomic<size_t> dropped_count_{0};
+
+        uint16_t node_ = kUnknownDevice; // interned name_, for frame stamps
+
+        std::vector<uint8_t> tone_lut_[2]; // packed_gamma != 1: 10 bit, 12 bit -> 8 bit
 
         Pylon::EImageOrientation src_orientation_ = Pylon::ImageOrientation_TopDown; // we assume it's top down
 
-        Pylon::CImageFormatConverter converter_;
-        Pylon::CPylonImage pylon_image_;
-
         CameraAdapterConfig cfg_;
 
         std::string name_ = "CameraAdapter";
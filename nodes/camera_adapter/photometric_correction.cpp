@@ -0,0 +1,207 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <opencv2/imgcodecs.hpp>
+#include "photometric_correction.h"
+#include "../utils/photometric.h"
+#include "../utils/logging.h"
+
+using namespace std;
+
+bool vert::PhotometricCorrection::init(const YAML::Node &config, const std::string &name)
+{
+    name_ = name + "/correction";
+
+    try {
+        if (!config) {
+            return true;
+        }
+        if (config["is_use"]) {
+            cfg_.is_use = config["is_use"].as<bool>();
+        }
+        if (!cfg_.is_use) {
+            return true;
+        }
+
+        if (config["gamma"]) {
+            double gamma = config["gamma"].as<double>();
+            if (gamma > 0) {
+                cfg_.gamma = gamma;
+            } else {
+                vert::logger->warn("correction.gamma must be > 0, use default {}", cfg_.gamma);
+            }
+        }
+        if (config["white_balance"]) {
+            const auto &wb = config["white_balance"];
+            const char *keys[3] = {"b", "g", "r"};
+            for (int c = 0; c < 3; ++c) {
+                if (wb[keys[c]] && wb[keys[c]].as<double>() >= 0) {
+                    cfg_.white_balance[c] = wb[keys[c]].as<double>();
+                }
+            }
+        }
+        if (config["dark_frame"]) {
+            cfg_.dark_frame = config["dark_frame"].as<string>();
+        }
+        if (config["flat_field"]) {
+            cfg_.flat_field = config["flat_field"].as<string>();
+        }
+
+        auto load = [&](const string &path, const char *what, cv::Mat &img) {
+            if (path.empty())
+                return true;
+            img = cv::imread(path, cv::IMREAD_UNCHANGED);
+            if (img.empty()) {
+                vert::logger->critical("Failed to init {}. Reason: cannot read correction.{} {}", name_, what, path);
+                return false;
+            }
+            vert::logger->info("{} {} {}: {} x {}, {} channels, {} bit", name_, what, path, img.cols, img.rows,
+                               img.channels(), img.depth() == CV_8U ? 8 : 16);
+            return true;
+        };
+        if (!load(cfg_.dark_frame, "dark_frame", dark_) || !load(cfg_.flat_field, "flat_field", flat_)) {
+            return false;
+        }
+
+        vert::logger->info("{} gamma {}, white balance r {} g {} b {}, dark frame {}, flat field {}", name_, cfg_.gamma,
+                           cfg_.white_balance[2], cfg_.white_balance[1], cfg_.white_balance[0],
+                           dark_.empty() ? "none" : cfg_.dark_frame, flat_.empty() ? "none" : cfg_.flat_field);
+
+    } catch (const YAML::Exception& e) {
+        vert::logger->critical("Failed to init {}. Reason: {}", name_, e.what());
+        return false;
+    } catch (const std::exception& e) {
+        vert::logger->critical("Failed to init {}. Reason: {}", name_, e.what());
+        return false;
+    }
+
+    return true;
+}
+
+const vert::PhotometricCorrection::Tables *vert::PhotometricCorrection::tables(int rows, int cols, int channels, int bits)
+{
+    if (!cfg_.is_use)
+        return nullptr;
+
+    std::lock_guard<std::mutex> lock(tables_mutex_);
+    for (const auto &t : tables_) {
+        if (t->rows == rows && t->cols == cols && t->channels == channels && t->bits == bits)
+            return t->active ? t.get() : nullptr;
+    }
+
+    // unusable layouts are kept too, so they are reported once
+    auto t = std::make_unique<Tables>();
+    t->rows = rows;
+    t->cols = cols;
+    t->channels = channels;
+    t->bits = bits;
+    if (build(*t)) {
+        t->active = !t->offset.empty() || !t->lut8.empty() || !t->lut16.empty();
+        vert::logger->info("{} {} x {}, {} channels, {} bit: {}", name_, cols, rows, channels, bits,
+                           t->active ? "corrected" : "nothing to correct");
+    }
+    tables_.push_back(std::move(t));
+    return tables_.back()->active ? tables_.back().get() : nullptr;
+}
+
+bool vert::PhotometricCorrection::fit_map(const cv::Mat &img, const char *what, const Tables &t, cv::Mat &out) const
+{
+    if (img.rows != t.rows || img.cols != t.cols) {
+        vert::logger->error("{} {} is {} x {}, frames are {} x {}, not corrected", name_, what, img.cols, img.rows, t.cols, t.rows);
+        return false;
+    }
+    if (img.depth() != (t.bits == 8 ? CV_8U : CV_16U)) {
+        vert::logger->error("{} {} is not {} bit like the frames, not corrected", name_, what, t.bits == 8 ? 8 : 16);
+        return false;
+    }
+    if (img.channels() == t.channels) {
+        out = img;
+    } else if (img.channels() == 1) {
+        cv::merge(std::vector<cv::Mat>(t.channels, img), out);
+    } else {
+        vert::logger->error("{} {} has {} channels, frames have {}, not corrected", name_, what, img.channels(), t.channels);
+        return false;
+    }
+    return true;
+}
+
+bool vert::PhotometricCorrection::build(Tables &t) const
+{
+    if (!vert::is_supported_photometric_bits(t.bits) || (t.channels != 1 && t.channels != 3)) {
+        vert::logger->error("{} cannot correct {} bit frames with {} channels", name_, t.bits, t.channels);
+        return false;
+    }
+
+    // white balance, then gamma, in one lut per channel
+    bool color = t.channels == 3;
+    bool balanced = !color || (cfg_.white_balance[0] == 1.0 && cfg_.white_balance[1] == 1.0 && cfg_.white_balance[2] == 1.0);
+    if (cfg_.gamma != 1.0 || !balanced) {
+        size_t table = size_t(1) << t.bits;
+        double max_value = static_cast<double>(table - 1);
+        std::vector<uint16_t> lut(t.channels * table);
+        for (int c = 0; c < t.channels; ++c) {
+            double wb = color ? cfg_.white_balance[c] : 1.0;
+            for (size_t v = 0; v < table; ++v) {
+                double x = min(v * wb, max_value) / max_value;
+                lut[c * table + v] = static_cast<uint16_t>(max_value * std::pow(x, 1.0 / cfg_.gamma) + 0.5);
+            }
+        }
+        if (t.bits == 8) {
+            t.lut8.assign(lut.begin(), lut.end());
+        } else {
+            t.lut16 = std::move(lut);
+        }
+    }
+
+    if (dark_.empty() && flat_.empty())
+        return true;
+
+    cv::Mat dark, flat;
+    if (!dark_.empty() && !fit_map(dark_, "dark_frame", t, dark))
+        return false;
+    if (!flat_.empty() && !fit_map(flat_, "flat_field", t, flat))
+        return false;
+
+    int map_type = CV_16UC(t.channels);
+    if (dark.empty()) {
+        t.offset = cv::Mat::zeros(t.rows, t.cols, map_type);
+    } else {
+        dark.convertTo(t.offset, CV_16U);
+    }
+
+    if (flat.empty()) {
+        t.gain = cv::Mat(t.rows, t.cols, map_type, cv::Scalar::all(1 << vert::kPhotometricGainBits));
+    } else {
+        // gain = mean(flat - dark) / (flat - dark) per channel, so the flat target comes out uniform;
+        // saturates at 16x for dead corners
+        cv::Mat response, offset;
+        flat.convertTo(response, CV_32F);
+        t.offset.convertTo(offset, CV_32F);
+        response -= offset;
+        response = cv::max(response, 1.0);
+        cv::Scalar mean = cv::mean(response);
+        std::vector<cv::Mat> planes;
+        cv::split(response, planes);
+        for (int c = 0; c < t.channels; ++c) {
+            cv::divide(mean[c], planes[c], planes[c]);
+        }
+        cv::merge(planes, response);
+        response.convertTo(t.gain, CV_16U, 1 << vert::kPhotometricGainBits);
+    }
+    return true;
+}
+
+void vert::PhotometricCorrection::apply(const Tables &t, const cv::Mat &src, cv::Mat &dst, int row_begin, int row_end, SimdLevel level)
+{
+    const uint16_t *offset = t.offset.empty() ? nullptr : t.offset.ptr<uint16_t>();
+    const uint16_t *gain = t.gain.empty() ? nullptr : t.gain.ptr<uint16_t>();
+    size_t map_stride = t.offset.empty() ? 0 : t.offset.step;
+    assert(t.gain.empty() || t.gain.step == map_stride);
+    if (src.depth() == CV_8U) {
+        vert::photometric_rows_8(src.data, src.step, dst.data, dst.step, src.cols, src.channels(), offset, gain, map_stride,
+                                 t.lut8.empty() ? nullptr : t.lut8.data(), row_begin, row_end, level);
+    } else {
+        vert::photometric_rows_16(src.ptr<uint16_t>(), src.step, dst.ptr<uint16_t>(), dst.step, src.cols, src.channels(), t.bits,
+                                  offset, gain, map_stride, t.lut16.empty() ? nullptr : t.lut16.data(), row_begin, row_end, level);
+    }
+}
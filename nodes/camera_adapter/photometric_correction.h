@@ -0,0 +1,74 @@
+#ifndef _PHOTOMETRIC_CORRECTION_H_
+#define _PHOTOMETRIC_CORRECTION_H_
+#include <opencv2/core.hpp>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <yaml-cpp/yaml.h>
+#include "../utils/cpu_features.h"
+
+namespace vert {
+
+    // Optional correction of converted frames, applied by CameraAdapter right after conversion as one pass
+    // (vert::photometric_rows_*) instead of separate full frame passes downstream:
+    // - dark frame subtraction and flat field gain per sample
+    // - white balance and gamma through one lut per channel
+    // The dark / flat images are loaded once, the tables for a frame layout are built on its first frame.
+    class PhotometricCorrection
+    {
+        struct PhotometricConfig {
+            bool is_use = false;
+            double gamma = 1.0;
+            double white_balance[3] = {1.0, 1.0, 1.0}; // B, G, R gains, color frames only
+            std::string dark_frame;  // image file, same size and depth as the converted frames, empty: none
+            std::string flat_field;  // uniformly lit target, same size and depth, empty: none
+        };
+
+    public:
+        // what frames of one layout (size, channels, bit depth) need, immutable once built
+        struct Tables {
+            int rows = 0;
+            int cols = 0;
+            int channels = 0;
+            int bits = 0;
+            cv::Mat offset;               // CV_16UC(channels) dark frame, empty: no maps
+            cv::Mat gain;                 // CV_16UC(channels) flat field gain, kPhotometricGainBits fixed point
+            std::vector<uint8_t> lut8;    // channels x 256 for 8 bit frames, empty: identity
+            std::vector<uint16_t> lut16;  // channels x 2^bits for 10 / 12 bit frames, empty: identity
+            bool active = false;          // false: nothing to do or the maps do not fit, frames stay as converted
+        };
+
+        // config: the `correction` section (may be empty)
+        bool init(const YAML::Node &config, const std::string &name);
+
+        bool enabled() const { return cfg_.is_use; }
+
+        // tables for frames of this layout, built on first use, thread safe; nullptr if those frames are not corrected
+        const Tables *tables(int rows, int cols, int channels, int bits);
+
+        // rows [row_begin, row_end) of src into dst (same size and type, may be src)
+        static void apply(const Tables &tables, const cv::Mat &src, cv::Mat &dst, int row_begin, int row_end,
+                          SimdLevel level = SimdLevel::Best);
+
+    private:
+        // false (logged) if the dark / flat images do not fit the layout
+        bool build(Tables &tables) const;
+
+        // `img` as a map for the layout, single channel images are used for every channel
+        bool fit_map(const cv::Mat &img, const char *what, const Tables &tables, cv::Mat &out) const;
+
+        cv::Mat dark_;
+        cv::Mat flat_;
+
+        std::mutex tables_mutex_;
+        std::vector<std::unique_ptr<Tables>> tables_; // one per layout seen, a camera rarely has more than one
+
+        PhotometricConfig cfg_;
+
+        std::string name_ = "Correction";
+    };
+
+} // namespace vert
+
+#endif /* _PHOTOMETRIC_CORRECTION_H_ */
@@ -0,0 +1,246 @@
+#include <algorithm>
+#include <opencv2/imgproc.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include "ui_preview_publisher.h"
+#include "../third_party/msgpack.hpp"
+#include "../utils/zmq_utils.h"
+#include "../utils/thread_utils.h"
+#include "../utils/string_utils.h"
+#include "../utils/logging.h"
+
+using namespace std;
+
+bool vert::preview_encoding_from_string(std::string_view s, UiPreviewPublisher::Encoding &encoding)
+{
+    string lower = vert::to_lower(s);
+    if (lower == "raw") {
+        encoding = UiPreviewPublisher::Encoding::Raw;
+    } else if (lower == "jpeg" || lower == "jpg") {
+        encoding = UiPreviewPublisher::Encoding::Jpeg;
+    } else if (lower == "png") {
+        encoding = UiPreviewPublisher::Encoding::Png;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char *vert::preview_encoding_to_string(UiPreviewPublisher::Encoding encoding)
+{
+    switch (encoding) {
+    case UiPreviewPublisher::Encoding::Raw: return "raw";
+    case UiPreviewPublisher::Encoding::Jpeg: return "jpeg";
+    case UiPreviewPublisher::Encoding::Png: return "png";
+    }
+    return "unknown";
+}
+
+vert::UiPreviewPublisher::UiPreviewPublisher(zmq::context_t *ctx)
+    : publisher_(*ctx, zmq::socket_type::pub)
+{
+}
+
+vert::UiPreviewPublisher::~UiPreviewPublisher()
+{
+    if (is_running())
+        stop();
+}
+
+bool vert::UiPreviewPublisher::init(const std::string &address, const YAML::Node &config, const std::string &name)
+{
+    name_ = name + "/ui";
+
+    try {
+        if (config) {
+            if (config["max_fps"]) {
+                cfg_.max_fps = config["max_fps"].as<double>();
+            } else {
+                vert::logger->warn("preview.max_fps not provided, use default {}.", cfg_.max_fps);
+            }
+            if (config["max_size"]) {
+                cfg_.max_size = max(0, config["max_size"].as<int>());
+            }
+            if (config["encoding"]) {
+                auto encoding = config["encoding"].as<string>();
+                if (!vert::preview_encoding_from_string(encoding, cfg_.encoding)) {
+                    vert::logger->warn("unknown preview.encoding {}, use default {}", encoding, vert::preview_encoding_to_string(cfg_.encoding));
+                }
+            }
+            if (config["quality"]) {
+                // jpeg: 0-100 quality, png: 0-9 compression level
+                int quality = config["quality"].as<int>();
+                if (cfg_.encoding == Encoding::Png) {
+                    cfg_.png_compression = std::clamp(quality, 0, 9);
+                } else {
+                    cfg_.jpeg_quality = std::clamp(quality, 0, 100);
+                }
+            }
+            if (config["sndhwm"]) {
+                cfg_.sndhwm = max(1, config["sndhwm"].as<int>());
+            }
+        } else {
+            vert::logger->warn("preview not provided, use default {} fps {}.", cfg_.max_fps, vert::preview_encoding_to_string(cfg_.encoding));
+        }
+
+        period_ns_ = cfg_.max_fps > 0 ? static_cast<int64_t>(1e9 / cfg_.max_fps) : 0;
+        if (cfg_.encoding == Encoding::Jpeg) {
+            encode_params_ = {cv::IMWRITE_JPEG_QUALITY, cfg_.jpeg_quality};
+        } else if (cfg_.encoding == Encoding::Png) {
+            encode_params_ = {cv::IMWRITE_PNG_COMPRESSION, cfg_.png_compression};
+        }
+
+        // meta + image are 2 messages, a slow UI holds at most sndhwm frames before we drop
+        publisher_.set(zmq::sockopt::sndhwm, 2 * cfg_.sndhwm);
+        publisher_.set(zmq::sockopt::linger, 0);
+        publisher_.connect(address);
+        vert::logger->info("{} connected to {}: max {} fps, max size {}, {}", name_, address, cfg_.max_fps, cfg_.max_size,
+                           vert::preview_encoding_to_string(cfg_.encoding));
+
+    } catch (const YAML::Exception& e) {
+        vert::logger->critical("Failed to init {}. Reason: {}", name_, e.what());
+        return false;
+    } catch (const std::exception& e) {
+        vert::logger->critical("Failed to init {}. Reason: {}", name_, e.what());
+        return false;
+    }
+
+    return true;
+}
+
+void vert::UiPreviewPublisher::start()
+{
+    if (!is_running_) {
+        is_running_ = true;
+        loop_thread_ = std::thread(&UiPreviewPublisher::loop, this);
+    }
+}
+
+void vert::UiPreviewPublisher::stop()
+{
+    if (is_running_) {
+        {
+            std::lock_guard<std::mutex> lock(mailbox_mutex_);
+            is_running_ = false;
+        }
+        mailbox_cv_.notify_all();
+        if (loop_thread_.joinable()) {
+            loop_thread_.join();
+        }
+        pending_img_.rebuild(); // releases the pooled buffer
+        has_pending_ = false;
+
+        encode_time_.report(name_, "encode");
+        vert::logger->info("{} sent {} previews ({} KB), {} replaced before sending", name_,
+                           sent_count_, sent_bytes_ / 1024, replaced_count_);
+    }
+}
+
+bool vert::UiPreviewPublisher::claim(int64_t now_ns)
+{
+    if (period_ns_ == 0)
+        return true;
+    int64_t due = next_due_ns_.load(std::memory_order_relaxed);
+    if (now_ns < due)
+        return false;
+    // a late frame does not earn the next one an earlier slot
+    return next_due_ns_.compare_exchange_strong(due, max(due + period_ns_, now_ns), std::memory_order_relaxed);
+}
+
+void vert::UiPreviewPublisher::offer(const FrameHeader &meta, zmq::message_t &img)
+{
+    {
+        std::lock_guard<std::mutex> lock(mailbox_mutex_);
+        if (has_pending_)
+            replaced_count_++;
+        pending_meta_ = meta;
+        pending_img_.copy(img);
+        has_pending_ = true;
+    }
+    mailbox_cv_.notify_one();
+}
+
+void vert::UiPreviewPublisher::loop()
+{
+    vert::set_current_thread_name(name_);
+
+    while (true) {
+        FrameHeader meta;
+        zmq::message_t img;
+        {
+            std::unique_lock<std::mutex> lock(mailbox_mutex_);
+            mailbox_cv_.wait(lock, [this] { return has_pending_ || !is_running_; });
+            if (!is_running_)
+                break;
+            meta = pending_meta_;
+            img.move(pending_img_);
+            has_pending_ = false;
+        }
+
+        int64_t t0 = vert::steady_now_ns();
+        PreviewMeta preview_meta{std::string(vert::device_name(meta.device)), meta.id, meta.height, meta.width,
+                                 meta.cv_type, meta.cn, meta.timestamp, meta.error_cnt, "raw"};
+        zmq::message_t img_msg;
+        if (!encode(img, meta.bit_depth, preview_meta, img_msg))
+            continue;
+        encode_time_.add(vert::steady_now_ns() - t0);
+
+        std::vector<uint8_t> meta_data;
+        if (cfg_.encoding == Encoding::Raw) {
+            meta_data = msgpack::pack(MatMeta{preview_meta.device_id, preview_meta.id, preview_meta.height, preview_meta.width,
+                                              preview_meta.cv_type, preview_meta.cn, preview_meta.timestamp, preview_meta.error_cnt});
+        } else {
+            meta_data = msgpack::pack(preview_meta);
+        }
+        zmq::message_t meta_msg(meta_data.data(), meta_data.size());
+        size_t size = img_msg.size();
+        // PUB never blocks, past the high water mark zmq drops whole frames for that subscriber
+        publisher_.send(meta_msg, zmq::send_flags::sndmore);
+        publisher_.send(img_msg, zmq::send_flags::dontwait);
+        sent_count_++;
+        sent_bytes_ += size;
+    }
+}
+
+bool vert::UiPreviewPublisher::encode(zmq::message_t &img, int bit_depth, PreviewMeta &meta, zmq::message_t &out)
+{
+    cv::Mat src(meta.height, meta.width, meta.cv_type, img.data());
+
+    int longest = max(src.cols, src.rows);
+    bool shrink = cfg_.max_size > 0 && longest > cfg_.max_size;
+    if (shrink) {
+        double scale = static_cast<double>(cfg_.max_size) / longest;
+        cv::resize(src, resized_, cv::Size(), scale, scale, cv::INTER_AREA);
+        src = resized_;
+        meta.width = src.cols;
+        meta.height = src.rows;
+    }
+    if (src.depth() == CV_16U) {
+        // unpacked 10 / 12 bit frames, the UI shows their top 8 bits
+        src.convertTo(depth8_, CV_8U, 1.0 / (1 << max(0, bit_depth - 8)));
+        src = depth8_;
+        meta.cv_type = src.type();
+    }
+
+    if (cfg_.encoding == Encoding::Raw) {
+        if (src.data != img.data()) {
+            out = zmq::message_t(src.data, src.total() * src.elemSize());
+        } else {
+            out.move(img); // as received, no copy
+        }
+        return true;
+    }
+
+    const char *ext = cfg_.encoding == Encoding::Jpeg ? ".jpg" : ".png";
+    try {
+        if (!cv::imencode(ext, src, encoded_, encode_params_)) {
+            vert::logger->error("{} failed to encode {}x{} {}", name_, src.cols, src.rows, ext);
+            return false;
+        }
+    } catch (const cv::Exception &e) {
+        vert::logger->error("{} failed to encode {}x{} {}: {}", name_, src.cols, src.rows, ext, e.what());
+        return false;
+    }
+    meta.encoding = vert::preview_encoding_to_string(cfg_.encoding);
+    out = zmq::message_t(encoded_.data(), encoded_.size());
+    return true;
+}
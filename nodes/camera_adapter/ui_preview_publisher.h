@@ -0,0 +1,104 @@
+#ifndef _UI_PREVIEW_PUBLISHER_H_
+#define _UI_PREVIEW_PUBLISHER_H_
+#include <opencv2/core.hpp>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <string>
+#include <vector>
+#include <yaml-cpp/yaml.h>
+#include "../utils/frame_header.h"
+#include "../utils/types.h"
+#include "../utils/timer.h"
+#include "../third_party/zmq.hpp"
+
+namespace vert {
+
+    // Previews for the UI on their own PUB socket, decoupled from the production pipeline:
+    // - claim() hands out at most max_fps frames, the rest never get a preview made
+    // - offer() only parks the frame in a one slot mailbox (latest wins) and returns
+    // - one thread resizes to max_size, encodes and sends; a slow UI hits the small send
+    //   high water mark and loses frames instead of growing queues
+    // So the UI costs at most one core and max_fps * encoded size of bandwidth.
+    // Meta is always msgpack, the UI is out of process: raw previews keep the MatMeta + pixels
+    // layout UIs always got, jpeg / png ones send PreviewMeta (MatMeta + encoding) + the file bytes.
+    class UiPreviewPublisher
+    {
+    public:
+        enum class Encoding {
+            Raw = 0,
+            Jpeg = 1,
+            Png = 2
+        };
+
+    private:
+        struct UiPreviewConfig {
+            double max_fps = 15.0;   // <= 0: every frame
+            int max_size = 1280;     // longest side in pixels, 0: as received
+            Encoding encoding = Encoding::Raw;
+            int jpeg_quality = 80;
+            int png_compression = 1;
+            int sndhwm = 2;          // frames queued for a slow UI before dropping
+        };
+
+    public:
+        UiPreviewPublisher(zmq::context_t *ctx);
+        ~UiPreviewPublisher();
+
+        // address: port.to_ui, config: the `preview` section (may be empty)
+        bool init(const std::string &address, const YAML::Node &config, const std::string &name);
+
+        void start();
+        void stop();
+        bool is_running() const {return is_running_.load();}
+
+        // true if a frame arriving now should get a preview, thread safe
+        bool claim(int64_t now_ns = steady_now_ns());
+
+        // Hands a claimed frame to the sender thread, replacing one still waiting.
+        // img shares the pixels (zmq refcount), meta.height / width / cv_type describe them.
+        void offer(const FrameHeader &meta, zmq::message_t &img);
+
+    private:
+        void loop();
+
+        // resize / encode img into out, meta gets what the UI decodes; false if the encoder failed.
+        // 16 bit images holding `bit_depth` significant bits go out as 8 bit.
+        bool encode(zmq::message_t &img, int bit_depth, PreviewMeta &meta, zmq::message_t &out);
+
+        zmq::socket_t publisher_;
+
+        std::atomic<bool> is_running_{false};
+        std::thread loop_thread_;
+
+        std::mutex mailbox_mutex_;
+        std::condition_variable mailbox_cv_;
+        bool has_pending_ = false;
+        FrameHeader pending_meta_;
+        zmq::message_t pending_img_;
+
+        std::atomic<int64_t> next_due_ns_{0};
+        int64_t period_ns_ = 0;
+
+        cv::Mat resized_;               // sender thread only
+        cv::Mat depth8_;                // sender thread only, 16 bit frames scaled down
+        std::vector<uchar> encoded_;    // sender thread only, reused
+        std::vector<int> encode_params_;
+
+        size_t sent_count_ = 0;
+        size_t replaced_count_ = 0;     // overwritten in the mailbox before the sender got to them
+        size_t sent_bytes_ = 0;
+        LatencyStats encode_time_;
+
+        UiPreviewConfig cfg_;
+
+        std::string name_ = "UiPreview";
+    };
+
+    bool preview_encoding_from_string(std::string_view s, UiPreviewPublisher::Encoding &encoding);
+    const char *preview_encoding_to_string(UiPreviewPublisher::Encoding encoding);
+
+} // namespace vert
+
+#endif /* _UI_PREVIEW_PUBLISHER_H_ */
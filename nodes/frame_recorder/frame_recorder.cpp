@@ -0,0 +1,251 @@
+#include "frame_recorder.h"
+#include <chrono>
+#include <cstring>
+#include "../third_party/zmq_addon.hpp"
+#include "../utils/logging.h"
+#include "../utils/string_utils.h"
+#include "../utils/memory_utils.h"
+#include "../utils/record_format.h"
+#include "../utils/frame_header.h"
+
+using namespace std;
+using namespace std::chrono;
+namespace fs = std::filesystem;
+
+vert::FrameRecorder::FrameRecorder(zmq::context_t *ctx)
+    : ctx_(ctx)
+{
+}
+
+vert::FrameRecorder::~FrameRecorder()
+{
+    if (is_running())
+        stop();
+    close_segment();
+}
+
+bool vert::FrameRecorder::init(const YAML::Node &config)
+{
+    vert::logger->info("Initializing FrameRecorder ...");
+    try {
+        if (!config) {
+            vert::logger->critical("Failed to init FrameRecorder. Reason: config is empty");
+            return false;
+        }
+
+        if (config["name"]) {
+            name_ = config["name"].as<string>();
+        } else {
+            vert::logger->warn("name not provided.");
+        }
+
+        // sub: tap a pub stream (e.g. camera_adapter.port.to_node) without disturbing it
+        // pull: take frames from a push stream, the recorder becomes the consumer
+        string socket = config["socket"] ? vert::to_lower(config["socket"].as<string>()) : "sub";
+        if (socket == "pull") {
+            subscriber_ = zmq::socket_t(*ctx_, zmq::socket_type::pull);
+        } else {
+            subscriber_ = zmq::socket_t(*ctx_, zmq::socket_type::sub);
+            subscriber_.set(zmq::sockopt::subscribe, "");
+        }
+        subscriber_.set(zmq::sockopt::rcvtimeo, 1000);
+
+        if (config["port"]) {
+            auto addr = config["port"].as<string>();
+            bool bind = config["bind"] ? config["bind"].as<bool>() : false;
+            if (bind) {
+                subscriber_.bind(addr);
+            } else {
+                subscriber_.connect(addr);
+            }
+            vert::logger->info("{} {} {} {}", name_, socket, bind ? "bound to" : "connected to", addr);
+        } else {
+            vert::logger->critical("Failed to init '{}'. Reason: port is empty", name_);
+            return false;
+        }
+
+        if (config["folder"]) {
+            cfg_.folder = fs::path(config["folder"].as<string>());
+        } else {
+            vert::logger->critical("Failed to init '{}'. Reason: folder is empty", name_);
+            return false;
+        }
+
+        if (!fs::exists(cfg_.folder)) {
+            fs::create_directories(cfg_.folder);
+            vert::logger->info("folder {} created", cfg_.folder.string());
+        }
+
+        if (config["prefix"]) {
+            cfg_.prefix = config["prefix"].as<string>();
+        }
+
+        if (config["segment_size"]) {
+            size_t segment_mb = max(1, config["segment_size"].as<int>());
+            cfg_.segment_size = segment_mb * 1024 * 1024;
+        } else {
+            vert::logger->warn("segment_size not provided, use default {} MB.", cfg_.segment_size / (1024 * 1024));
+        }
+
+        if (config["max_images"]) {
+            cfg_.max_images = config["max_images"].as<int64_t>();
+        }
+
+    } catch (const YAML::Exception& e) {
+        vert::logger->critical("Failed to init '{}'. Reason: {}", name_, e.what());
+        return false;
+    } catch (const std::exception& e) {
+        vert::logger->critical("Failed to init '{}'. Reason: {}", name_, e.what());
+        return false;
+    }
+
+    vert::logger->info("{} initialized successfully", name_);
+    return true;
+}
+
+void vert::FrameRecorder::start()
+{
+    vert::logger->info("{} starting...", name_);
+    if (!is_running_) {
+        if (!open_segment())
+            return;
+        is_running_ = true;
+        loop_thread_ = std::thread(&FrameRecorder::loop, this);
+        vert::logger->info("{} started", name_);
+    }
+}
+
+void vert::FrameRecorder::stop()
+{
+    vert::logger->info("{} stopping...", name_);
+    if (is_running_) {
+        is_running_ = false;
+        if (loop_thread_.joinable()) {
+            loop_thread_.join();
+        }
+        close_segment();
+        vert::logger->info("{} stopped, {} frames ({} MB) recorded", name_, frame_count_, bytes_written_ / (1024 * 1024));
+    }
+}
+
+void vert::FrameRecorder::loop()
+{
+    auto t_start = steady_clock::now();
+    vector<zmq::message_t> msgs;
+
+    while (is_running_ && (cfg_.max_images < 0 || frame_count_ < cfg_.max_images)) {
+        msgs.clear();
+        zmq::recv_result_t result = zmq::recv_multipart(subscriber_, std::back_inserter(msgs));
+        if (!result)
+            continue;
+        if (*result != 2) {
+            vert::logger->warn("{} skipped message with {} parts", name_, *result);
+            continue;
+        }
+
+        int64_t recv_ns = duration_cast<nanoseconds>(steady_clock::now() - t_start).count();
+        if (!write_frame(msgs[0], msgs[1], recv_ns)) {
+            vert::logger->error("{} failed to write frame, recording stopped", name_);
+            break;
+        }
+    }
+}
+
+bool vert::FrameRecorder::open_segment()
+{
+    auto rec_path = vert::segment_path(cfg_.folder, cfg_.prefix, segment_index_);
+    auto idx_path = vert::index_path(cfg_.folder, cfg_.prefix, segment_index_);
+
+    segment_file_ = std::fopen(rec_path.string().c_str(), "wb");
+    index_file_ = std::fopen(idx_path.string().c_str(), "wb");
+    if (!segment_file_ || !index_file_) {
+        vert::logger->error("{} failed to open segment {}", name_, rec_path.string());
+        close_segment();
+        return false;
+    }
+
+    // large stdio buffer, frames are written in a few big chunks
+    file_buffer_.resize(4 * 1024 * 1024);
+    std::setvbuf(segment_file_, file_buffer_.data(), _IOFBF, file_buffer_.size());
+
+    segment_offset_ = 0;
+    vert::SegmentHeader header;
+    header.created_ns = duration_cast<nanoseconds>(system_clock::now().time_since_epoch()).count();
+    if (!write_bytes(&header, sizeof(header)))
+        return false;
+
+    vert::logger->info("{} recording to {}", name_, rec_path.string());
+    return true;
+}
+
+void vert::FrameRecorder::close_segment()
+{
+    if (segment_file_) {
+        std::fclose(segment_file_);
+        segment_file_ = nullptr;
+    }
+    if (index_file_) {
+        std::fclose(index_file_);
+        index_file_ = nullptr;
+    }
+}
+
+bool vert::FrameRecorder::write_frame(const zmq::message_t &meta, const zmq::message_t &payload, int64_t recv_ns)
+{
+    if (segment_offset_ >= cfg_.segment_size) {
+        close_segment();
+        segment_index_++;
+        if (!open_segment())
+            return false;
+    }
+
+    vert::RecordHeader record;
+    record.meta_size = static_cast<uint32_t>(meta.size());
+    record.payload_size = payload.size();
+    record.payload_offset = vert::align_up(segment_offset_ + sizeof(record) + meta.size(), vert::kRecordAlign);
+    record.recv_ns = recv_ns;
+
+    vert::FrameHeader header;
+    if (vert::read_frame_header(meta.data(), meta.size(), header)) {
+        auto device_id = vert::device_name(header.device);
+        std::memcpy(record.device_id, device_id.data(), min(device_id.size(), sizeof(record.device_id) - 1));
+    }
+
+    vert::IndexEntry entry;
+    entry.record_offset = segment_offset_;
+    entry.payload_offset = record.payload_offset;
+    entry.payload_size = record.payload_size;
+    entry.meta_size = record.meta_size;
+    entry.recv_ns = recv_ns;
+
+    if (!write_bytes(&record, sizeof(record)) ||
+        !write_bytes(meta.data(), meta.size()) ||
+        !write_padding(vert::kRecordAlign) ||
+        !write_bytes(payload.data(), payload.size()) ||
+        !write_padding(vert::kRecordAlign))
+        return false;
+
+    if (std::fwrite(&entry, sizeof(entry), 1, index_file_) != 1)
+        return false;
+
+    frame_count_++;
+    return true;
+}
+
+bool vert::FrameRecorder::write_bytes(const void *data, size_t size)
+{
+    if (size == 0)
+        return true;
+    if (std::fwrite(data, 1, size, segment_file_) != size)
+        return false;
+    segment_offset_ += size;
+    bytes_written_ += size;
+    return true;
+}
+
+bool vert::FrameRecorder::write_padding(size_t alignment)
+{
+    static const char zeros[kRecordAlign] = {};
+    size_t padding = vert::align_up(segment_offset_, alignment) - segment_offset_;
+    return write_bytes(zeros, padding);
+}
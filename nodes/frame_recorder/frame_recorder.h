@@ -0,0 +1,71 @@
+#ifndef _FRAME_RECORDER_H_
+#define _FRAME_RECORDER_H_
+
+#include <atomic>
+#include <thread>
+#include <string>
+#include <cstdio>
+#include <filesystem>
+#include <vector>
+#include <yaml-cpp/yaml.h>
+#include "../third_party/zmq.hpp"
+
+namespace vert {
+
+    // Taps a frame stream (meta + payload) and appends it raw to segmented, indexed files.
+    // See utils/record_format.h for the layout, FrameReplay plays it back.
+    class FrameRecorder
+    {
+        struct FrameRecorderConfig {
+            std::filesystem::path folder;
+            std::string prefix = "rec";
+            size_t segment_size = 1024ull * 1024 * 1024; // bytes per segment
+            int64_t max_images = -1;
+        };
+
+    public:
+        FrameRecorder(zmq::context_t *ctx);
+        ~FrameRecorder();
+
+        bool init(const YAML::Node &config);
+
+        void start();
+        void stop();
+        bool is_running() const {return is_running_.load();}
+
+    private:
+        void loop();
+
+        bool open_segment();
+
+        void close_segment();
+
+        bool write_frame(const zmq::message_t &meta, const zmq::message_t &payload, int64_t recv_ns);
+
+        bool write_bytes(const void *data, size_t size);
+
+        bool write_padding(size_t alignment);
+
+        zmq::context_t *ctx_ = nullptr;
+        zmq::socket_t subscriber_;
+
+        std::atomic<bool> is_running_{false};
+        std::thread loop_thread_;
+
+        std::FILE *segment_file_ = nullptr;
+        std::FILE *index_file_ = nullptr;
+        std::vector<char> file_buffer_;
+        size_t segment_index_ = 0;
+        size_t segment_offset_ = 0;
+
+        int64_t frame_count_ = 0;
+        uint64_t bytes_written_ = 0;
+
+        FrameRecorderConfig cfg_;
+
+        std::string name_ = "FrameRecorder";
+    };
+
+} // namespace vert
+
+#endif /* _FRAME_RECORDER_H_ */
@@ -0,0 +1,243 @@
+#include "frame_replay.h"
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include "../utils/logging.h"
+#include "../utils/string_utils.h"
+#include "../utils/frame_header.h"
+#include "../utils/zmq_utils.h"
+
+using namespace std;
+using namespace std::chrono;
+namespace fs = std::filesystem;
+
+vert::FrameReplay::FrameReplay(zmq::context_t *ctx)
+    : ctx_(ctx)
+{
+}
+
+vert::FrameReplay::~FrameReplay()
+{
+    if (is_running())
+        stop();
+}
+
+bool vert::FrameReplay::init(const YAML::Node &config)
+{
+    vert::logger->info("Initializing FrameReplay ...");
+    try {
+        if (!config) {
+            vert::logger->critical("Failed to init FrameReplay. Reason: config is empty");
+            return false;
+        }
+
+        if (config["name"]) {
+            name_ = config["name"].as<string>();
+        } else {
+            vert::logger->warn("name not provided.");
+        }
+
+        // push: stand in for a camera (connect to camera_adapter.port.from)
+        // pub: stand in for the adapter output (bind camera_adapter.port.to_node)
+        string socket = config["socket"] ? vert::to_lower(config["socket"].as<string>()) : "push";
+        publisher_ = zmq::socket_t(*ctx_, socket == "pub" ? zmq::socket_type::pub : zmq::socket_type::push);
+
+        if (config["port"]) {
+            auto addr = config["port"].as<string>();
+            bool bind = config["bind"] ? config["bind"].as<bool>() : (socket == "pub");
+            if (bind) {
+                publisher_.bind(addr);
+            } else {
+                publisher_.connect(addr);
+            }
+            vert::logger->info("{} {} {} {}", name_, socket, bind ? "bound to" : "connected to", addr);
+        } else {
+            vert::logger->critical("Failed to init '{}'. Reason: port is empty", name_);
+            return false;
+        }
+
+        if (config["folder"]) {
+            cfg_.folder = fs::path(config["folder"].as<string>());
+        } else {
+            vert::logger->critical("Failed to init '{}'. Reason: folder is empty", name_);
+            return false;
+        }
+
+        if (config["prefix"]) {
+            cfg_.prefix = config["prefix"].as<string>();
+        }
+
+        if (config["speed"]) {
+            cfg_.speed = config["speed"].as<double>();
+        } else {
+            vert::logger->warn("speed not provided, use default {}.", cfg_.speed);
+        }
+
+        if (config["loop"]) {
+            cfg_.loop = config["loop"].as<bool>();
+        }
+
+        if (config["max_images"]) {
+            cfg_.max_images = config["max_images"].as<int64_t>();
+        }
+
+        if (!load_segments())
+            return false;
+
+    } catch (const YAML::Exception& e) {
+        vert::logger->critical("Failed to init '{}'. Reason: {}", name_, e.what());
+        return false;
+    } catch (const std::exception& e) {
+        vert::logger->critical("Failed to init '{}'. Reason: {}", name_, e.what());
+        return false;
+    }
+
+    vert::logger->info("{} initialized successfully", name_);
+    return true;
+}
+
+void vert::FrameReplay::start()
+{
+    vert::logger->info("{} starting...", name_);
+    if (!is_running_) {
+        is_running_ = true;
+        loop_thread_ = std::thread(&FrameReplay::loop, this);
+        vert::logger->info("{} started", name_);
+    }
+}
+
+void vert::FrameReplay::stop()
+{
+    vert::logger->info("{} stopping...", name_);
+    if (is_running_) {
+        is_running_ = false;
+        if (loop_thread_.joinable()) {
+            loop_thread_.join();
+        }
+        vert::logger->info("{} stopped", name_);
+    }
+}
+
+void vert::FrameReplay::loop()
+{
+    pacer_.configure(0.0);
+    pacer_.reset();
+    error_count_ = 0;
+
+    int64_t sent = 0;
+    auto t_start = steady_clock::now();
+    auto keep_going = [&]() {
+        return is_running_ && (cfg_.max_images < 0 || sent < cfg_.max_images);
+    };
+
+    do {
+        int64_t prev_recv_ns = -1;
+        for (const auto& segment : segments_) {
+            for (const auto& entry : segment.index) {
+                if (!keep_going())
+                    break;
+
+                if (prev_recv_ns < 0) {
+                    pacer_.reset();
+                } else if (cfg_.speed > 0) {
+                    auto gap = max<int64_t>(entry.recv_ns - prev_recv_ns, 0);
+                    pacer_.wait_for(duration_cast<FramePacer::clock::duration>(duration<double, std::nano>(gap / cfg_.speed)));
+                }
+                prev_recv_ns = entry.recv_ns;
+
+                if (!send_record(segment, entry))
+                    error_count_++;
+                sent++;
+            }
+        }
+    } while (cfg_.loop && keep_going());
+
+    double elapsed = duration<double>(steady_clock::now() - t_start).count();
+    vert::logger->info("{} replayed {} frames in {:.2f} s ({:.1f} fps), errors {}",
+                       name_, sent, elapsed, elapsed > 0 ? sent / elapsed : 0.0, error_count_);
+}
+
+bool vert::FrameReplay::load_segments()
+{
+    segments_.clear();
+    num_frames_ = 0;
+
+    for (size_t i = 0; ; ++i) {
+        auto rec_path = vert::segment_path(cfg_.folder, cfg_.prefix, i);
+        auto idx_path = vert::index_path(cfg_.folder, cfg_.prefix, i);
+        if (!fs::exists(rec_path) || !fs::exists(idx_path))
+            break;
+
+        auto file = std::make_shared<MappedFile>();
+        if (!file->open(rec_path.string())) {
+            vert::logger->error("{} failed to map {}", name_, rec_path.string());
+            return false;
+        }
+
+        vert::SegmentHeader header;
+        if (file->size() < sizeof(header)) {
+            vert::logger->error("{} {} is truncated", name_, rec_path.string());
+            return false;
+        }
+        std::memcpy(&header, file->data(), sizeof(header));
+        if (header.magic != vert::kSegmentMagic || header.version != vert::kRecordVersion) {
+            vert::logger->error("{} {} is not a recording (or version {} unsupported)", name_, rec_path.string(), header.version);
+            return false;
+        }
+
+        Segment segment;
+        std::ifstream idx(idx_path, std::ios::binary | std::ios::ate);
+        size_t idx_size = static_cast<size_t>(idx.tellg());
+        idx.seekg(0);
+        segment.index.resize(idx_size / sizeof(vert::IndexEntry));
+        idx.read(reinterpret_cast<char *>(segment.index.data()), segment.index.size() * sizeof(vert::IndexEntry));
+
+        // drop entries past the end, e.g. the recorder was killed before flushing
+        while (!segment.index.empty() &&
+               segment.index.back().payload_offset + segment.index.back().payload_size > file->size()) {
+            segment.index.pop_back();
+        }
+
+        num_frames_ += segment.index.size();
+        segment.file = file;
+        segments_.push_back(std::move(segment));
+    }
+
+    if (num_frames_ == 0) {
+        vert::logger->critical("Failed to init '{}'. Reason: no recorded frame in {}/{}_*", name_, cfg_.folder.string(), cfg_.prefix);
+        return false;
+    }
+
+    vert::logger->info("{} mapped {} segments, {} frames", name_, segments_.size(), num_frames_);
+    return true;
+}
+
+bool vert::FrameReplay::send_record(const Segment &segment, const IndexEntry &entry)
+{
+    const uint8_t *base = segment.file->data();
+
+    vert::RecordHeader record;
+    std::memcpy(&record, base + entry.record_offset, sizeof(record));
+    const uint8_t *meta = base + entry.record_offset + sizeof(record);
+
+    // binary headers carry a process local device index, map it into this process
+    zmq::message_t meta_msg;
+    vert::FrameHeader header;
+    if (vert::read_frame_header(meta, entry.meta_size, header)) {
+        record.device_id[sizeof(record.device_id) - 1] = '\0';
+        header.device = vert::intern_device(record.device_id);
+        // recorded host times belong to another run, restart the latency trail here
+        header.grab_ns = vert::steady_now_ns();
+        header.exposure_ns = 0;
+        header.num_stamps = 0;
+        meta_msg.rebuild(&header, sizeof(header));
+    } else {
+        meta_msg.rebuild(meta, entry.meta_size);
+    }
+    publisher_.send(meta_msg, zmq::send_flags::sndmore);
+
+    // mapping is read only, nobody downstream writes into received frames
+    auto *payload = const_cast<uint8_t *>(base + entry.payload_offset);
+    zmq::message_t msg = vert::make_owned_message(payload, entry.payload_size, segment.file);
+    return static_cast<bool>(publisher_.send(msg, zmq::send_flags::dontwait));
+}
@@ -0,0 +1,71 @@
+#ifndef _FRAME_REPLAY_H_
+#define _FRAME_REPLAY_H_
+
+#include <atomic>
+#include <thread>
+#include <string>
+#include <memory>
+#include <vector>
+#include <filesystem>
+#include <yaml-cpp/yaml.h>
+#include "../utils/memory_utils.h"
+#include "../utils/record_format.h"
+#include "../utils/frame_pacer.h"
+#include "../third_party/zmq.hpp"
+
+namespace vert {
+
+    // Plays back a FrameRecorder recording. Segments are mmap'ed and payloads are
+    // published zero-copy straight from the mapping, at recorded speed (scaled) or as fast as possible.
+    class FrameReplay
+    {
+        struct FrameReplayConfig {
+            std::filesystem::path folder;
+            std::string prefix = "rec";
+            double speed = 1.0; // x recorded speed, <= 0 means as fast as possible
+            bool loop = false;
+            int64_t max_images = -1;
+        };
+
+        struct Segment {
+            std::shared_ptr<const MappedFile> file; // shared with frames in flight
+            std::vector<IndexEntry> index;
+        };
+
+    public:
+        FrameReplay(zmq::context_t *ctx);
+        ~FrameReplay();
+
+        bool init(const YAML::Node &config);
+
+        void start();
+        void stop();
+        bool is_running() const {return is_running_.load();}
+
+    private:
+        void loop();
+
+        bool load_segments();
+
+        bool send_record(const Segment &segment, const IndexEntry &entry);
+
+        zmq::context_t *ctx_ = nullptr;
+        zmq::socket_t publisher_;
+
+        std::atomic<bool> is_running_{false};
+        std::thread loop_thread_;
+
+        std::vector<Segment> segments_;
+        size_t num_frames_ = 0;
+
+        FramePacer pacer_;
+        FrameReplayConfig cfg_;
+
+        size_t error_count_ = 0;
+
+        std::string name_ = "FrameReplay";
+    };
+
+} // namespace vert
+
+#endif /* _FRAME_REPLAY_H_ */
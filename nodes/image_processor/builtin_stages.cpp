@@ -0,0 +1,155 @@
+#include <opencv2/imgproc.hpp>
+#include "stage.h"
+#include "../utils/logging.h"
+
+using namespace std;
+
+namespace
+{
+    // The processing ImageProcessor used to hardcode: blur, mask saturated colors, open / close / dilate the mask,
+    // black out the rest and invert, `iterations` times.
+    // Output image "dst", result "foreground": share of the frame inside the mask of the last round.
+    // Allocation free once it has seen a frame size: every step writes into its own scratch (nothing runs in
+    // place, where OpenCV may take a temporary copy), the kernel is built in init.
+    //
+    // With tiles every round is split into horizontal tiles run on the band pool. A tile reads `halo_` rows
+    // beyond its own on either side, enough for the blur and the five erode / dilate passes to see what they
+    // would on the whole frame, and writes only its own rows; filters never look past a tile's rows
+    // (BORDER_ISOLATED), so the output matches the untiled one exactly. Rounds alternate between dst and a
+    // full frame ping buffer, a tile must not overwrite rows its neighbours still read.
+    class TestProcessStage : public vert::Stage
+    {
+    public:
+        bool init(const YAML::Node &params) override
+        {
+            if (params) {
+                if (params["iterations"]) {
+                    iterations_ = max(1, params["iterations"].as<int>());
+                }
+                if (params["blur"]) {
+                    blur_ = max(1, params["blur"].as<int>()) | 1; // odd
+                }
+                if (params["kernel_size"]) {
+                    kernel_size_ = max(1, params["kernel_size"].as<int>());
+                }
+                if (params["min_saturation"]) {
+                    min_saturation_ = params["min_saturation"].as<int>();
+                }
+            }
+            kernel_ = cv::getStructuringElement(cv::MORPH_RECT, cv::Size(kernel_size_, kernel_size_));
+            halo_ = blur_ / 2 + 5 * (kernel_size_ / 2);
+            tile_fn_ = [this](int tile) { process_tile(tile); };
+            return true;
+        }
+
+        std::vector<vert::ScratchSpec> scratch(const cv::Size &frame_size, int tiles) const override
+        {
+            std::vector<vert::ScratchSpec> specs;
+            // ping: only tiled rounds after the first need a second full frame
+            specs.push_back({tiles > 1 && iterations_ > 1 ? frame_size : cv::Size(), CV_8UC3});
+            for (int tile = 0; tile < tiles; ++tile) {
+                auto [begin, end] = vert::band_rows(tile, tiles, frame_size.height, 1);
+                cv::Size size(frame_size.width, min(frame_size.height, end + halo_) - max(0, begin - halo_));
+                specs.push_back({size, CV_8UC3}); // blurred
+                specs.push_back({size, CV_8UC3}); // hsv
+                specs.push_back({size, CV_8UC1}); // mask
+                specs.push_back({size, CV_8UC1}); // mask, the other half of the morphology ping pong
+                specs.push_back({size, CV_8UC1}); // outside the mask
+            }
+            return specs;
+        }
+
+        bool process(vert::StageFrame &frame, std::vector<cv::Mat> &scratch) override
+        {
+            const cv::Mat &src = frame.input().bgr();
+            if (src.empty()) {
+                vert::logger->error("test_process cannot convert frame {} (pixel_type {}, cv_type {})", frame.header().id,
+                                    frame.header().pixel_type, frame.header().cv_type);
+                return false;
+            }
+            cv::Mat &dst = frame.output("dst");
+            dst.create(src.size(), src.type());
+
+            frame_ = &frame;
+            scratch_ = &scratch;
+            nonzero_.assign(frame.tiles(), 0);
+            in_ = &src;
+            for (round_ = 0; round_ < iterations_; ++round_) {
+                bool to_ping = frame.tiles() > 1 && (iterations_ - 1 - round_) % 2 == 1;
+                out_ = to_ping ? &scratch[0] : &dst;
+                frame.run_tiles(tile_fn_);
+                in_ = out_;
+            }
+
+            int64_t nonzero = 0;
+            for (int64_t n : nonzero_)
+                nonzero += n;
+            vert::StageResult result;
+            result.label = "foreground";
+            result.value = static_cast<double>(nonzero) / src.total();
+            frame.add_result(std::move(result));
+            return true;
+        }
+
+    private:
+        // one round over the rows of `tile`: in_ -> out_
+        void process_tile(int tile)
+        {
+            const int rows = in_->rows;
+            auto [begin, end] = frame_->tile_rows(tile, rows);
+            const int halo_begin = max(0, begin - halo_);
+            const int halo_end = min(rows, end + halo_);
+
+            cv::Mat *s = scratch_->data() + 1 + 5 * tile;
+            cv::Mat &blurred = s[0];
+            cv::Mat &hsv = s[1];
+            cv::Mat &mask = s[2];
+            cv::Mat &mask2 = s[3];
+            cv::Mat &outside = s[4];
+
+            const int blur_border = cv::BORDER_DEFAULT | cv::BORDER_ISOLATED;
+            const int morph_border = cv::BORDER_CONSTANT | cv::BORDER_ISOLATED;
+            const cv::Point anchor(-1, -1);
+            const cv::Scalar border_value = cv::morphologyDefaultBorderValue();
+
+            cv::GaussianBlur(in_->rowRange(halo_begin, halo_end), blurred, cv::Size(blur_, blur_), 0, 0, blur_border);
+            cv::cvtColor(blurred, hsv, cv::COLOR_BGR2HSV_FULL);
+            cv::inRange(hsv, cv::Scalar(0, min_saturation_, 0), cv::Scalar(255, 255, 255), mask);
+            // open, close, dilate; morphologyEx would run its second pass in place
+            cv::erode(mask, mask2, kernel_, anchor, 1, morph_border, border_value);
+            cv::dilate(mask2, mask, kernel_, anchor, 1, morph_border, border_value);
+            cv::dilate(mask, mask2, kernel_, anchor, 1, morph_border, border_value);
+            cv::erode(mask2, mask, kernel_, anchor, 1, morph_border, border_value);
+            cv::dilate(mask, mask2, kernel_, anchor, 1, morph_border, border_value);
+            cv::bitwise_not(mask2, outside);
+            blurred.setTo(cv::Scalar(0, 0, 0), outside);
+
+            cv::Mat own = out_->rowRange(begin, end);
+            cv::bitwise_not(blurred.rowRange(begin - halo_begin, end - halo_begin), own);
+            if (round_ == iterations_ - 1) {
+                nonzero_[tile] = cv::countNonZero(mask2.rowRange(begin - halo_begin, end - halo_begin));
+            }
+        }
+
+        int iterations_ = 3;
+        int blur_ = 7;
+        int kernel_size_ = 15;
+        int min_saturation_ = 100;
+        cv::Mat kernel_;
+        int halo_ = 0;
+
+        // the frame being processed, for the tiles
+        std::function<void(int)> tile_fn_;
+        vert::StageFrame *frame_ = nullptr;
+        std::vector<cv::Mat> *scratch_ = nullptr;
+        const cv::Mat *in_ = nullptr;
+        cv::Mat *out_ = nullptr;
+        int round_ = 0;
+        std::vector<int64_t> nonzero_;
+    };
+} // namespace
+
+void vert::register_builtin_stages(StageRegistry &registry)
+{
+    registry.add("test_process", vert::make_stage_factory<TestProcessStage>());
+}
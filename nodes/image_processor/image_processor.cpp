@@ -1,10 +1,15 @@
 #include "image_processor.h"
-#include <opencv2/imgproc.hpp>
+#include <chrono>
+#include <limits>
 #include "../utils/logging.h"
 #include "../third_party/zmq_addon.hpp"
-#include "../third_party/msgpack.hpp"
-#include "../utils/types.h"
+#include "../utils/frame_header.h"
+#include "../utils/lazy_frame.h"
 #include "../utils/timer.h"
+#include "../utils/reorder_buffer.h"
+#include "../utils/zmq_utils.h"
+#include "../utils/cv_utils.h"
+#include "../utils/thread_utils.h"
 
 
 using namespace std;
@@ -13,7 +18,8 @@ using vert::logger;
 vert::ImageProcessor::ImageProcessor(zmq::context_t *_ctx)
     : 
     ctx_(_ctx),
-    sub_socket_(*_ctx, zmq::socket_type::sub)
+    sub_socket_(*_ctx, zmq::socket_type::sub),
+    pub_socket_(*_ctx, zmq::socket_type::pub)
 {
 }
 
@@ -37,6 +43,7 @@ bool vert::ImageProcessor::init(const YAML::Node &config)
         } else {
             logger->warn("name not provided."); 
         }
+        node_ = vert::intern_node(name_);
 
         if (config["port"]) {
             if (config["port"]["from"]) {
@@ -46,7 +53,11 @@ bool vert::ImageProcessor::init(const YAML::Node &config)
                 return false;
             }
 
-            // TODO: port.to
+            if (config["port"]["to"]) {
+                addr_to_ = config["port"]["to"].as<std::string>();
+            } else {
+                logger->warn("port.to not provided, {} publishes nothing", name_);
+            }
 
         } else {
             logger->critical("Failed to init {}. Reason: port is empty", name_);
@@ -62,6 +73,96 @@ bool vert::ImageProcessor::init(const YAML::Node &config)
             
         }
 
+        if (config["worker_queue"]) {
+            worker_queue_ = max(1, config["worker_queue"].as<int>());
+        } else {
+            logger->warn("worker_queue not provided. Using default value: {}", worker_queue_);
+        }
+
+        if (config["cpu_affinity"]) {
+            cpu_affinity_ = vert::cpus_from_yaml(config["cpu_affinity"]);
+        }
+
+        if (config["tiles"]) {
+            tiles_ = max(1, config["tiles"].as<int>());
+        }
+        if (tiles_ > 1) {
+            band_pool_ = std::make_unique<BandPool>(tiles_ - 1, name_ + "/tile");
+            logger->info("{} splits frames into {} tiles", name_, tiles_);
+        }
+
+        if (!addr_to_.empty()) {
+            if (config["output"]) {
+                output_image_ = config["output"].as<std::string>();
+            } else {
+                logger->warn("output not provided, publish the last image of the chain");
+            }
+            if (config["meta_encoding"]) {
+                auto encoding = config["meta_encoding"].as<string>();
+                if (!vert::meta_encoding_from_string(encoding, meta_encoding_)) {
+                    logger->warn("unknown meta_encoding {}, use default {}", encoding, vert::meta_encoding_to_string(meta_encoding_));
+                }
+            }
+            if (vert::meta_encoding_for(meta_encoding_, addr_to_) != meta_encoding_) {
+                logger->warn("{} port.to {} leaves the process, meta_encoding set to msgpack", name_, addr_to_);
+                meta_encoding_ = MetaEncoding::Msgpack;
+            }
+            if (config["reorder"]) {
+                const auto &reorder = config["reorder"];
+                if (reorder["window"]) {
+                    reorder_window_ = static_cast<size_t>(max(1, reorder["window"].as<int>()));
+                }
+                if (reorder["max_wait_ms"]) {
+                    reorder_max_wait_ns_ = static_cast<int64_t>(max(0.0, reorder["max_wait_ms"].as<double>()) * 1e6);
+                }
+            } else {
+                logger->warn("reorder not provided, use default window {} and max_wait_ms {}", reorder_window_, reorder_max_wait_ns_ / 1000000);
+            }
+
+            pub_socket_.bind(addr_to_);
+            logger->info("{} pub_socket bind to {}, in order per device (window {}, max wait {} ms)", name_, addr_to_,
+                         reorder_window_, reorder_max_wait_ns_ / 1e6);
+        }
+
+        if (config["check_allocations"] && config["check_allocations"].as<bool>()) {
+            check_allocations_ = true;
+            vert::install_mat_alloc_counter();
+            logger->info("{} counts Mat allocations, frames allocating after warm up are reported", name_);
+        }
+
+        // stage types from shared libraries, before the chain refers to them
+        if (config["plugins"]) {
+            for (const auto &plugin : config["plugins"]) {
+                string path = plugin.as<string>();
+                string error;
+                if (!vert::StageRegistry::instance().load(path, error)) {
+                    logger->critical("Failed to init {}. Reason: cannot load stage plugin {}: {}", name_, path, error);
+                    return false;
+                }
+                logger->info("{} loaded stage plugin {}", name_, path);
+            }
+        }
+
+        YAML::Node chain = config["chain"];
+        if (!chain) {
+            logger->warn("chain not provided. Using default: [test_process]");
+            chain = YAML::Load("[{type: test_process}]");
+        }
+        chains_.clear();
+        stage_timings_.clear();
+        for (int i = 0; i < num_workers_; ++i) {
+            auto worker_chain = std::make_unique<StageChain>();
+            if (!worker_chain->init(chain, name_, stage_timings_)) {
+                return false;
+            }
+            chains_.push_back(std::move(worker_chain));
+        }
+        string stages;
+        for (const auto &timing : stage_timings_) {
+            stages += (stages.empty() ? "" : " -> ") + timing->name;
+        }
+        logger->info("{} chain: {}", name_, stages);
+
 
     } catch(const std::exception& e) {
         vert::logger->critical("Failed to init {}. Reason: {}", name_, e.what());
@@ -79,15 +180,27 @@ void vert::ImageProcessor::start()
     sub_socket_.set(zmq::sockopt::subscribe, ""); // subscribe to all topics
     sub_socket_.set(zmq::sockopt::rcvtimeo, 1000);
 
-    // TODO: outer socket
-
     is_running_.store(true);
+    latency_.reset();
+    reorder_wait_.reset();
+    steady_alloc_frames_ = 0;
+    dropped_count_ = 0;
+    for (auto &timing : stage_timings_) {
+        timing->time.reset();
+    }
+
+    pool_ = std::make_unique<WorkStealingPool<Job>>(num_workers_, static_cast<size_t>(worker_queue_));
 
     receiver_thread_ = thread(&ImageProcessor::receiver_thread_func, this);
 
-    for (int i = 0; i < num_workers_; ++i) { // 4 worker threads
+    for (int i = 0; i < num_workers_; ++i) {
         worker_threads_.emplace_back(&ImageProcessor::worker_thread_func, this, i);
     }
+
+    if (!addr_to_.empty()) {
+        sending_ = true;
+        sender_thread_ = thread(&ImageProcessor::sender_thread_func, this);
+    }
 }
 
 void vert::ImageProcessor::stop()
@@ -99,8 +212,12 @@ void vert::ImageProcessor::stop()
     
     is_running_.store(false);
 
+    // the receiver leaves within rcvtimeo; only then the pool stops taking frames, a submit() into a stopped
+    // pool would count as a drop
+    if (receiver_thread_.joinable())
+        receiver_thread_.join();
     sub_socket_.close();
-    // TODO: close outer push_socket
+    pool_->stop();
 
     for (auto &t : worker_threads_) {
         if (t.joinable()) {
@@ -108,17 +225,33 @@ void vert::ImageProcessor::stop()
         }
     }
 
-    if (receiver_thread_.joinable())
-        receiver_thread_.join();
-
+    // the workers are done: the sender publishes what they left and stops
+    {
+        std::lock_guard<std::mutex> lock(outbox_mutex_);
+        sending_ = false;
+    }
+    outbox_cv_.notify_all();
+    if (sender_thread_.joinable())
+        sender_thread_.join();
+    pub_socket_.close();
+
+    logger->info("{} dispatch: {} frames taken over by idle workers, {} dropped with every worker queue full", name_,
+                 pool_->stolen(), dropped_count_);
+    latency_.report(name_);
+    reorder_wait_.report(name_, "reorder wait");
+    if (check_allocations_) {
+        logger->info("{} {} frames allocated Mat buffers in steady state, {} Mat allocations in the process",
+                     name_, steady_alloc_frames_.load(), vert::mat_allocations_total());
+    }
+    for (const auto &timing : stage_timings_) {
+        timing->time.report(name_, "stage " + timing->name);
+    }
     logger->info("{} stopped", name_);
 }
 
 void vert::ImageProcessor::receiver_thread_func()
 {
-    // use push/pull pattern to achieve load balancing
-    zmq::socket_t push_socket(*ctx_, zmq::socket_type::push);
-    push_socket.bind("inproc://worker");
+    vert::set_current_thread_name(name_ + "/recv");
 
     while (is_running()) {
         vector<zmq::message_t> msgs;
@@ -128,79 +261,163 @@ void vert::ImageProcessor::receiver_thread_func()
         // assert(result && "recv failed");
         assert(*result == 2);
 
-        push_socket.send(std::move(msgs[0]), zmq::send_flags::sndmore); // meta
-        push_socket.send(std::move(msgs[1]), zmq::send_flags::dontwait); // image data
-
+        // handed to the workers as is, the messages keep the upstream buffers
+        Job job;
+        job.meta = std::move(msgs[0]);
+        job.data = std::move(msgs[1]);
+        job.recv_ns = vert::steady_now_ns();
+        if (!pool_->submit(job)) {
+            if (dropped_count_++ == 0) {
+                logger->warn("{} all {} worker queues are full, dropping frames", name_, num_workers_);
+            }
+        }
     }
-
-    push_socket.close();
 }
 
 void vert::ImageProcessor::worker_thread_func(int id)
 {
-    zmq::socket_t pull_socket(*ctx_, zmq::socket_type::pull);
-    pull_socket.connect("inproc://worker");
-    pull_socket.set(zmq::sockopt::rcvtimeo, 1000);
-
-    // zmq::socket_t test_socket(*ctx_, zmq::socket_type::pub);
-    // test_socket.connect("tcp://127.0.0.1:5555");
+    vert::set_current_thread_name(name_ + "/w" + std::to_string(id));
+    if (!cpu_affinity_.empty()) {
+        int cpu = cpu_affinity_[id % cpu_affinity_.size()];
+        if (vert::set_current_thread_affinity({cpu})) {
+            logger->info("{} worker {} pinned to cpu {}", name_, id, cpu);
+        } else {
+            logger->warn("{} failed to pin worker {} to cpu {}", name_, id, cpu);
+        }
+    }
 
-    while (is_running()) {
-        vector<zmq::message_t> msgs;
-        zmq::recv_result_t result = zmq::recv_multipart(pull_socket, std::back_inserter(msgs));
-        if (!result)
+    // raw frames from the adapter are converted here, once per view the stages ask for
+    vert::StageChain &chain = *chains_[id];
+    vert::StageFrame frame;
+    frame.set_tiling(tiles_, band_pool_.get());
+    cv::Size last_size;
+    int same_size_frames = 0;
+    std::atomic<uint64_t> frame_allocations{0}; // this worker's frames, on whatever thread they allocated
+
+    Job job;
+    while (pool_->pop(id, job)) {
+        int64_t recv_ns = job.recv_ns;
+        vert::FrameHeader meta;
+        if (!vert::decode_mat_meta(job.meta.data(), job.meta.size(), meta)) {
+            logger->error("{} worker {} failed to decode meta", name_, id);
             continue;
-        // assert(result && "recv failed");
-        assert(*result == 2);
-
-        auto meta = msgpack::unpack<vert::MatMeta>(static_cast<const uint8_t *>(msgs[0].data()), msgs[0].size());
-        assert(meta.cv_type == CV_8UC1 || meta.cv_type == CV_8UC3);
+        }
 
+        vert::stamp_frame(meta, node_, vert::StampEvent::Ingress, recv_ns);
         vert::log_mat(meta, "Worker recv");
 
-        cv::Mat temp = cv::Mat(meta.height, meta.width, meta.cv_type, msgs[1].data());
-        cv::Mat dst;
-
-        test_process(temp, dst);
-
-        // auto test_meta = meta;
-        // test_meta.device_id = "cam#3";
-        // auto test_meta_data = msgpack::pack(test_meta);
-        // zmq::message_t test_meta_msg(test_meta_data.data(), test_meta_data.size());
-        // test_socket.send(test_meta_msg, zmq::send_flags::sndmore); // meta
+        uint64_t allocations = frame_allocations.load(std::memory_order_relaxed);
+        bool passed;
+        {
+            vert::MatAllocScope scope(&frame_allocations); // covers the tiles on the band pool as well
+            frame.reset(meta, job.data.data(), job.data.size());
+            passed = chain.process(frame);
+        }
+        if (check_allocations_) {
+            cv::Size size(static_cast<int>(meta.width), static_cast<int>(meta.height));
+            same_size_frames = size == last_size ? same_size_frames + 1 : 0;
+            last_size = size;
+            // the first frames of a size allocate the views, scratch and the output buffers parked while published
+            uint64_t allocated = frame_allocations.load(std::memory_order_relaxed) - allocations;
+            if (allocated > 0 && same_size_frames >= kAllocWarmupFrames && steady_alloc_frames_.fetch_add(1) == 0) {
+                logger->error("{} worker {} allocated {} Mat buffers for frame {} in steady state", name_, id, allocated, meta.id);
+            }
+        }
+        if (logger->should_log(spdlog::level::debug)) {
+            logger->debug("{} worker {} frame {}: {}, {} images, {} results", name_, id, meta.id, passed ? "passed" : "dropped",
+                          frame.num_images(), frame.results().size());
+            for (const auto &result : frame.results()) {
+                logger->debug("  {} {}: {}", result.stage, result.label, result.value);
+            }
+        }
 
-        // zmq::message_t test_msg;
-        // test_msg.rebuild(dst.data, dst.total() * dst.elemSize());
-        // test_socket.send(test_msg, zmq::send_flags::dontwait);
+        int64_t done_ns = vert::steady_now_ns();
+        vert::stamp_frame(meta, node_, vert::StampEvent::Egress, done_ns);
+        latency_.add(vert::frame_latency_ns(meta, done_ns));
+        vert::log_latency(meta, "Worker done", done_ns);
 
+        if (addr_to_.empty())
+            continue;
+        // dropped frames go to the sender as well, so the frames behind them do not wait for their id
+        Output out;
+        out.meta = meta;
+        out.done_ns = done_ns;
+        if (passed && frame.num_images() > 0) {
+            // shared, not copied: the next frame gets another buffer while this one is in flight
+            const cv::Mat *image = output_image_.empty() ? &frame.image_at(frame.num_images() - 1) : frame.image(output_image_);
+            if (image) {
+                out.image = *image;
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock(outbox_mutex_);
+            outbox_.push_back(std::move(out));
+        }
+        outbox_cv_.notify_one();
     }
-
-    pull_socket.close();
-    // test_socket.close();
 }
 
-void vert::ImageProcessor::test_process(const cv::Mat &src, cv::Mat &dst)
+void vert::ImageProcessor::sender_thread_func()
 {
-    FUNC_TIMER()
-    src.copyTo(dst);
-
-    for (int i = 0; i < 3; ++i) {
-        cv::GaussianBlur(dst, dst, cv::Size(7, 7), 0);
-
-        cv::Mat hsv, lab;
-        cv::cvtColor(dst, hsv, cv::COLOR_BGR2HSV_FULL);
-
-        cv::Mat mask;
-        cv::inRange(hsv, cv::Scalar(0, 100, 0), cv::Scalar(255, 255, 255), mask);
+    vert::ReorderBuffer<Output> reorder(reorder_window_, reorder_max_wait_ns_);
+    auto emit = [this](Output &&out) { publish(std::move(out)); };
+    vector<Output> batch;
+
+    for (bool sending = true; sending;) {
+        {
+            std::unique_lock<std::mutex> lock(outbox_mutex_);
+            auto ready = [this] { return !outbox_.empty() || !sending_; };
+            int64_t deadline_ns = reorder.next_deadline_ns();
+            if (deadline_ns == std::numeric_limits<int64_t>::max()) {
+                outbox_cv_.wait(lock, ready);
+            } else {
+                outbox_cv_.wait_for(lock, std::chrono::nanoseconds(max<int64_t>(0, deadline_ns - vert::steady_now_ns())), ready);
+            }
+            batch.swap(outbox_);
+            sending = sending_;
+        }
 
-        cv::Mat kernel = cv::getStructuringElement(cv::MORPH_RECT, cv::Size(15, 15));
-        cv::morphologyEx(mask, mask, cv::MORPH_OPEN, kernel);
-        cv::morphologyEx(mask, mask, cv::MORPH_CLOSE, kernel);
-        cv::dilate(mask, mask, kernel);
+        int64_t now_ns = vert::steady_now_ns();
+        for (auto &out : batch) {
+            uint16_t device = out.meta.device;
+            int64_t id = out.meta.id;
+            if (!reorder.push(device, id, std::move(out), now_ns, emit)) {
+                logger->debug("{} frame {} of {} finished after its turn, dropped", name_, id, vert::device_name(device));
+            }
+        }
+        batch.clear();
+        reorder.flush_expired(now_ns, emit);
+    }
+    reorder.flush_all(emit);
 
-        dst.setTo(cv::Scalar(0, 0, 0), ~mask);
+    logger->info("{} published in order: {} frames released, {} late (dropped), {} ids skipped, {} restarts", name_,
+                 reorder.released(), reorder.late(), reorder.skipped(), reorder.restarts());
+}
 
-        cv::bitwise_not(dst, dst);
+void vert::ImageProcessor::publish(Output &&out)
+{
+    if (out.image.empty())
+        return;
+    if (!out.image.isContinuous()) {
+        out.image = out.image.clone();
+    }
+    reorder_wait_.add(vert::steady_now_ns() - out.done_ns);
+
+    vert::FrameHeader meta = out.meta;
+    meta.height = static_cast<uint32_t>(out.image.rows);
+    meta.width = static_cast<uint32_t>(out.image.cols);
+    meta.cv_type = out.image.type();
+    meta.cn = static_cast<uint8_t>(out.image.channels());
+    meta.padding_x = 0;
+    meta.buffer_size = out.image.total() * out.image.elemSize();
+    if (out.image.depth() == CV_8U) {
+        meta.bit_depth = 8;
     }
 
+    zmq::message_t meta_msg = vert::make_mat_meta_msg(meta, meta_encoding_);
+    void *data = out.image.data;
+    zmq::message_t img_msg = vert::make_owned_message(data, meta.buffer_size, std::move(out.image));
+    pub_socket_.send(meta_msg, zmq::send_flags::sndmore);
+    pub_socket_.send(img_msg, zmq::send_flags::dontwait);
+    vert::log_mat(meta, "Published");
 }
@@ -1,14 +1,32 @@
 #ifndef _IMAGE_PROCESSOR_H_
 #define _IMAGE_PROCESSOR_H_
 #include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
 #include <thread>
 #include <string>
+#include <vector>
 #include <opencv2/core.hpp>
 #include <yaml-cpp/yaml.h>
 #include "../third_party/zmq.hpp"
+#include "../utils/frame_header.h"
+#include "../utils/timer.h"
+#include "../utils/band_pool.h"
+#include "../utils/work_stealing_pool.h"
+#include "stage_chain.h"
 
 namespace vert {
 
+    /*
+        receiver ──pool_──> worker 0..N-1 ──outbox_──> sender ──> port.to
+        The receiver deals frames round-robin into the workers' queues, a worker whose queue runs dry takes
+        from the others' (WorkStealingPool), so a slow frame does not hold back the ones queued behind it.
+        Workers finish out of order, the sender puts every device's frames back in id
+        order (ReorderBuffer) before publishing meta + the chain's output image. A missing id holds the frames
+        behind it for at most reorder.max_wait_ms / reorder.window ids, frames finishing after their id was
+        given up are dropped and counted.
+    */
     class ImageProcessor {
     public:
         ImageProcessor(zmq::context_t *ctx);
@@ -23,24 +41,73 @@ namespace vert {
     private:
         void receiver_thread_func();
         void worker_thread_func(int id);
+        void sender_thread_func();
 
-        void test_process(const cv::Mat &src, cv::Mat &dst);
+        // a received frame on its way to a worker, the messages keep the upstream buffers
+        struct Job {
+            zmq::message_t meta;
+            zmq::message_t data;
+            int64_t recv_ns = 0;
+        };
+
+        // what a worker hands to the sender; no image: dropped by the chain, only moves the order on
+        struct Output {
+            FrameHeader meta;
+            cv::Mat image;
+            int64_t done_ns = 0;
+        };
+
+        // meta describing `image`, image shared with zmq
+        void publish(Output &&out);
 
         zmq::context_t *ctx_ = nullptr;
 
         zmq::socket_t sub_socket_;
-        // TODO: socket to outer
+        zmq::socket_t pub_socket_; // port.to, sender thread only
 
         std::atomic<bool> is_running_{false};
 
         std::thread receiver_thread_;
         std::vector<std::thread> worker_threads_;
+        std::thread sender_thread_;
 
         std::string name_ = "ImageProcessor";
         std::string addr_from_;
-        std::string addr_to_;
+        std::string addr_to_; // port.to, empty: publishes nothing
 
         int num_workers_ = 5;
+        int worker_queue_ = 4;         // frames queued per worker, beyond that the receiver drops
+        std::vector<int> cpu_affinity_; // worker i on cpu_affinity_[i % size], empty: not pinned
+
+        std::unique_ptr<WorkStealingPool<Job>> pool_;
+
+        // intra-frame parallelism: stages split each frame into tiles_ horizontal tiles run on band_pool_
+        // (tiles_ - 1 helpers plus the worker itself); 1: every frame on one worker
+        int tiles_ = 1;
+        std::unique_ptr<BandPool> band_pool_;
+        size_t dropped_count_ = 0;     // receiver only, every queue full
+
+        std::string output_image_;  // chain image to publish, empty: the last one produced
+        MetaEncoding meta_encoding_ = MetaEncoding::Binary;
+        size_t reorder_window_ = 32;
+        int64_t reorder_max_wait_ns_ = 100'000'000;
+
+        std::mutex outbox_mutex_;
+        std::condition_variable outbox_cv_;
+        std::vector<Output> outbox_; // finished by the workers, not yet seen by the sender
+        bool sending_ = false;       // guarded by outbox_mutex_, cleared once the workers are joined
+
+        // debug: count Mat allocations per frame, a worker should not allocate once it has seen a few frames of a size
+        static constexpr int kAllocWarmupFrames = 16;
+        bool check_allocations_ = false;
+        std::atomic<uint64_t> steady_alloc_frames_{0};
+
+        std::vector<std::unique_ptr<StageChain>> chains_; // one per worker, built from `chain`
+        StageChain::Timings stage_timings_;               // per stage, shared by all workers
+
+        uint16_t node_ = kUnknownDevice; // interned name_, for frame stamps
+        LatencyStats latency_;
+        LatencyStats reorder_wait_; // worker done -> published
 
     };
 
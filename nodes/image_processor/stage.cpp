@@ -0,0 +1,174 @@
+#include <algorithm>
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#endif
+#include "stage.h"
+#include "../utils/cv_utils.h"
+
+using namespace std;
+
+void vert::StageFrame::reset(const FrameHeader &header, const void *data, size_t size)
+{
+    input_.reset(header, data, size);
+    num_images_ = 0;
+    results_.clear();
+}
+
+const cv::Mat *vert::StageFrame::image(std::string_view name) const
+{
+    for (size_t i = 0; i < num_images_; ++i) {
+        if (images_[i].first == name)
+            return &images_[i].second;
+    }
+    return nullptr;
+}
+
+cv::Mat &vert::StageFrame::output(std::string_view name)
+{
+    for (size_t i = 0; i < num_images_; ++i) {
+        if (images_[i].first == name)
+            return images_[i].second;
+    }
+    // frames of a chain produce the same images in the same order, so the spare at this index is usually
+    // last frame's buffer for this very name
+    if (num_images_ == images_.size()) {
+        images_.emplace_back();
+    }
+    auto &slot = images_[num_images_++];
+    if (slot.first != name) {
+        slot.first = name;
+        slot.second.release();
+    } else if (vert::mat_is_shared(slot.second)) {
+        unshare(slot.second);
+    }
+    return slot.second;
+}
+
+void vert::StageFrame::unshare(cv::Mat &image)
+{
+    for (auto &parked : parked_) {
+        if (!vert::mat_is_shared(parked)) {
+            std::swap(parked, image); // image gets a free buffer (or none), parked keeps the shared one
+            return;
+        }
+    }
+    if (parked_.size() < kMaxParked) {
+        parked_.push_back(std::move(image));
+    } else {
+        image.release();
+    }
+}
+
+void vert::StageFrame::set_tiling(int tiles, BandPool *pool)
+{
+    tiles_ = max(1, tiles);
+    pool_ = pool;
+}
+
+void vert::StageFrame::run_tiles(const std::function<void(int)> &fn) const
+{
+    if (tiles_ > 1 && pool_) {
+        // the tiles run on the pool's threads, their Mat allocations count towards the caller's scope (the frame)
+        std::atomic<uint64_t> *scope = vert::current_mat_alloc_scope();
+        if (scope) {
+            pool_->run(tiles_, [&fn, scope](int tile) {
+                vert::MatAllocScope tile_scope(scope);
+                fn(tile);
+            });
+        } else {
+            pool_->run(tiles_, fn);
+        }
+        return;
+    }
+    for (int tile = 0; tile < tiles_; ++tile)
+        fn(tile);
+}
+
+void vert::StageFrame::add_result(StageResult result)
+{
+    result.stage = stage_;
+    results_.push_back(std::move(result));
+}
+
+vert::StageRegistry &vert::StageRegistry::instance()
+{
+    static StageRegistry registry;
+    return registry;
+}
+
+vert::StageRegistry::StageRegistry()
+{
+    register_builtin_stages(*this);
+}
+
+bool vert::StageRegistry::add(const std::string &type, StageFactory factory)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return factory && factories_.emplace(type, std::move(factory)).second;
+}
+
+std::unique_ptr<vert::Stage> vert::StageRegistry::create(const std::string &type) const
+{
+    StageFactory factory;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = factories_.find(type);
+        if (it == factories_.end())
+            return nullptr;
+        factory = it->second;
+    }
+    return factory();
+}
+
+std::vector<std::string> vert::StageRegistry::types() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<std::string> types;
+    for (const auto &[type, factory] : factories_)
+        types.push_back(type);
+    std::sort(types.begin(), types.end());
+    return types;
+}
+
+bool vert::StageRegistry::load(const std::string &path, std::string &error)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (std::find(loaded_.begin(), loaded_.end(), path) != loaded_.end())
+            return true;
+    }
+
+    using Entry = bool (*)(StageRegistry &);
+    // never unloaded: the stages' code and vtables live in the library
+#if defined(_WIN32)
+    HMODULE library = LoadLibraryA(path.c_str());
+    if (!library) {
+        error = "LoadLibrary failed with error " + std::to_string(GetLastError());
+        return false;
+    }
+    auto entry = reinterpret_cast<Entry>(GetProcAddress(library, VERT_STAGE_PLUGIN_SYMBOL));
+#else
+    void *library = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+    if (!library) {
+        const char *reason = dlerror();
+        error = reason ? reason : "dlopen failed";
+        return false;
+    }
+    auto entry = reinterpret_cast<Entry>(dlsym(library, VERT_STAGE_PLUGIN_SYMBOL));
+#endif
+    if (!entry) {
+        error = "no " VERT_STAGE_PLUGIN_SYMBOL " entry point";
+        return false;
+    }
+    // the entry point calls add(), no lock held here
+    if (!entry(*this)) {
+        error = VERT_STAGE_PLUGIN_SYMBOL " failed";
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    loaded_.push_back(path);
+    return true;
+}
@@ -0,0 +1,162 @@
+#ifndef _STAGE_H_
+#define _STAGE_H_
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <opencv2/core.hpp>
+#include <yaml-cpp/yaml.h>
+#include "../utils/band_pool.h"
+#include "../utils/frame_header.h"
+#include "../utils/lazy_frame.h"
+
+namespace vert {
+
+    // One finding of a stage: a defect, a measurement, a count
+    struct StageResult {
+        std::string stage;  // instance name, filled in by the chain
+        std::string label;
+        double value = 0.0;
+        cv::Rect roi;       // where, empty: the whole frame
+    };
+
+    // One Mat a stage works in
+    struct ScratchSpec {
+        cv::Size size;
+        int type = CV_8UC1;
+    };
+
+    // What the stages of a chain see of one frame. One per worker, reused: images keep their buffers across
+    // frames, so a stage that create()s its output at a steady size does not allocate. An image still shared
+    // when the next frame asks for it (published, waiting in zmq) is parked, and the frame writes into a parked
+    // buffer nobody holds any more instead.
+    class StageFrame
+    {
+    public:
+        // next received frame, `data` must outlive its processing; drops the previous frame's images and results
+        void reset(const FrameHeader &header, const void *data, size_t size);
+
+        // as received, views converted on first use and shared by all stages
+        LazyFrame &input() { return input_; }
+        const FrameHeader &header() const { return input_.header(); }
+
+        // image an earlier stage produced this frame, nullptr if none by that name
+        const cv::Mat *image(std::string_view name) const;
+
+        // image to produce under `name`, a buffer kept from earlier frames (create() it to the size needed)
+        cv::Mat &output(std::string_view name);
+
+        static constexpr size_t kMaxParked = 32; // buffers in flight beyond this are left to their holders
+
+        // images produced this frame, in order
+        size_t num_images() const { return num_images_; }
+        const std::string &image_name(size_t i) const { return images_[i].first; }
+        const cv::Mat &image_at(size_t i) const { return images_[i].second; }
+
+        void add_result(StageResult result);
+        const std::vector<StageResult> &results() const { return results_; }
+
+        // Intra-frame parallelism (image_processor `tiles`): a stage may split its work into tiles() horizontal
+        // tiles and run them on the processor's band pool. 1: whole frames, run_tiles() calls fn(0) inline.
+        void set_tiling(int tiles, BandPool *pool);
+        int tiles() const { return tiles_; }
+
+        // fn(tile) for tile in [0, tiles()), spread over the pool, returns when all of them have returned
+        void run_tiles(const std::function<void(int)> &fn) const;
+
+        // rows [begin, end) a tile owns of `height` rows; it reads its halo beyond them, writes only these
+        std::pair<int, int> tile_rows(int tile, int height) const { return band_rows(tile, tiles_, height, 1); }
+
+    private:
+        friend class StageChain;
+
+        // swaps a buffer shared outside the frame for a parked one that is free again
+        void unshare(cv::Mat &image);
+
+        LazyFrame input_;
+        std::vector<std::pair<std::string, cv::Mat>> images_; // [0, num_images_) belong to this frame, the rest are spare
+        size_t num_images_ = 0;
+        std::vector<StageResult> results_;
+        std::vector<cv::Mat> parked_;
+        int tiles_ = 1;
+        BandPool *pool_ = nullptr;
+        std::string_view stage_; // running stage, set by the chain
+    };
+
+    // A processing step of an image_processor chain. Every worker runs its own instances, so a stage is only
+    // called from one thread and may keep state between frames.
+    class Stage
+    {
+    public:
+        virtual ~Stage() = default;
+
+        // params: the `params` of its chain entry (may be empty), false fails the processor's init
+        virtual bool init(const YAML::Node &params) { (void)params; return true; }
+
+        // Scratch Mats process() works in for frames of `frame_size` split into `tiles` (see StageFrame::tiles).
+        // The chain allocates them before the first frame of that size and passes them in this order on every
+        // call; process() writes into them without reallocating (create() with the same size and type is fine).
+        virtual std::vector<ScratchSpec> scratch(const cv::Size &frame_size, int tiles) const
+        {
+            (void)frame_size;
+            (void)tiles;
+            return {};
+        }
+
+        // false: the frame leaves the chain here (rejected or unusable), later stages do not see it
+        virtual bool process(StageFrame &frame, std::vector<cv::Mat> &scratch) = 0;
+    };
+
+    using StageFactory = std::function<std::unique_ptr<Stage>()>;
+
+    template <typename T>
+    StageFactory make_stage_factory() { return [] { return std::make_unique<T>(); }; }
+
+    // Stage types by name, process wide and thread safe. Built in stages are always there, shared libraries
+    // add theirs through VERT_STAGE_PLUGIN_ENTRY.
+    class StageRegistry
+    {
+    public:
+        static StageRegistry &instance();
+
+        // false if `type` is taken
+        bool add(const std::string &type, StageFactory factory);
+
+        // nullptr for an unknown type
+        std::unique_ptr<Stage> create(const std::string &type) const;
+
+        std::vector<std::string> types() const;
+
+        // Loads a plugin library (once per path) and lets it add its stages, it stays loaded for the life of the
+        // process. Stages cross the library boundary as C++ objects, so plugins are built with the same compiler
+        // and OpenCV as VERT. False and `error` if it cannot be loaded or registered nothing.
+        bool load(const std::string &path, std::string &error);
+
+    private:
+        StageRegistry();
+
+        mutable std::mutex mutex_;
+        std::unordered_map<std::string, StageFactory> factories_;
+        std::vector<std::string> loaded_;
+    };
+
+    // stages every registry starts with: test_process
+    void register_builtin_stages(StageRegistry &registry);
+
+} // namespace vert
+
+// A plugin library defines its entry point with
+//     VERT_STAGE_PLUGIN_ENTRY(registry) { return registry.add("my_stage", vert::make_stage_factory<MyStage>()); }
+#if defined(_WIN32)
+#define VERT_STAGE_EXPORT extern "C" __declspec(dllexport)
+#else
+#define VERT_STAGE_EXPORT extern "C" __attribute__((visibility("default")))
+#endif
+#define VERT_STAGE_PLUGIN_SYMBOL "vert_register_stages"
+#define VERT_STAGE_PLUGIN_ENTRY(registry) VERT_STAGE_EXPORT bool vert_register_stages(vert::StageRegistry &registry)
+
+#endif /* _STAGE_H_ */
@@ -0,0 +1,91 @@
+#include "stage_chain.h"
+#include "../utils/logging.h"
+
+using namespace std;
+
+bool vert::StageChain::init(const YAML::Node &config, const std::string &owner, Timings &timings)
+{
+    name_ = owner + "/chain";
+    entries_.clear();
+
+    if (!config || !config.IsSequence() || config.size() == 0) {
+        vert::logger->critical("Failed to init {}. Reason: chain must list at least one stage", name_);
+        return false;
+    }
+
+    auto &registry = vert::StageRegistry::instance();
+    for (size_t i = 0; i < config.size(); ++i) {
+        const auto &node = config[i];
+        if (!node["type"]) {
+            vert::logger->critical("Failed to init {}. Reason: chain[{}].type is empty", name_, i);
+            return false;
+        }
+        Entry entry;
+        string type = node["type"].as<string>();
+        entry.name = node["name"] ? node["name"].as<string>() : type;
+        entry.stage = registry.create(type);
+        if (!entry.stage) {
+            string known;
+            for (const auto &t : registry.types())
+                known += (known.empty() ? "" : ", ") + t;
+            vert::logger->critical("Failed to init {}. Reason: unknown stage type {} (known: {})", name_, type, known);
+            return false;
+        }
+        if (!entry.stage->init(node["params"])) {
+            vert::logger->critical("Failed to init {}. Reason: stage {} ({}) failed to init", name_, entry.name, type);
+            return false;
+        }
+
+        if (timings.size() <= i) {
+            timings.push_back(std::make_unique<StageTiming>());
+            timings.back()->name = entry.name;
+        }
+        entry.timing = timings[i].get();
+        entries_.push_back(std::move(entry));
+    }
+    return true;
+}
+
+void vert::StageChain::prepare_scratch(Entry &entry, const cv::Size &frame_size, int tiles)
+{
+    auto specs = entry.stage->scratch(frame_size, tiles);
+    entry.scratch.resize(specs.size());
+    entry.scratch_data.resize(specs.size());
+    for (size_t i = 0; i < specs.size(); ++i) {
+        entry.scratch[i].create(specs[i].size, specs[i].type);
+        entry.scratch_data[i] = entry.scratch[i].data;
+    }
+    entry.scratch_size = frame_size;
+    entry.scratch_tiles = tiles;
+}
+
+bool vert::StageChain::process(StageFrame &frame)
+{
+    cv::Size frame_size(static_cast<int>(frame.header().width), static_cast<int>(frame.header().height));
+    for (auto &entry : entries_) {
+        if (entry.scratch_size != frame_size || entry.scratch_tiles != frame.tiles()) {
+            prepare_scratch(entry, frame_size, frame.tiles());
+        }
+
+        frame.stage_ = entry.name;
+        int64_t begin_ns = vert::steady_now_ns();
+        bool passed = entry.stage->process(frame, entry.scratch);
+        entry.timing->time.add(vert::steady_now_ns() - begin_ns);
+
+        if (!entry.warned) {
+            for (size_t i = 0; i < entry.scratch.size(); ++i) {
+                if (entry.scratch[i].data != entry.scratch_data[i]) {
+                    vert::logger->warn("{} stage {} reallocated its scratch {}, declare what it needs in scratch()", name_, entry.name, i);
+                    entry.warned = true;
+                    break;
+                }
+            }
+        }
+        if (!passed) {
+            frame.stage_ = {};
+            return false;
+        }
+    }
+    frame.stage_ = {};
+    return true;
+}
@@ -0,0 +1,59 @@
+#ifndef _STAGE_CHAIN_H_
+#define _STAGE_CHAIN_H_
+#include <memory>
+#include <string>
+#include <vector>
+#include <opencv2/core.hpp>
+#include <yaml-cpp/yaml.h>
+#include "stage.h"
+#include "../utils/timer.h"
+
+namespace vert {
+
+    // The stages of one image_processor worker, in the order of the `chain` list:
+    //   chain:
+    //     - type: test_process   # a registered stage type
+    //       name: blobs          # optional, defaults to the type; names the stage's timing and results
+    //       params: {...}        # handed to Stage::init
+    class StageChain
+    {
+    public:
+        // Per stage timing, shared by every worker's chain built from the same config
+        struct StageTiming {
+            std::string name;
+            LatencyStats time;
+        };
+        using Timings = std::vector<std::unique_ptr<StageTiming>>;
+
+        // `timings` is filled by the first chain and reused by the others; false (logged) on an unknown
+        // type or a stage failing its init
+        bool init(const YAML::Node &config, const std::string &owner, Timings &timings);
+
+        // Runs the stages in order, each timed on its own, scratch (re)allocated when the frame size or tiling changes.
+        // False once a stage drops the frame.
+        bool process(StageFrame &frame);
+
+        size_t size() const { return entries_.size(); }
+
+    private:
+        struct Entry {
+            std::string name;
+            std::unique_ptr<Stage> stage;
+            std::vector<cv::Mat> scratch;
+            std::vector<uchar *> scratch_data; // as allocated, to spot stages reallocating
+            cv::Size scratch_size{-1, -1};
+            int scratch_tiles = 0;
+            bool warned = false;
+            StageTiming *timing = nullptr;
+        };
+
+        void prepare_scratch(Entry &entry, const cv::Size &frame_size, int tiles);
+
+        std::vector<Entry> entries_;
+
+        std::string name_ = "StageChain";
+    };
+
+} // namespace vert
+
+#endif /* _STAGE_CHAIN_H_ */
@@ -3,7 +3,6 @@
 #include <ctime>
 #include <iomanip>
 #include <opencv2/imgcodecs.hpp>
-#include "../third_party/msgpack.hpp"
 #include "../third_party/zmq_addon.hpp"
 #include "../third_party/fmt/format.h"
 #include "../utils/logging.h"
@@ -43,6 +42,7 @@ bool vert::ImageWriter::init(const YAML::Node &config)
         } else {
             vert::logger->warn("name not provided, use default {}", name_); 
         }
+        node_ = vert::intern_node(name_);
 
         if (config["level"]) {
             set_level(config["level"].as<string>());
@@ -126,6 +126,15 @@ bool vert::ImageWriter::init(const YAML::Node &config)
             dst_pattern_ += "bmp";
         }
 
+        if (config["view"]) {
+            auto view = config["view"].as<string>();
+            if (!vert::frame_view_from_string(view, view_)) {
+                vert::logger->warn("unknown view {}, use default raw", view);
+            }
+        } else {
+            vert::logger->warn("view not provided, use default raw");
+        }
+
         config_.recycle_bin = config_.recycle_bin.lexically_normal();
         if (!fs::exists(config_.recycle_bin)) {
             fs::create_directories(config_.recycle_bin);
@@ -175,6 +184,7 @@ void vert::ImageWriter::start()
     rotate();
     if (!is_running_) {
         is_running_ = true;
+        latency_.reset();
         src_thread_ = std::thread(&ImageWriter::loop_src, this);
         dst_thread_ = std::thread(&ImageWriter::loop_dst, this);
         vert::logger->info("{} started", name_);
@@ -192,6 +202,7 @@ void vert::ImageWriter::stop()
         if (dst_thread_.joinable()) {
             dst_thread_.join();
         }
+        latency_.report(name_);
         vert::logger->info("{} stopped", name_);
     }
 }
@@ -265,17 +276,27 @@ void vert::ImageWriter::loop_src()
         zmq::recv_result_t result = zmq::recv_multipart(src_subscriber_, std::back_inserter(msgs));
         if (!result)
             continue;
+        int64_t recv_ns = vert::steady_now_ns();
         // assert(result && "recv failed");
         assert(*result == 2);
 
-        auto meta = msgpack::unpack<vert::MatMeta>(static_cast<const uint8_t *>(msgs[0].data()), msgs[0].size());
-        assert(meta.cv_type == CV_8UC1 || meta.cv_type == CV_8UC3);
-        cv::Mat temp = cv::Mat(meta.height, meta.width, meta.cv_type, msgs[1].data());
+        vert::FrameHeader meta;
+        if (!vert::decode_mat_meta(msgs[0].data(), msgs[0].size(), meta)) {
+            vert::logger->error("{} failed to decode meta", name_);
+            continue;
+        }
+        src_frame_.reset(meta, msgs[1].data(), msgs[1].size());
     
         vert::logger->trace("Recv SRC ID: {} ({} x {})", meta.id, meta.width, meta.height);
 
         if (level_ == ONLY_SRC || level_ == BOTH) {
-            write(temp, meta, src_pattern_); 
+            vert::stamp_frame(meta, node_, vert::StampEvent::Ingress, recv_ns);
+            if (!write(src_frame_, src_pattern_))
+                continue;
+            int64_t done_ns = vert::steady_now_ns();
+            vert::stamp_frame(meta, node_, vert::StampEvent::Egress, done_ns);
+            latency_.add(vert::frame_latency_ns(meta, done_ns));
+            vert::log_latency(meta, "Written SRC", done_ns);
         }
 
     }
@@ -288,24 +309,47 @@ void vert::ImageWriter::loop_dst()
         zmq::recv_result_t result = zmq::recv_multipart(dst_subscriber_, std::back_inserter(msgs));
         if (!result)
             continue;
+        int64_t recv_ns = vert::steady_now_ns();
         // assert(result && "recv failed");
         assert(*result == 2);
     
-        auto meta = msgpack::unpack<vert::MatMeta>(static_cast<const uint8_t *>(msgs[0].data()), msgs[0].size());
-        assert(meta.cv_type == CV_8UC1 || meta.cv_type == CV_8UC3);
-        cv::Mat temp = cv::Mat(meta.height, meta.width, meta.cv_type, msgs[1].data());
+        vert::FrameHeader meta;
+        if (!vert::decode_mat_meta(msgs[0].data(), msgs[0].size(), meta)) {
+            vert::logger->error("{} failed to decode meta", name_);
+            continue;
+        }
+        dst_frame_.reset(meta, msgs[1].data(), msgs[1].size());
     
         vert::logger->trace("Recv DST ID: {} ({} x {})", meta.id, meta.width, meta.height);
 
         if (level_ == ONLY_DST || level_ == BOTH) {
-            write(temp, meta, dst_pattern_); 
+            vert::stamp_frame(meta, node_, vert::StampEvent::Ingress, recv_ns);
+            if (!write(dst_frame_, dst_pattern_))
+                continue;
+            int64_t done_ns = vert::steady_now_ns();
+            vert::stamp_frame(meta, node_, vert::StampEvent::Egress, done_ns);
+            latency_.add(vert::frame_latency_ns(meta, done_ns));
+            vert::log_latency(meta, "Written DST", done_ns);
         }
     }
 }
 
-void vert::ImageWriter::write(const cv::Mat &img, const MatMeta &meta, std::string_view pattern)
+bool vert::ImageWriter::write(LazyFrame &frame, std::string_view pattern)
+{
+    // 16 bit raw views (packed 10 / 12 bit sources) need a png pattern to keep their depth
+    const cv::Mat &img = frame.get(view_);
+    if (img.empty()) {
+        vert::logger->error("{} cannot make a {} view of frame {} (pixel_type {}, cv_type {})", name_, (int)view_,
+                            frame.header().id, frame.header().pixel_type, frame.header().cv_type);
+        return false;
+    }
+    write(img, frame.header(), pattern);
+    return true;
+}
+
+void vert::ImageWriter::write(const cv::Mat &img, const FrameHeader &meta, std::string_view pattern)
 {
-    std::string filename = fmt::format(pattern, meta.device_id, meta.id);
+    std::string filename = fmt::format(pattern, vert::device_name(meta.device), meta.id);
     auto full_path = current_.rotate_paths.back() / filename;
     vert::logger->trace("Writing image: {}", full_path.string());
 
@@ -383,10 +427,10 @@ void vert::ImageWriter::test3()
     config_.max_image_count = 10;
     rotate();
     for (size_t i = 0; i < 20; i++) {
-        MatMeta meta;
+        FrameHeader meta;
         meta.id = i;
         cv::Mat temp(100, 100, CV_8UC3, cv::Scalar(0, 0, 255));
-        write(temp, meta);
+        write(temp, meta, src_pattern_);
         std::this_thread::sleep_for(seconds(1));
     }
     
@@ -398,10 +442,10 @@ void vert::ImageWriter::test4()
     config_.max_image_size = 20000000;
     rotate();
     for (size_t i = 0; i < 20; i++) {
-        MatMeta meta;
+        FrameHeader meta;
         meta.id = i;
         cv::Mat temp(1000, 1000, CV_8UC3, cv::Scalar(0, 0, 255));
-        write(temp, meta);
+        write(temp, meta, src_pattern_);
         std::this_thread::sleep_for(seconds(1));
     }
 }
@@ -412,34 +456,34 @@ void vert::ImageWriter::test5()
     config_.max_image_count = 95;
     rotate();
     for (size_t i = 0; i < 100; i++) {
-        MatMeta meta;
+        FrameHeader meta;
         meta.id = i;
         cv::Mat temp(1000, 1000, CV_8UC3, cv::Scalar(0, 0, 255));
-        write(temp, meta);
+        write(temp, meta, src_pattern_);
         std::this_thread::sleep_for(milliseconds(100));
     }
     rotate();
     for (size_t i = 0; i < 100; i++) {
-        MatMeta meta;
+        FrameHeader meta;
         meta.id = i;
         cv::Mat temp(1000, 1000, CV_8UC3, cv::Scalar(0, 0, 255));
-        write(temp, meta);
+        write(temp, meta, src_pattern_);
         std::this_thread::sleep_for(milliseconds(100));
     }
     rotate();
     for (size_t i = 0; i < 100; i++) {
-        MatMeta meta;
+        FrameHeader meta;
         meta.id = i;
         cv::Mat temp(1000, 1000, CV_8UC3, cv::Scalar(0, 0, 255));
-        write(temp, meta);
+        write(temp, meta, src_pattern_);
         std::this_thread::sleep_for(milliseconds(100));
     }
     rotate();
     for (size_t i = 0; i < 100; i++) {
-        MatMeta meta;
+        FrameHeader meta;
         meta.id = i;
         cv::Mat temp(1000, 1000, CV_8UC3, cv::Scalar(0, 0, 255));
-        write(temp, meta);
+        write(temp, meta, src_pattern_);
         std::this_thread::sleep_for(milliseconds(100));
     }
 }
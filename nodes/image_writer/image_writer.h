@@ -10,7 +10,9 @@
 #include <tuple>
 #include <opencv2/core.hpp>
 #include <yaml-cpp/yaml.h>
-#include "../utils/types.h"
+#include "../utils/frame_header.h"
+#include "../utils/lazy_frame.h"
+#include "../utils/timer.h"
 #include "../third_party/zmq.hpp"
 
 
@@ -72,7 +74,10 @@ namespace vert {
 
         void loop_dst();
 
-        void write(const cv::Mat &img, const MatMeta &meta, std::string_view pattern);
+        // converts `frame` to view_ on demand, false if that is impossible
+        bool write(LazyFrame &frame, std::string_view pattern);
+
+        void write(const cv::Mat &img, const FrameHeader &meta, std::string_view pattern);
 
         void remove_folder(const std::filesystem::path &folder_path);
 
@@ -89,11 +94,16 @@ namespace vert {
         std::thread dst_thread_;
 
         Level level_ = Level::OFF;
+        FrameView view_ = FrameView::Raw;  // what gets written, raw frames are converted here
+        LazyFrame src_frame_;              // src thread only
+        LazyFrame dst_frame_;              // dst thread only
 
         ImageWriterConfig config_;
         ImageWriterState current_;
 
         std::string name_ = "ImageWriter";
+        uint16_t node_ = kUnknownDevice; // interned name_, for frame stamps
+        LatencyStats latency_;
         std::string src_pattern_ = "{}_{:05d}_src.";
         std::string dst_pattern_ = "{}_{:05d}_dst.";
 
@@ -15,6 +15,9 @@
 
 #include "basler_camera.h"
 #include "basler_emulator.h"
+#include "synthetic_source.h"
+#include "frame_replay.h"
+#include "frame_recorder.h"
 #include "camera_adapter.h"
 #include "image_writer.h"
 #include "image_processor.h"
@@ -26,16 +29,45 @@ namespace vert
     using node = std::variant<
         vert::BaslerEmulator,
         vert::BaslerCamera,
+        vert::SyntheticSource,
+        vert::FrameReplay,
+        vert::FrameRecorder,
         vert::CameraAdapter,
         vert::ImageWriter,
         vert::ImageProcessor>;
     
+    // A node key holds either one config (map) or a list of them (sequence),
+    // every entry becomes its own node, e.g. one BaslerCamera per camera of a station
+    template <typename T>
+    bool add_nodes(zmq::context_t *context, const YAML::Node& config, std::vector<std::unique_ptr<vert::node>>& nodes) {
+        auto add = [&](const YAML::Node& entry) {
+            if (entry["is_use"] && !entry["is_use"].as<bool>())
+                return true;
+            auto n = std::make_unique<vert::node>(std::in_place_type<T>, context);
+            if (!std::get<T>(*n).init(entry)) 
+                return false;
+            nodes.push_back(std::move(n));
+            return true;
+        };
+
+        if (config.IsSequence()) {
+            for (const auto& entry : config) {
+                if (!add(entry))
+                    return false;
+            }
+            return true;
+        }
+        return add(config);
+    }
+
     bool create_nodes(zmq::context_t *context, const YAML::Node& config, std::vector<std::unique_ptr<vert::node>>& nodes) {
 
         nodes.clear();
 
         auto is_use = [&config](const string& key) {
             if (config[key]) {
+                if (config[key].IsSequence())
+                    return true; // decided per entry
                 if (config[key]["is_use"])
                     return config[key]["is_use"].as<bool>();
                 return true;
@@ -44,10 +76,8 @@ namespace vert
 
         // 1
         if (is_use("camera_adapter")) {
-            auto adapter = std::make_unique<vert::node>(std::in_place_type<vert::CameraAdapter>, context);
-            if (!std::get<vert::CameraAdapter>(*adapter).init(config["camera_adapter"])) 
+            if (!add_nodes<vert::CameraAdapter>(context, config["camera_adapter"], nodes))
                 return false;
-            nodes.push_back(std::move(adapter));
         }
 
         if (is_use("basler_emulator") && is_use("basler_camera")) {
@@ -56,34 +86,44 @@ namespace vert
 
         // 2.A
         if (is_use("basler_emulator")) {
-            auto emu = std::make_unique<vert::node>(std::in_place_type<vert::BaslerEmulator>, context);
-            if (!std::get<vert::BaslerEmulator>(*emu).init(config["basler_emulator"])) 
+            if (!add_nodes<vert::BaslerEmulator>(context, config["basler_emulator"], nodes))
                 return false;
-            nodes.push_back(std::move(emu));
         }
         
         // 2.B
         if (is_use("basler_camera")) {
-            auto cam = std::make_unique<vert::node>(std::in_place_type<vert::BaslerCamera>, context);
-            if (!std::get<vert::BaslerCamera>(*cam).init(config["basler_camera"])) 
+            if (!add_nodes<vert::BaslerCamera>(context, config["basler_camera"], nodes))
+                return false;
+        }
+        
+        // 2.C
+        if (is_use("synthetic_source")) {
+            if (!add_nodes<vert::SyntheticSource>(context, config["synthetic_source"], nodes))
+                return false;
+        }
+
+        // 2.D
+        if (is_use("frame_replay")) {
+            if (!add_nodes<vert::FrameReplay>(context, config["frame_replay"], nodes))
                 return false;
-            nodes.push_back(std::move(cam));
         }
         
         // 3.A
         if (is_use("image_writer")) {
-            auto writer = std::make_unique<vert::node>(std::in_place_type<vert::ImageWriter>, context);
-            if (!std::get<vert::ImageWriter>(*writer).init(config["image_writer"])) 
+            if (!add_nodes<vert::ImageWriter>(context, config["image_writer"], nodes))
                 return false;
-            nodes.push_back(std::move(writer));
         }
 
         // 3.B Algo
         if (is_use("image_processor")) {
-            auto processor = std::make_unique<vert::node>(std::in_place_type<vert::ImageProcessor>, context);
-            if (!std::get<vert::ImageProcessor>(*processor).init(config["image_processor"])) 
+            if (!add_nodes<vert::ImageProcessor>(context, config["image_processor"], nodes))
+                return false;
+        }
+
+        // 3.C
+        if (is_use("frame_recorder")) {
+            if (!add_nodes<vert::FrameRecorder>(context, config["frame_recorder"], nodes))
                 return false;
-            nodes.push_back(std::move(processor));
         }
 
         // 4 Result Handler
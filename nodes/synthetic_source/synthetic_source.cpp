@@ -0,0 +1,307 @@
+#include "synthetic_source.h"
+#include <array>
+#include <chrono>
+#include <opencv2/imgproc.hpp>
+#include "../utils/logging.h"
+#include "../utils/string_utils.h"
+#include "../utils/cv_utils.h"
+#include "../utils/zmq_utils.h"
+
+using namespace std;
+using namespace std::chrono;
+
+namespace {
+    // pylon EPixelType values (GenICam PFNC), so this node does not need pylon
+    struct SyntheticFormat {
+        const char *name;
+        int32_t pixel_type;
+        int cv_type;
+        bool is_bayer;
+        vert::BayerPattern bayer;
+    };
+
+    const std::array<SyntheticFormat, 7> synthetic_formats = {{
+        {"mono8",      0x01080001, CV_8UC1, false, vert::BayerPattern::RG},
+        {"bayergr8",   0x01080008, CV_8UC1, true,  vert::BayerPattern::GR},
+        {"bayerrg8",   0x01080009, CV_8UC1, true,  vert::BayerPattern::RG},
+        {"bayergb8",   0x0108000A, CV_8UC1, true,  vert::BayerPattern::GB},
+        {"bayerbg8",   0x0108000B, CV_8UC1, true,  vert::BayerPattern::BG},
+        {"rgb8packed", 0x02180014, CV_8UC3, false, vert::BayerPattern::RG},
+        {"bgr8packed", 0x02180015, CV_8UC3, false, vert::BayerPattern::RG},
+    }};
+
+    const SyntheticFormat *find_format(std::string_view name)
+    {
+        auto lower = vert::to_lower(name);
+        if (lower == "bgr8" || lower == "bgr")
+            lower = "bgr8packed";
+        else if (lower == "rgb8" || lower == "rgb")
+            lower = "rgb8packed";
+        else if (lower == "mono" || lower == "gray")
+            lower = "mono8";
+        else if (lower == "bayer")
+            lower = "bayerrg8";
+
+        for (const auto &format : synthetic_formats) {
+            if (lower == format.name)
+                return &format;
+        }
+        return nullptr;
+    }
+}
+
+vert::SyntheticSource::SyntheticSource(zmq::context_t *ctx)
+    : publisher_(*ctx, zmq::socket_type::push)
+{
+}
+
+vert::SyntheticSource::~SyntheticSource()
+{
+    if (is_running())
+        stop();
+}
+
+bool vert::SyntheticSource::init(const YAML::Node &config)
+{
+    vert::logger->info("Initializing SyntheticSource ...");
+    try {
+        if (!config) {
+            vert::logger->critical("Failed to init SyntheticSource. Reason: config is empty");
+            return false;
+        }
+
+        if (config["name"]) {
+            name_ = config["name"].as<string>();
+        } else {
+            vert::logger->warn("name not provided.");
+        }
+
+        string addr;
+        if (config["port"]) {
+            addr = config["port"].as<string>();
+            publisher_.connect(addr);
+            vert::logger->info("{} connected to {}", name_, addr);
+        } else {
+            vert::logger->critical("Failed to init '{}'. Reason: port is empty", name_);
+            return false;
+        }
+
+        if (config["user_id"]) {
+            user_id_ = config["user_id"].as<string>();
+        } else {
+            vert::logger->warn("user_id not provided, use default {}.", user_id_);
+        }
+        device_ = vert::intern_device(user_id_);
+
+        if (config["width"]) {
+            cfg_.width = config["width"].as<int>();
+        } else {
+            vert::logger->warn("width not provided, use default {}.", cfg_.width);
+        }
+
+        if (config["height"]) {
+            cfg_.height = config["height"].as<int>();
+        } else {
+            vert::logger->warn("height not provided, use default {}.", cfg_.height);
+        }
+
+        if (cfg_.width <= 0 || cfg_.height <= 0 || cfg_.width % 2 || cfg_.height % 2) {
+            vert::logger->critical("Failed to init '{}'. Reason: invalid size {}x{} (must be even)", name_, cfg_.width, cfg_.height);
+            return false;
+        }
+
+        if (config["pixel_format"]) {
+            cfg_.pixel_format = config["pixel_format"].as<string>();
+        } else {
+            vert::logger->warn("pixel_format not provided, use default {}.", cfg_.pixel_format);
+        }
+
+        if (config["fps"]) {
+            cfg_.fps = config["fps"].as<double>();
+        } else {
+            vert::logger->warn("fps not provided, use default {}.", cfg_.fps);
+        }
+
+        if (config["profile"]) {
+            cfg_.profile = FramePacer::profile_from_string(config["profile"].as<string>());
+        }
+
+        if (config["burst_size"]) {
+            cfg_.burst_size = config["burst_size"].as<int>();
+        }
+
+        if (config["jitter_us"]) {
+            cfg_.jitter_us = config["jitter_us"].as<double>();
+        }
+
+        if (config["num_frames"]) {
+            cfg_.num_frames = max(1, config["num_frames"].as<int>());
+        }
+
+        if (config["max_images"]) {
+            cfg_.max_images = config["max_images"].as<int64_t>();
+        }
+
+        if (config["meta_encoding"]) {
+            auto encoding = config["meta_encoding"].as<string>();
+            if (!vert::meta_encoding_from_string(encoding, cfg_.meta_encoding)) {
+                vert::logger->warn("unknown meta_encoding {}, use default {}", encoding, vert::meta_encoding_to_string(cfg_.meta_encoding));
+            }
+        }
+        if (vert::meta_encoding_for(cfg_.meta_encoding, addr) != cfg_.meta_encoding) {
+            vert::logger->warn("{} port {} leaves the process, meta_encoding set to msgpack", name_, addr);
+            cfg_.meta_encoding = MetaEncoding::Msgpack;
+        }
+
+        if (!generate_frames())
+            return false;
+
+    } catch (const YAML::Exception& e) {
+        vert::logger->critical("Failed to init '{}'. Reason: {}", name_, e.what());
+        return false;
+    } catch (const std::exception& e) {
+        vert::logger->critical("Failed to init '{}'. Reason: {}", name_, e.what());
+        return false;
+    }
+
+    if (cfg_.fps > 0) {
+        vert::logger->info("{} {}x{} {} @ {} fps, profile {}", name_, cfg_.width, cfg_.height, cfg_.pixel_format, cfg_.fps, (int)cfg_.profile);
+    } else {
+        vert::logger->info("{} {}x{} {} as fast as possible", name_, cfg_.width, cfg_.height, cfg_.pixel_format);
+    }
+    vert::logger->info("{} initialized successfully", name_);
+    return true;
+}
+
+void vert::SyntheticSource::start()
+{
+    vert::logger->info("{} starting...", name_);
+    if (!is_running_) {
+        is_running_ = true;
+        loop_thread_ = std::thread(&SyntheticSource::loop, this);
+        vert::logger->info("{} started", name_);
+    }
+}
+
+void vert::SyntheticSource::stop()
+{
+    vert::logger->info("{} stopping...", name_);
+    if (is_running_) {
+        is_running_ = false;
+        if (loop_thread_.joinable()) {
+            loop_thread_.join();
+        }
+        vert::logger->info("{} stopped", name_);
+    }
+}
+
+void vert::SyntheticSource::loop()
+{
+    pacer_.configure(cfg_.fps, cfg_.profile, cfg_.burst_size, cfg_.jitter_us);
+    pacer_.reset();
+    error_count_ = 0;
+
+    int64_t frame_id = 0;
+    auto t_start = steady_clock::now();
+
+    while (is_running_ && (cfg_.max_images < 0 || frame_id < cfg_.max_images)) {
+        pacer_.wait_next();
+
+        const cv::Mat &frame = frames_[frame_id % frames_.size()];
+        size_t bufsize = frame.total() * frame.elemSize();
+
+        vert::FrameHeader header;
+        header.device = device_;
+        header.id = frame_id;
+        header.timestamp = vert::steady_now_ns();
+        header.grab_ns = static_cast<int64_t>(header.timestamp);
+        header.exposure_ns = header.grab_ns; // synthetic frames are "exposed" when sent
+        header.error_cnt = error_count_;
+        header.buffer_size = bufsize;
+        header.height = frame.rows;
+        header.width = frame.cols;
+        header.pixel_type = pixel_type_;
+
+        zmq::message_t meta_msg = vert::make_grab_meta_msg(header, cfg_.meta_encoding);
+        publisher_.send(meta_msg, zmq::send_flags::sndmore);
+
+        // frames are never written after init, the Mat copy only holds a reference
+        zmq::message_t msg = vert::make_owned_message(frame.data, bufsize, cv::Mat(frame));
+        if (!publisher_.send(msg, zmq::send_flags::dontwait)) {
+            error_count_++;
+        }
+
+        frame_id++;
+    }
+
+    double elapsed = duration<double>(steady_clock::now() - t_start).count();
+    vert::logger->info("{} sent {} frames in {:.2f} s ({:.1f} fps), errors {}",
+                       name_, frame_id, elapsed, elapsed > 0 ? frame_id / elapsed : 0.0, error_count_);
+}
+
+bool vert::SyntheticSource::generate_frames()
+{
+    const SyntheticFormat *format = find_format(cfg_.pixel_format);
+    if (!format) {
+        vert::logger->critical("Failed to init '{}'. Reason: pixel_format {} not supported (Mono8, BGR8Packed, RGB8Packed, BayerGR8, BayerRG8, BayerGB8, BayerBG8)",
+                               name_, cfg_.pixel_format);
+        return false;
+    }
+    pixel_type_ = format->pixel_type;
+
+    frames_.clear();
+    for (int i = 0; i < cfg_.num_frames; ++i) {
+        cv::Mat bgr = render_pattern(i);
+        cv::Mat frame;
+
+        if (format->cv_type == CV_8UC3) {
+            if (format->pixel_type == 0x02180014)
+                cv::cvtColor(bgr, frame, cv::COLOR_BGR2RGB);
+            else
+                frame = bgr;
+        } else if (format->is_bayer) {
+            vert::bgr_to_bayer(bgr, frame, format->bayer);
+        } else {
+            cv::cvtColor(bgr, frame, cv::COLOR_BGR2GRAY);
+        }
+
+        frames_.push_back(frame);
+    }
+
+    vert::logger->info("{} generated {} frames of {} bytes", name_, frames_.size(), frames_[0].total() * frames_[0].elemSize());
+    return true;
+}
+
+cv::Mat vert::SyntheticSource::render_pattern(int index) const
+{
+    cv::Mat bgr(cfg_.height, cfg_.width, CV_8UC3);
+
+    // diagonal gradient, shifted per frame so consecutive frames differ
+    int shift = index * 16;
+    for (int y = 0; y < bgr.rows; ++y) {
+        uint8_t *row = bgr.ptr<uint8_t>(y);
+        for (int x = 0; x < bgr.cols; ++x) {
+            row[x * 3 + 0] = static_cast<uint8_t>((x + shift) * 255 / bgr.cols);
+            row[x * 3 + 1] = static_cast<uint8_t>((y + shift) * 255 / bgr.rows);
+            row[x * 3 + 2] = static_cast<uint8_t>((x + y + shift) & 0xFF);
+        }
+    }
+
+    // color bars on top
+    static const std::array<cv::Scalar, 8> bars = {
+        cv::Scalar(255, 255, 255), cv::Scalar(0, 255, 255), cv::Scalar(255, 255, 0), cv::Scalar(0, 255, 0),
+        cv::Scalar(255, 0, 255), cv::Scalar(0, 0, 255), cv::Scalar(255, 0, 0), cv::Scalar(0, 0, 0)};
+    int bar_width = bgr.cols / static_cast<int>(bars.size());
+    for (int i = 0; i < static_cast<int>(bars.size()); ++i) {
+        cv::rectangle(bgr, cv::Rect(i * bar_width, 0, bar_width, bgr.rows / 4), bars[i], cv::FILLED);
+    }
+
+    // moving box, makes dropped / reordered frames visible
+    int box = std::max(8, bgr.rows / 8);
+    int x = (index * box) % std::max(1, bgr.cols - box);
+    cv::rectangle(bgr, cv::Rect(x, bgr.rows / 2, box, box), cv::Scalar(255, 255, 255), cv::FILLED);
+    cv::putText(bgr, std::to_string(index), cv::Point(x, bgr.rows / 2 + box + 40),
+                cv::FONT_HERSHEY_SIMPLEX, 1.5, cv::Scalar(0, 0, 255), 3);
+
+    return bgr;
+}
@@ -0,0 +1,70 @@
+#ifndef _SYNTHETIC_SOURCE_H_
+#define _SYNTHETIC_SOURCE_H_
+
+#include <atomic>
+#include <thread>
+#include <string>
+#include <vector>
+#include <opencv2/core.hpp>
+#include <yaml-cpp/yaml.h>
+#include "../utils/frame_header.h"
+#include "../utils/frame_pacer.h"
+#include "../third_party/zmq.hpp"
+
+namespace vert {
+
+    // Camera-less frame source for load testing. Speaks the same wire protocol as BaslerBase
+    // (grab meta + raw payload on a push socket) and does not touch pylon.
+    class SyntheticSource
+    {
+        struct SyntheticSourceConfig {
+            int width = 1920;
+            int height = 1080;
+            std::string pixel_format = "BayerRG8";
+            double fps = 30.0; // <= 0: as fast as possible
+            FramePacer::Profile profile = FramePacer::Profile::Steady;
+            int burst_size = 10;
+            double jitter_us = 0.0;
+            int num_frames = 8; // distinct pregenerated frames, replayed round robin
+            int64_t max_images = -1;
+            MetaEncoding meta_encoding = MetaEncoding::Binary;
+        };
+
+    public:
+        SyntheticSource(zmq::context_t *ctx);
+        ~SyntheticSource();
+
+        bool init(const YAML::Node &config);
+
+        void start();
+        void stop();
+        bool is_running() const {return is_running_.load();}
+
+    private:
+        void loop();
+
+        bool generate_frames();
+
+        cv::Mat render_pattern(int index) const;
+
+        zmq::socket_t publisher_;
+
+        std::atomic<bool> is_running_{false};
+        std::thread loop_thread_;
+
+        std::vector<cv::Mat> frames_; // immutable once started, shared with zmq zero-copy
+        int32_t pixel_type_ = 0;
+
+        FramePacer pacer_;
+        SyntheticSourceConfig cfg_;
+
+        uint16_t device_ = kUnknownDevice;
+        size_t error_count_ = 0;
+
+        std::string name_ = "SyntheticSource";
+        std::string user_id_ = "synthetic";
+    };
+
+} // namespace vert
+
+#endif /* _SYNTHETIC_SOURCE_H_ */
@@ -0,0 +1,71 @@
+#ifndef _BAND_POOL_H_
+#define _BAND_POOL_H_
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace vert
+{
+    // Persistent helper threads that split one frame's conversion into horizontal bands.
+    //
+    // run() queues its bands and works on them itself, so it returns as soon as every band is done and a pool
+    // of 0 threads simply runs them inline. Several threads (the adapter's converter workers) may call run()
+    // at once; their bands share the helpers first come first served.
+    class BandPool
+    {
+    public:
+        explicit BandPool(int num_threads, const std::string &name = "band");
+        ~BandPool();
+
+        BandPool(const BandPool &) = delete;
+        BandPool &operator=(const BandPool &) = delete;
+
+        int num_threads() const { return static_cast<int>(threads_.size()); }
+
+        // fn(band) for band in [0, num_bands), returns when all of them have returned
+        void run(int num_bands, const std::function<void(int)> &fn);
+
+    private:
+        struct Job {
+            const std::function<void(int)> *fn = nullptr;
+            int num_bands = 0;
+            int next = 0; // next band to hand out, guarded by mutex_
+            int done = 0; // guarded by mutex_
+        };
+
+        void loop(int index);
+
+        // next band of the oldest job, false if there is none; caller holds mutex_
+        bool claim(Job *&job, int &band);
+
+        // caller holds mutex_
+        void finish(Job *job);
+
+        std::mutex mutex_;
+        std::condition_variable work_cv_;
+        std::condition_variable done_cv_;
+        std::deque<Job *> jobs_;
+        bool stopping_ = false;
+        std::string name_;
+        std::vector<std::thread> threads_;
+    };
+
+    // Rows [begin, end) of `band` out of `num_bands` over `height` rows, boundaries on multiples of `align`
+    // (2 keeps the Bayer phase, a preview factor keeps whole preview rows). Bands differ by at most `align` rows.
+    inline std::pair<int, int> band_rows(int band, int num_bands, int height, int align = 2)
+    {
+        int blocks = (height + align - 1) / align;
+        int begin = static_cast<int>(static_cast<long long>(blocks) * band / num_bands) * align;
+        int end = static_cast<int>(static_cast<long long>(blocks) * (band + 1) / num_bands) * align;
+        return {begin < height ? begin : height, end < height ? end : height};
+    }
+
+} // namespace vert
+
+#endif /* _BAND_POOL_H_ */
@@ -0,0 +1,79 @@
+#ifndef _BUFFER_POOL_H_
+#define _BUFFER_POOL_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include "../third_party/zmq.hpp"
+#include "mpmc_queue.h"
+
+namespace vert
+{
+    // Fixed number of equally sized, page aligned buffers in one arena, handed out as zmq
+    // messages without copying. A slot goes back to the lock-free free list when the last
+    // message over it is released, from whatever thread zmq drops it on.
+    //
+    // The pool is reference counted (owner + every message in flight), so it may be dropped
+    // by its owner while subscribers still hold frames; it deletes itself after the last one.
+    class BufferPool
+    {
+    public:
+        struct Releaser {
+            void operator()(BufferPool *pool) const { pool->release(); }
+        };
+        using Ptr = std::unique_ptr<BufferPool, Releaser>;
+
+        // nullptr if the arena cannot be allocated
+        static Ptr create(size_t num_buffers, size_t buffer_size, bool hugepages = false);
+
+        BufferPool(const BufferPool &) = delete;
+        BufferPool &operator=(const BufferPool &) = delete;
+
+        // another owner reference, keeps the pool alive while the caller holds slots of it
+        Ptr share();
+
+        // -1 when every buffer is held downstream
+        int acquire();
+
+        // return a slot that was acquired but never published
+        void give_back(int slot);
+
+        uint8_t *data(int slot) const { return arena_ + static_cast<size_t>(slot) * slot_stride_; }
+
+        // `refs` messages are going to be built over `slot`, it is recycled after the last one
+        void publish(int slot, uint32_t refs);
+
+        // message over [ptr, ptr + size) inside a published slot, one of its `refs`
+        zmq::message_t make_message(int slot, void *ptr, size_t size);
+
+        size_t num_buffers() const { return num_buffers_; }
+        size_t buffer_size() const { return buffer_size_; }
+        size_t available() const { return free_list_.size_approx(); }
+        bool is_huge() const { return is_huge_; }
+
+    private:
+        BufferPool(size_t num_buffers, size_t buffer_size);
+        ~BufferPool();
+
+        void release();
+        void release_slot(int slot);
+
+        static void free_message(void *data, void *hint);
+
+        uint8_t *arena_ = nullptr;
+        size_t arena_size_ = 0;
+        bool is_huge_ = false;
+
+        size_t num_buffers_;
+        size_t buffer_size_;
+        size_t slot_stride_;
+
+        std::unique_ptr<std::atomic<uint32_t>[]> slot_refs_;
+        MpmcQueue<int> free_list_;
+        std::atomic<size_t> refs_{1}; // owner
+    };
+
+} // namespace vert
+
+#endif /* _BUFFER_POOL_H_ */
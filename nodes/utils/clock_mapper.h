@@ -0,0 +1,74 @@
+#ifndef _CLOCK_MAPPER_H_
+#define _CLOCK_MAPPER_H_
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+
+namespace vert
+{
+    // Maps a device tick counter (e.g. the camera timestamp) onto the host steady_clock.
+    // Fed with (ticks, host_ns) pairs taken at the same instant, it keeps a least squares line
+    // over the last `window` pairs, so both the offset and the clock drift are tracked.
+    //
+    // Samples come in from one sync thread now and then, conversions run on the grab thread for
+    // every frame: writers serialize on a mutex and publish the fitted line under a sequence
+    // counter, readers never block.
+    class ClockMapper
+    {
+    public:
+        // `nominal_ns_per_tick` is used until two samples are in, 1.0 for ns tick counters
+        explicit ClockMapper(size_t window = 32, double nominal_ns_per_tick = 1.0);
+
+        void add_sample(int64_t ticks, int64_t host_ns);
+        void reset(double nominal_ns_per_tick);
+
+        // host steady_clock ns, 0 without any sample. Lock free
+        int64_t to_host_ns(int64_t ticks) const;
+
+        bool ready() const;
+        size_t num_samples() const;
+
+        // fitted rate against the nominal one, in parts per million
+        double drift_ppm() const;
+
+    private:
+        struct Sample {
+            int64_t ticks;
+            int64_t host_ns;
+        };
+
+        // host_ns = host_ref + offset + slope * (ticks - tick_ref)
+        struct Line {
+            int64_t tick_ref = 0;
+            int64_t host_ref = 0;
+            double offset = 0.0;
+            double slope = 1.0;
+            double nominal_ns_per_tick = 1.0;
+            size_t num_samples = 0;
+        };
+
+        Line fit() const;
+        void publish(const Line &line);
+        Line snapshot() const;
+
+        std::mutex mutex_; // writers
+        std::deque<Sample> samples_;
+        size_t window_;
+        double nominal_ns_per_tick_;
+
+        // seqlock, odd while publish() rewrites the fields below
+        std::atomic<uint32_t> seq_{0};
+        std::atomic<int64_t> tick_ref_{0};
+        std::atomic<int64_t> host_ref_{0};
+        std::atomic<double> offset_{0.0};
+        std::atomic<double> slope_{1.0};
+        std::atomic<double> nominal_{1.0};
+        std::atomic<size_t> num_samples_{0};
+    };
+
+} // namespace vert
+
+#endif /* _CLOCK_MAPPER_H_ */
@@ -0,0 +1,29 @@
+#ifndef _CPU_FEATURES_H_
+#define _CPU_FEATURES_H_
+
+#include <string_view>
+
+namespace vert
+{
+    // x86 vector extensions the hand written kernels are built for, ordered by width
+    enum class SimdLevel : int {
+        Scalar = 0,
+        SSE41 = 1,
+        AVX2 = 2,
+        AVX512 = 3, // F + BW
+        Best = 100  // whatever the cpu supports
+    };
+
+    // Detected once. Requires both cpu and OS support (saved ymm / zmm state).
+    SimdLevel cpu_simd_level();
+
+    // min(wanted, cpu_simd_level())
+    SimdLevel clamp_simd_level(SimdLevel wanted);
+
+    // scalar, sse4.1, avx2, avx512, best
+    bool simd_level_from_string(std::string_view s, SimdLevel &level);
+    const char *simd_level_to_string(SimdLevel level);
+
+} // namespace vert
+
+#endif /* _CPU_FEATURES_H_ */
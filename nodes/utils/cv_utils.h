@@ -2,10 +2,52 @@
 #define _CV_UTILS_H_
 
 #include <opencv2/core.hpp>
+#include <atomic>
+#include <cstdint>
 #include <string>
+#include "debayer.h"
 
 namespace vert {
 
+    // Sample the plane a bayer sensor would see at each site
+    void bgr_to_bayer(const cv::Mat &bgr, cv::Mat &bayer, BayerPattern pattern);
+
+    // OpenCV COLOR_Bayer*2BGR / 2GRAY code for a GenICam pattern, OpenCV names it after the second row
+    int cv_bayer_to_bgr_code(BayerPattern pattern);
+    int cv_bayer_to_gray_code(BayerPattern pattern);
+
+    // Debug aid: counts cv::Mat buffer allocations per thread. Installs a counting wrapper around OpenCV's
+    // default allocator, process wide and for good (idempotent); memory is still allocated by OpenCV.
+    void install_mat_alloc_counter();
+    bool mat_alloc_counter_installed();
+
+    // buffers allocated by the calling thread / all threads since the counter was installed, 0 without it
+    uint64_t mat_allocations_this_thread();
+    uint64_t mat_allocations_total();
+
+    // While alive, buffers the calling thread allocates are also counted into `counter` (the innermost scope counts).
+    // Work a thread hands to helpers (tiles) can be attributed to it by opening its current scope there too.
+    class MatAllocScope
+    {
+    public:
+        explicit MatAllocScope(std::atomic<uint64_t> *counter);
+        ~MatAllocScope();
+
+        MatAllocScope(const MatAllocScope &) = delete;
+        MatAllocScope &operator=(const MatAllocScope &) = delete;
+
+    private:
+        std::atomic<uint64_t> *prev_;
+    };
+
+    // the innermost scope open on the calling thread, nullptr if none
+    std::atomic<uint64_t> *current_mat_alloc_scope();
+
+    // true while a Mat other than `m` shares m's buffer (a published frame still in flight)
+    inline bool mat_is_shared(const cv::Mat &m) {
+        return m.u && CV_XADD(&m.u->refcount, 0) > 1;
+    }
+
     inline std::string cv_type_to_str(int type) {
         std::string r;
         
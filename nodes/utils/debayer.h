@@ -0,0 +1,52 @@
+#ifndef _DEBAYER_H_
+#define _DEBAYER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include "cpu_features.h"
+
+namespace vert
+{
+    // GenICam naming, the first two pixels of the first row: BayerRG8 starts R G / G B.
+    // Note OpenCV names its COLOR_Bayer codes after the second row, GenICam RG is OpenCV's BG.
+    enum class BayerPattern : uint8_t {
+        RG = 0,
+        GR = 1,
+        BG = 2,
+        GB = 3
+    };
+
+    // Bilinear demosaicing of 8 bit Bayer to packed BGR8 (3 bytes per pixel).
+    // Missing colors are the rounded mean of the nearest 2 or 4 samples of that color, borders
+    // are reflected without repeating the edge (OpenCV's BORDER_REFLECT_101), which keeps the
+    // Bayer phase. Every SimdLevel produces bit identical output to the scalar reference.
+    // Strides are in bytes, width and height >= 2.
+    void debayer_bilinear(const uint8_t *src, size_t src_stride, uint8_t *dst, size_t dst_stride,
+                          int width, int height, BayerPattern pattern, SimdLevel level = SimdLevel::Best);
+
+    // Same, only output rows [row_begin, row_end); neighbours are still read from the whole image,
+    // so disjoint row ranges can be converted concurrently.
+    void debayer_bilinear_rows(const uint8_t *src, size_t src_stride, uint8_t *dst, size_t dst_stride,
+                               int width, int height, BayerPattern pattern, int row_begin, int row_end,
+                               SimdLevel level = SimdLevel::Best);
+
+    // debayer_bilinear plus a box filtered 1/factor preview (see box_downscale) in the same pass: every band of
+    // `factor` rows is downscaled while it is still in cache, so the preview adds no trip to memory.
+    // The preview is (width / factor) x (height / factor) BGR8.
+    void debayer_bilinear_preview(const uint8_t *src, size_t src_stride, uint8_t *dst, size_t dst_stride,
+                                  int width, int height, BayerPattern pattern, int factor,
+                                  uint8_t *preview, size_t preview_stride, SimdLevel level = SimdLevel::Best);
+
+    // Same, only output rows [row_begin, row_end) and the preview rows they complete. Both bounds are multiples
+    // of `factor` (row_end may also be `height`), so disjoint ranges can run concurrently.
+    void debayer_bilinear_preview_rows(const uint8_t *src, size_t src_stride, uint8_t *dst, size_t dst_stride,
+                                       int width, int height, BayerPattern pattern, int factor,
+                                       uint8_t *preview, size_t preview_stride, int row_begin, int row_end,
+                                       SimdLevel level = SimdLevel::Best);
+
+    // Level debayer_bilinear actually runs for `wanted` on this cpu / build
+    SimdLevel debayer_simd_level(SimdLevel wanted = SimdLevel::Best);
+
+} // namespace vert
+
+#endif /* _DEBAYER_H_ */
@@ -0,0 +1,26 @@
+#ifndef _DOWNSCALE_H_
+#define _DOWNSCALE_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace vert
+{
+    // 1, 2, 4 or 8
+    bool is_valid_downscale_factor(int factor);
+
+    // (width / factor, height / factor), the remainder at the right / bottom edge is dropped
+    inline int downscaled_size(int size, int factor) { return size / factor; }
+
+    // Box filter: every output pixel is the rounded mean of a factor x factor block of 8 bit samples.
+    // 1 or 3 interleaved channels per pixel, strides in bytes.
+    void box_downscale(const uint8_t *src, size_t src_stride, int width, int height, int channels, int factor,
+                       uint8_t *dst, size_t dst_stride);
+
+    // Only output rows [row_begin, row_end), reading source rows [row_begin * factor, row_end * factor)
+    void box_downscale_rows(const uint8_t *src, size_t src_stride, int width, int channels, int factor,
+                            uint8_t *dst, size_t dst_stride, int row_begin, int row_end);
+
+} // namespace vert
+
+#endif /* _DOWNSCALE_H_ */
@@ -0,0 +1,139 @@
+#ifndef _FRAME_HEADER_H_
+#define _FRAME_HEADER_H_
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <type_traits>
+#include "types.h"
+
+namespace vert
+{
+    constexpr uint32_t kFrameMagic = 0x54524556; // "VERT" in little endian
+    constexpr uint16_t kFrameHeaderVersion = 3;
+    constexpr size_t kMaxFrameStamps = 5;
+    constexpr uint16_t kUnknownDevice = 0xFFFF;
+
+    enum class MetaEncoding : uint8_t {
+        Binary = 0,  // FrameHeader, fixed layout, no allocation
+        Msgpack = 1  // GrabMeta / MatMeta, for external consumers (UI)
+    };
+
+    enum class StampEvent : uint8_t {
+        Ingress = 0, // frame received by a node
+        Egress = 1   // frame sent on / done by a node
+    };
+
+    struct FrameStamp {
+        uint16_t node = kUnknownDevice; // see intern_node()
+        StampEvent event = StampEvent::Ingress;
+        uint8_t reserved = 0;
+        uint32_t offset_us = 0;         // since FrameHeader::grab_ns, saturates
+    };
+
+    // Fixed layout meta sent in front of every frame.
+    // Replaces GrabMeta (pixel_type set, cv_type == -1) and MatMeta (cv_type set) on the hot path.
+    // Only valid inside one process: `device` is an index into the process wide intern table.
+    struct FrameHeader {
+        uint32_t magic = kFrameMagic;
+        uint16_t version = kFrameHeaderVersion;
+        uint16_t device = kUnknownDevice; // see intern_device()
+        int64_t id = 0;
+        uint64_t timestamp = 0;
+        uint64_t error_cnt = 0;
+        uint64_t buffer_size = 0;
+        uint32_t height = 0;
+        uint32_t width = 0;
+        int32_t pixel_type = 0;          // pylon EPixelType of the source buffer
+        int32_t cv_type = -1;            // -1 until converted
+        uint32_t padding_x = 0;
+        uint8_t cn = 0;
+        uint8_t num_stamps = 0;
+        uint8_t bit_depth = 8;           // significant bits per sample, 10 / 12 for unpacked 16 bit output
+        uint8_t reserved = 0;
+        // host steady_clock, ns since its epoch
+        int64_t grab_ns = 0;             // frame entered the process (grab callback)
+        int64_t exposure_ns = 0;         // camera timestamp mapped to the host clock, 0 if unknown
+        FrameStamp stamps[kMaxFrameStamps] = {};
+        uint64_t reserved2 = 0;
+    };
+
+    static_assert(std::is_trivially_copyable_v<FrameHeader>, "FrameHeader must be trivially copyable");
+    static_assert(sizeof(FrameHeader) == 128, "FrameHeader layout changed, bump kFrameHeaderVersion");
+
+    // Process wide device_id <-> index table. Interning takes a lock, lookup is lock free.
+    uint16_t intern_device(std::string_view device_id);
+    std::string_view device_name(uint16_t device);
+
+    // Node names share the table, stamps only carry the index
+    inline uint16_t intern_node(std::string_view name) { return intern_device(name); }
+    inline std::string_view node_name(uint16_t node) { return device_name(node); }
+
+    bool meta_encoding_from_string(std::string_view s, MetaEncoding &encoding);
+    const char *meta_encoding_to_string(MetaEncoding encoding);
+
+    // Encoding for a socket on `address`: binary headers carry process local device indices, so only
+    // inproc:// peers get `requested`, anything leaving the process (tcp, ipc) gets msgpack.
+    MetaEncoding meta_encoding_for(MetaEncoding requested, std::string_view address);
+
+    inline int64_t steady_now_ns() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // Appends an ingress/egress stamp, further stamps are dropped once the header is full
+    inline void stamp_frame(FrameHeader &header, uint16_t node, StampEvent event, int64_t now_ns = steady_now_ns()) {
+        if (header.num_stamps >= kMaxFrameStamps || header.grab_ns == 0)
+            return;
+        int64_t offset_us = (now_ns - header.grab_ns) / 1000;
+        FrameStamp &stamp = header.stamps[header.num_stamps++];
+        stamp.node = node;
+        stamp.event = event;
+        stamp.offset_us = static_cast<uint32_t>(offset_us < 0 ? 0 : (offset_us > UINT32_MAX ? UINT32_MAX : offset_us));
+    }
+
+    // Exposure to `now_ns`, from grab if the exposure time is unknown, -1 if neither is set
+    inline int64_t frame_latency_ns(const FrameHeader &header, int64_t now_ns = steady_now_ns()) {
+        if (header.exposure_ns != 0)
+            return now_ns - header.exposure_ns;
+        if (header.grab_ns != 0)
+            return now_ns - header.grab_ns;
+        return -1;
+    }
+
+    // In place view of a binary header, nullptr if `data` is not one (or is misaligned)
+    inline const FrameHeader *peek_frame_header(const void *data, size_t size) {
+        if (size != sizeof(FrameHeader) || reinterpret_cast<uintptr_t>(data) % alignof(FrameHeader) != 0)
+            return nullptr;
+        auto *header = static_cast<const FrameHeader *>(data);
+        if (header->magic != kFrameMagic || header->version != kFrameHeaderVersion)
+            return nullptr;
+        return header;
+    }
+
+    inline bool read_frame_header(const void *data, size_t size, FrameHeader &out) {
+        if (size != sizeof(FrameHeader))
+            return false;
+        uint32_t magic = 0;
+        uint16_t version = 0;
+        std::memcpy(&magic, data, sizeof(magic));
+        std::memcpy(&version, static_cast<const uint8_t *>(data) + sizeof(magic), sizeof(version));
+        if (magic != kFrameMagic || version != kFrameHeaderVersion)
+            return false;
+        std::memcpy(&out, data, sizeof(FrameHeader));
+        return true;
+    }
+
+    FrameHeader to_frame_header(const GrabMeta &meta);
+    FrameHeader to_frame_header(const MatMeta &meta);
+    GrabMeta to_grab_meta(const FrameHeader &header);
+    MatMeta to_mat_meta(const FrameHeader &header);
+
+    // Binary header first, msgpack GrabMeta / MatMeta as fallback
+    bool decode_grab_meta(const void *data, size_t size, FrameHeader &out);
+    bool decode_mat_meta(const void *data, size_t size, FrameHeader &out);
+
+} // namespace vert
+
+#endif /* _FRAME_HEADER_H_ */
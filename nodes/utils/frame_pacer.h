@@ -0,0 +1,110 @@
+#ifndef _FRAME_PACER_H_
+#define _FRAME_PACER_H_
+
+#include <chrono>
+#include <random>
+#include <thread>
+#include <string_view>
+#include "string_utils.h"
+
+namespace vert
+{
+    // Paces a frame source on an absolute schedule, so sleeping late does not accumulate drift.
+    //  Steady: one frame every 1/fps
+    //  Burst:  burst_size frames back to back, then idle, average rate stays fps
+    //  Jitter: every frame shifted by a uniform random offset in [-jitter, +jitter]
+    // fps <= 0 means as fast as possible.
+    class FramePacer
+    {
+    public:
+        using clock = std::chrono::steady_clock;
+
+        enum class Profile {
+            Steady = 0,
+            Burst = 1,
+            Jitter = 2
+        };
+
+        static Profile profile_from_string(std::string_view profile) {
+            auto lower = vert::to_lower(profile);
+            if (lower == "burst")
+                return Profile::Burst;
+            if (lower == "jitter")
+                return Profile::Jitter;
+            return Profile::Steady;
+        }
+
+        void configure(double fps, Profile profile = Profile::Steady, int burst_size = 1, double jitter_us = 0.0) {
+            fps_ = fps;
+            profile_ = profile;
+            burst_size_ = burst_size > 0 ? burst_size : 1;
+            jitter_ = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double, std::micro>(jitter_us));
+            if (fps_ > 0) {
+                period_ = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(1.0 / fps_));
+            }
+        }
+
+        bool unthrottled() const { return fps_ <= 0; }
+
+        void reset() {
+            next_ = clock::now();
+            in_burst_ = 0;
+        }
+
+        // Blocks until the next frame is due
+        void wait_next() {
+            if (unthrottled())
+                return;
+
+            auto due = next_;
+            switch (profile_) {
+            case Profile::Burst:
+                if (++in_burst_ >= burst_size_) {
+                    in_burst_ = 0;
+                    next_ += period_ * burst_size_;
+                }
+                break;
+            case Profile::Jitter: {
+                std::uniform_int_distribution<clock::rep> dist(-jitter_.count(), jitter_.count());
+                due += clock::duration(dist(rng_));
+                next_ += period_;
+                break;
+            }
+            default:
+                next_ += period_;
+                break;
+            }
+
+            sleep_until(due);
+        }
+
+        // Waits for an explicit gap, e.g. replaying recorded timestamps
+        void wait_for(clock::duration gap) {
+            next_ += gap;
+            sleep_until(next_);
+        }
+
+    private:
+        static void sleep_until(clock::time_point due) {
+            // OS sleep is coarse (~1 ms on windows), spin for the tail
+            constexpr auto spin = std::chrono::microseconds(1500);
+            auto now = clock::now();
+            if (due - now > spin)
+                std::this_thread::sleep_until(due - spin);
+            while (clock::now() < due)
+                std::this_thread::yield();
+        }
+
+        double fps_ = 0.0;
+        Profile profile_ = Profile::Steady;
+        int burst_size_ = 1;
+        int in_burst_ = 0;
+        clock::duration period_{0};
+        clock::duration jitter_{0};
+        clock::time_point next_ = clock::now();
+        std::mt19937_64 rng_{std::random_device{}()};
+    };
+
+} // namespace vert
+
+#endif /* _FRAME_PACER_H_ */
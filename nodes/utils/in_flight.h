@@ -0,0 +1,63 @@
+#ifndef _IN_FLIGHT_H_
+#define _IN_FLIGHT_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <thread>
+
+namespace vert
+{
+    // Number of frames a producer has lent to zmq consumers without copying. Shared by the
+    // producer and every frame it lends, so a frame released after its producer is gone
+    // still finds a live counter.
+    class InFlightCounter
+    {
+    public:
+        using Ptr = std::shared_ptr<InFlightCounter>;
+
+        static Ptr create() { return std::make_shared<InFlightCounter>(); }
+
+        size_t count() const { return count_.load(std::memory_order_acquire); }
+
+        // false if frames are still in flight after `timeout`
+        bool wait_idle(std::chrono::milliseconds timeout) const {
+            auto deadline = std::chrono::steady_clock::now() + timeout;
+            while (count() > 0) {
+                if (std::chrono::steady_clock::now() > deadline)
+                    return false;
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            return true;
+        }
+
+    private:
+        friend class InFlightToken;
+        std::atomic<size_t> count_{0};
+    };
+
+    // One lent frame, counted from construction until destruction. Move only, a moved-from
+    // token counts nothing. Owners destroy it after whatever it guards is released.
+    class InFlightToken
+    {
+    public:
+        explicit InFlightToken(InFlightCounter::Ptr counter) : counter_(std::move(counter)) {
+            counter_->count_.fetch_add(1, std::memory_order_acq_rel);
+        }
+        InFlightToken(InFlightToken &&other) noexcept = default;
+        InFlightToken(const InFlightToken &) = delete;
+        InFlightToken &operator=(const InFlightToken &) = delete;
+        InFlightToken &operator=(InFlightToken &&) = delete;
+        ~InFlightToken() {
+            if (counter_)
+                counter_->count_.fetch_sub(1, std::memory_order_acq_rel);
+        }
+
+    private:
+        InFlightCounter::Ptr counter_;
+    };
+
+} // namespace vert
+
+#endif /* _IN_FLIGHT_H_ */
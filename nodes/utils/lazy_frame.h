@@ -0,0 +1,74 @@
+#ifndef _LAZY_FRAME_H_
+#define _LAZY_FRAME_H_
+
+#include <cstddef>
+#include <string_view>
+#include <opencv2/core.hpp>
+#include "frame_header.h"
+#include "cpu_features.h"
+
+namespace vert
+{
+    enum class FrameView : uint8_t {
+        Raw = 0,  // as published: camera pixels for raw frames (packed ones unpacked to CV_16UC1), else the converted image
+        Gray = 1, // CV_8UC1
+        BGR = 2   // CV_8UC3
+    };
+
+    // raw, gray, bgr
+    bool frame_view_from_string(std::string_view s, FrameView &view);
+
+    // One received frame, converted on first request and cached per view.
+    //
+    // Works for both kinds of frames on a node port: raw frames forwarded by the adapter (converter.use: raw,
+    // header.cv_type == -1, pixel_type and padding_x describe the buffer) and converted ones (cv_type set).
+    // A consumer asks for the view it needs, so a Bayer frame nobody wants in color is never demosaiced.
+    //
+    // Not thread safe. reset() keeps the cache buffers, so one LazyFrame per consumer thread converts
+    // without allocating once sizes settle; Mats handed out are only valid until the next reset().
+    class LazyFrame
+    {
+    public:
+        LazyFrame() = default;
+        LazyFrame(const FrameHeader &header, const void *data, size_t size, SimdLevel level = SimdLevel::Best);
+
+        // next frame, `data` must outlive every use of this frame's views
+        void reset(const FrameHeader &header, const void *data, size_t size, SimdLevel level = SimdLevel::Best);
+
+        const FrameHeader &header() const { return header_; }
+
+        // pixel_type describes the buffer, nothing converted upstream
+        bool is_raw() const { return header_.cv_type == -1; }
+
+        // empty Mat if the buffer is too small or its format unknown
+        const cv::Mat &get(FrameView view);
+        const cv::Mat &raw() { return get(FrameView::Raw); }
+        const cv::Mat &gray() { return get(FrameView::Gray); }
+        const cv::Mat &bgr() { return get(FrameView::BGR); }
+
+        // views converted so far, for statistics
+        int conversions() const { return conversions_; }
+
+    private:
+        bool make_raw();
+        bool make_gray();
+        bool make_bgr();
+
+        // Raw view scaled to 8 bit when it holds 10 / 12 / 16 bit samples
+        const cv::Mat &raw8();
+
+        FrameHeader header_;
+        const void *data_ = nullptr;
+        size_t size_ = 0;
+        SimdLevel level_ = SimdLevel::Best;
+
+        cv::Mat views_[3];
+        bool ready_[3] = {false, false, false};
+        cv::Mat raw8_;
+        bool raw8_ready_ = false;
+        int conversions_ = 0;
+    };
+
+} // namespace vert
+
+#endif /* _LAZY_FRAME_H_ */
@@ -12,7 +12,7 @@
 #include <spdlog/sinks/base_sink.h>
 #include "../third_party/zmq.hpp"
 #include "../third_party/fmt/format.h"
-#include "types.h"
+#include "frame_header.h"
 #include "cv_utils.h"
 
 
@@ -102,10 +102,11 @@ private:
 using zmq_sink_mt = zmq_sink<std::mutex>;
 using zmq_sink_st = zmq_sink<spdlog::details::null_mutex>;
 
-inline void log_mat(const MatMeta& meta, std::string_view action) 
+inline void log_mat(const FrameHeader& meta, std::string_view action) 
 {
-    logger->debug("{} Mat ID: {} Timestamp: {} ({} x {} {}) Error: {}",
+    logger->debug("{} Mat Device: {} ID: {} Timestamp: {} ({} x {} {}) Error: {}",
                   action,
+                  vert::device_name(meta.device),
                   meta.id,
                   meta.timestamp,
                   meta.width,
@@ -114,6 +115,29 @@ inline void log_mat(const MatMeta& meta, std::string_view action)
                   meta.error_cnt);
 }
 
+// Exposure (or grab) to now plus the per node trail, e.g. "CameraAdapter#0 in +0.21 out +1.80"
+inline void log_latency(const FrameHeader& meta, std::string_view action, int64_t now_ns = vert::steady_now_ns())
+{
+    if (!logger->should_log(spdlog::level::debug))
+        return;
+
+    fmt::memory_buffer trail;
+    for (size_t i = 0; i < meta.num_stamps && i < kMaxFrameStamps; ++i) {
+        const auto& stamp = meta.stamps[i];
+        fmt::format_to(std::back_inserter(trail), " {} {} +{:.2f}",
+                       vert::node_name(stamp.node),
+                       stamp.event == StampEvent::Ingress ? "in" : "out",
+                       stamp.offset_us / 1000.0);
+    }
+    logger->debug("{} Device: {} ID: {} latency {:.2f} ms ({}), since grab:{}",
+                  action,
+                  vert::device_name(meta.device),
+                  meta.id,
+                  vert::frame_latency_ns(meta, now_ns) / 1e6,
+                  meta.exposure_ns != 0 ? "from exposure" : "from grab",
+                  fmt::to_string(trail));
+}
+
 }
 
 #endif
@@ -0,0 +1,53 @@
+#ifndef _MEMORY_UTILS_H_
+#define _MEMORY_UTILS_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace vert
+{
+    size_t page_size();
+
+    // 0 if the OS has no large page support
+    size_t huge_page_size();
+
+    inline size_t align_up(size_t size, size_t alignment) {
+        return (size + alignment - 1) / alignment * alignment;
+    }
+
+    // Page aligned, pre-faulted anonymous memory. With `hugepages` it tries large pages first
+    // and falls back to normal pages, `is_huge` tells which one was used.
+    void *alloc_pages(size_t size, bool hugepages, bool *is_huge = nullptr);
+
+    void free_pages(void *ptr, size_t size, bool is_huge);
+
+    // Read only file mapping
+    class MappedFile
+    {
+    public:
+        MappedFile() = default;
+        ~MappedFile();
+
+        MappedFile(const MappedFile &) = delete;
+        MappedFile &operator=(const MappedFile &) = delete;
+
+        bool open(const std::string &path);
+        void close();
+
+        const uint8_t *data() const { return data_; }
+        size_t size() const { return size_; }
+        bool is_open() const { return data_ != nullptr; }
+
+    private:
+        const uint8_t *data_ = nullptr;
+        size_t size_ = 0;
+#ifdef _WIN32
+        void *file_ = nullptr;
+        void *mapping_ = nullptr;
+#endif
+    };
+
+} // namespace vert
+
+#endif /* _MEMORY_UTILS_H_ */
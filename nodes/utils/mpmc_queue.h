@@ -0,0 +1,119 @@
+#ifndef _MPMC_QUEUE_H_
+#define _MPMC_QUEUE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+namespace vert
+{
+    // Bounded lock-free multi producer / multi consumer queue (Dmitry Vyukov's design).
+    // Every cell carries a sequence number telling whether it is ready for the next push or pop,
+    // so producers and consumers only contend on their own position counter.
+    // Capacity is rounded up to a power of two. try_push / try_pop never block.
+    template <typename T>
+    class MpmcQueue
+    {
+        static_assert(std::is_nothrow_move_assignable_v<T>, "T must be nothrow move assignable");
+
+    public:
+        explicit MpmcQueue(size_t capacity)
+        {
+            size_t n = 2;
+            while (n < capacity)
+                n <<= 1;
+            mask_ = n - 1;
+            cells_.reset(new Cell[n]);
+            for (size_t i = 0; i < n; ++i)
+                cells_[i].seq.store(i, std::memory_order_relaxed);
+        }
+
+        MpmcQueue(const MpmcQueue &) = delete;
+        MpmcQueue &operator=(const MpmcQueue &) = delete;
+
+        // `value` is only moved from when it was pushed, a full queue leaves it to the caller
+        template <typename U>
+        bool try_push(U &&value)
+        {
+            size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+            Cell *cell;
+            for (;;) {
+                cell = &cells_[pos & mask_];
+                size_t seq = cell->seq.load(std::memory_order_acquire);
+                intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+                if (diff == 0) {
+                    if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                        break;
+                } else if (diff < 0) {
+                    return false; // full
+                } else {
+                    pos = enqueue_pos_.load(std::memory_order_relaxed);
+                }
+            }
+            cell->data = std::forward<U>(value);
+            cell->seq.store(pos + 1, std::memory_order_release);
+            return true;
+        }
+
+        // For a queue sized to hold every item in circulation (free lists), where being full is impossible:
+        // try_push still fails for a moment while a consumer is half way through popping the cell this push
+        // wraps around to, so retry instead of losing the item.
+        template <typename U>
+        void push_spin(U &&value)
+        {
+            while (!try_push(std::forward<U>(value)))
+                std::this_thread::yield();
+        }
+
+        bool try_pop(T &value)
+        {
+            size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+            Cell *cell;
+            for (;;) {
+                cell = &cells_[pos & mask_];
+                size_t seq = cell->seq.load(std::memory_order_acquire);
+                intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+                if (diff == 0) {
+                    if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                        break;
+                } else if (diff < 0) {
+                    return false; // empty
+                } else {
+                    pos = dequeue_pos_.load(std::memory_order_relaxed);
+                }
+            }
+            value = std::move(cell->data);
+            cell->data = T(); // types whose move swaps (zmq::message_t) would leave the old value parked here
+            cell->seq.store(pos + mask_ + 1, std::memory_order_release);
+            return true;
+        }
+
+        size_t capacity() const { return mask_ + 1; }
+
+        // only a hint while other threads push / pop
+        size_t size_approx() const
+        {
+            size_t enq = enqueue_pos_.load(std::memory_order_relaxed);
+            size_t deq = dequeue_pos_.load(std::memory_order_relaxed);
+            return enq > deq ? enq - deq : 0;
+        }
+
+    private:
+        struct Cell {
+            std::atomic<size_t> seq;
+            T data;
+        };
+
+        std::unique_ptr<Cell[]> cells_;
+        size_t mask_ = 0;
+
+        alignas(64) std::atomic<size_t> enqueue_pos_{0};
+        alignas(64) std::atomic<size_t> dequeue_pos_{0};
+    };
+
+} // namespace vert
+
+#endif /* _MPMC_QUEUE_H_ */
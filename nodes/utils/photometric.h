@@ -0,0 +1,44 @@
+#ifndef _PHOTOMETRIC_H_
+#define _PHOTOMETRIC_H_
+
+#include <cstddef>
+#include <cstdint>
+#include "cpu_features.h"
+
+namespace vert
+{
+    // Per sample photometric correction in one pass:
+    //   t   = min(((max(in - offset, 0) + 0.5) * gain) >> kPhotometricGainBits, 2^bits - 1)
+    //   out = lut[c][t]
+    // offset (dark frame) and gain (flat field) are per sample maps laid out like the image rows, both or neither
+    // (nullptr: no map).
+    // lut holds `channels` tables of 2^bits entries (per channel white balance, gamma), nullptr: identity.
+    // Samples are taken at the centre of their bin, so a gain of 1.0 is exact.
+
+    // gain maps are unsigned fixed point, 1 << kPhotometricGainBits = 1.0, up to 16x
+    constexpr int kPhotometricGainBits = 12;
+
+    // 8, 10 or 12 significant bits (the gain step works in 16 bit lanes)
+    inline bool is_supported_photometric_bits(int bits) { return bits == 8 || bits == 10 || bits == 12; }
+
+    // `count` samples of one row, `channels` (1 or 3) interleaved, the row starts on channel 0
+    void photometric_row_8(const uint8_t *src, uint8_t *dst, size_t count, int channels,
+                           const uint16_t *offset, const uint16_t *gain, const uint8_t *lut, SimdLevel level = SimdLevel::Best);
+    void photometric_row_16(const uint16_t *src, uint16_t *dst, size_t count, int channels, int bits,
+                            const uint16_t *offset, const uint16_t *gain, const uint16_t *lut, SimdLevel level = SimdLevel::Best);
+
+    // Rows [row_begin, row_end) of a width x channels image, dst may be src. Strides in bytes,
+    // map_stride in bytes between rows of offset / gain.
+    void photometric_rows_8(const uint8_t *src, size_t src_stride, uint8_t *dst, size_t dst_stride, int width, int channels,
+                            const uint16_t *offset, const uint16_t *gain, size_t map_stride, const uint8_t *lut,
+                            int row_begin, int row_end, SimdLevel level = SimdLevel::Best);
+    void photometric_rows_16(const uint16_t *src, size_t src_stride, uint16_t *dst, size_t dst_stride, int width, int channels, int bits,
+                             const uint16_t *offset, const uint16_t *gain, size_t map_stride, const uint16_t *lut,
+                             int row_begin, int row_end, SimdLevel level = SimdLevel::Best);
+
+    // Level photometric_* actually runs for `wanted` on this cpu / build
+    SimdLevel photometric_simd_level(SimdLevel wanted = SimdLevel::Best);
+
+} // namespace vert
+
+#endif /* _PHOTOMETRIC_H_ */
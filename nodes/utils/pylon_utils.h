@@ -15,6 +15,7 @@
 #include <pylon/PixelType.h>
 #include <opencv2/core.hpp>
 #include "string_utils.h"
+#include "debayer.h"
 
 namespace vert
 {
@@ -92,6 +93,7 @@ namespace Pylon
 
 namespace vert
 {
+    // -1 for packed formats, their buffer is a bit stream and has no OpenCV type
     inline int pixel_type_to_cv_type(int pixel_type) {
         switch (pixel_type) {
             case Pylon::PixelType_Mono8: return CV_8UC1;
@@ -105,6 +107,42 @@ namespace vert
         } 
     }
 
+    // bits per sample of the PFNC packed formats (Mono10p, BayerRG12p, ...) vert can unpack, 0 for anything else
+    inline int packed_bit_depth(int pixel_type) {
+        switch (pixel_type) {
+            case Pylon::PixelType_Mono10p:
+            case Pylon::PixelType_BayerRG10p:
+            case Pylon::PixelType_BayerBG10p:
+            case Pylon::PixelType_BayerGR10p:
+            case Pylon::PixelType_BayerGB10p: return 10;
+            case Pylon::PixelType_Mono12p:
+            case Pylon::PixelType_BayerRG12p:
+            case Pylon::PixelType_BayerBG12p:
+            case Pylon::PixelType_BayerGR12p:
+            case Pylon::PixelType_BayerGB12p: return 12;
+            default: return 0;
+        }
+    }
+
+    // false for anything but the 8 bit and packed Bayer formats
+    inline bool pixel_type_to_bayer_pattern(int pixel_type, BayerPattern &pattern) {
+        switch (pixel_type) {
+            case Pylon::PixelType_BayerRG8:
+            case Pylon::PixelType_BayerRG10p:
+            case Pylon::PixelType_BayerRG12p: pattern = BayerPattern::RG; return true;
+            case Pylon::PixelType_BayerGR8:
+            case Pylon::PixelType_BayerGR10p:
+            case Pylon::PixelType_BayerGR12p: pattern = BayerPattern::GR; return true;
+            case Pylon::PixelType_BayerBG8:
+            case Pylon::PixelType_BayerBG10p:
+            case Pylon::PixelType_BayerBG12p: pattern = BayerPattern::BG; return true;
+            case Pylon::PixelType_BayerGB8:
+            case Pylon::PixelType_BayerGB10p:
+            case Pylon::PixelType_BayerGB12p: pattern = BayerPattern::GB; return true;
+            default: return false;
+        }
+    }
+
     inline std::string pixel_type_to_string(Pylon::EPixelType pixel_type) {
         return Pylon::CPixelTypeMapper::GetNameByPixelType(pixel_type);
     }
@@ -115,6 +153,27 @@ namespace vert
 
     bool set_pixel_format(Pylon::CBaslerUniversalInstantCamera &camera, std::string_view format);
 
+    // one_by_one, latest_only, latest (keeps output_queue_size newest), upcoming
+    inline bool grab_strategy_from_string(std::string_view name, Pylon::EGrabStrategy &strategy) {
+        auto s = vert::to_lower(name);
+        if (s == "one_by_one") strategy = Pylon::GrabStrategy_OneByOne;
+        else if (s == "latest_only") strategy = Pylon::GrabStrategy_LatestImageOnly;
+        else if (s == "latest") strategy = Pylon::GrabStrategy_LatestImages;
+        else if (s == "upcoming") strategy = Pylon::GrabStrategy_UpcomingImage;
+        else return false;
+        return true;
+    }
+
+    inline const char *grab_strategy_to_string(Pylon::EGrabStrategy strategy) {
+        switch (strategy) {
+            case Pylon::GrabStrategy_OneByOne: return "one_by_one";
+            case Pylon::GrabStrategy_LatestImageOnly: return "latest_only";
+            case Pylon::GrabStrategy_LatestImages: return "latest";
+            case Pylon::GrabStrategy_UpcomingImage: return "upcoming";
+            default: return "unknown";
+        }
+    }
+
     inline std::string get_camera_info(const Pylon::CBaslerUniversalInstantCamera &camera) {
         std::stringstream message;
         message << "Camera Device Information\n"
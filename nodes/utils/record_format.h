@@ -0,0 +1,64 @@
+#ifndef _RECORD_FORMAT_H_
+#define _RECORD_FORMAT_H_
+
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <filesystem>
+#include "../third_party/fmt/format.h"
+
+// On disk layout of FrameRecorder / FrameReplay.
+//
+// A recording is a folder of segments, each segment is a pair of files:
+//   <prefix>_<NNNNN>.vrec  SegmentHeader, then per frame: RecordHeader, meta bytes, payload
+//   <prefix>_<NNNNN>.vidx  IndexEntry per frame, appended as frames are written
+// Payloads start on kRecordAlign so replay can publish them straight from the mapping.
+
+namespace vert
+{
+    constexpr uint32_t kSegmentMagic = 0x43455256; // "VREC"
+    constexpr uint32_t kRecordMagic = 0x44524556;  // "VERD"
+    constexpr uint16_t kRecordVersion = 1;
+    constexpr size_t kRecordAlign = 64;
+
+    struct SegmentHeader {
+        uint32_t magic = kSegmentMagic;
+        uint16_t version = kRecordVersion;
+        uint16_t reserved = 0;
+        uint64_t created_ns = 0; // system clock, for humans
+        uint8_t padding[48] = {};
+    };
+
+    struct RecordHeader {
+        uint32_t magic = kRecordMagic;
+        uint32_t meta_size = 0;
+        uint64_t payload_size = 0;
+        uint64_t payload_offset = 0; // absolute, in the segment file
+        int64_t recv_ns = 0;         // since recording start
+        char device_id[32] = {};     // binary FrameHeader only carries a process local index
+    };
+
+    struct IndexEntry {
+        uint64_t record_offset = 0;
+        uint64_t payload_offset = 0;
+        uint64_t payload_size = 0;
+        uint32_t meta_size = 0;
+        uint32_t reserved = 0;
+        int64_t recv_ns = 0;
+    };
+
+    static_assert(sizeof(SegmentHeader) == kRecordAlign, "SegmentHeader layout changed");
+    static_assert(sizeof(RecordHeader) % 8 == 0, "RecordHeader layout changed");
+    static_assert(std::is_trivially_copyable_v<IndexEntry>, "IndexEntry must be trivially copyable");
+
+    inline std::filesystem::path segment_path(const std::filesystem::path &folder, const std::string &prefix, size_t index) {
+        return folder / fmt::format("{}_{:05d}.vrec", prefix, index);
+    }
+
+    inline std::filesystem::path index_path(const std::filesystem::path &folder, const std::string &prefix, size_t index) {
+        return folder / fmt::format("{}_{:05d}.vidx", prefix, index);
+    }
+
+} // namespace vert
+
+#endif /* _RECORD_FORMAT_H_ */
@@ -0,0 +1,232 @@
+#ifndef _REORDER_BUFFER_H_
+#define _REORDER_BUFFER_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace vert
+{
+    // Puts items completed out of order (parallel workers) back into id order, per device.
+    //
+    // Items behind a missing id are held until the gap fills, the gap is more than `window` ids wide, or the
+    // oldest held item has waited `max_wait_ns`; then the missing ids are skipped for good. An id arriving after
+    // it was skipped (or released twice) is late and dropped. The device restarted its numbering when ids jump back
+    // by more than kRestartWindows windows, or when kRestartLateRun late ids in a row, counting up, were all released
+    // already (a restart close to the old ids; stragglers are ids that were skipped, they never count): what is held
+    // is released and the device starts over, the first ids of such a restart are dropped as late.
+    // A device starts at the first id pushed for it, lower ids finishing after that one count as late.
+    //
+    // Not thread safe, one thread owns it (the publisher). emit(T &&) is called in release order.
+    template <typename T>
+    class ReorderBuffer
+    {
+    public:
+        static constexpr int64_t kRestartWindows = 4;
+        static constexpr int kRestartLateRun = 3;
+
+        explicit ReorderBuffer(size_t window = 32, int64_t max_wait_ns = 100'000'000)
+            : window_(window > 0 ? window : 1), max_wait_ns_(max_wait_ns) {}
+
+        // false: `id` is late, `value` is dropped
+        template <typename Emit>
+        bool push(uint16_t device, int64_t id, T value, int64_t now_ns, Emit &&emit)
+        {
+            Device &dev = device_state(device);
+            if (dev.next == kUnset) {
+                dev.next = id;
+            } else if (id < dev.next) {
+                if (dev.next - id <= static_cast<int64_t>(dev.skipped_ids.size())) {
+                    if (!was_skipped(dev, id)) {
+                        dev.late_run = dev.late_run > 0 && id > dev.last_late ? dev.late_run + 1 : 1;
+                        dev.last_late = id;
+                    }
+                    if (dev.late_run < kRestartLateRun) {
+                        late_++;
+                        return false;
+                    }
+                }
+                release_all(dev, emit);
+                std::fill(dev.skipped_ids.begin(), dev.skipped_ids.end(), kUnset); // old numbering
+                dev.next = id;
+                restarts_++;
+            }
+            dev.late_run = 0;
+
+            // make room: give up on the oldest gaps until `id` fits into the window
+            while (id - dev.next >= static_cast<int64_t>(window_)) {
+                if (dev.held == 0) {
+                    skipped_ += static_cast<uint64_t>(id - dev.next);
+                    int64_t remembered = static_cast<int64_t>(dev.skipped_ids.size());
+                    for (int64_t skipped = std::max(dev.next, id - remembered); skipped < id; ++skipped)
+                        mark_skipped(dev, skipped);
+                    dev.next = id;
+                    break;
+                }
+                skip_gap(dev, emit);
+            }
+
+            Slot &slot = slot_of(dev, id);
+            if (slot.full) {
+                late_++; // same id twice
+                return false;
+            }
+            slot.full = true;
+            slot.id = id;
+            slot.arrive_ns = now_ns;
+            slot.value = std::move(value);
+            dev.held++;
+
+            release_ready(dev, emit);
+            return true;
+        }
+
+        // Skips the gaps whose oldest held item waited max_wait_ns or more
+        template <typename Emit>
+        void flush_expired(int64_t now_ns, Emit &&emit)
+        {
+            for (auto &[device, dev] : devices_) {
+                while (dev.held > 0 && oldest_arrive_ns(dev) + max_wait_ns_ <= now_ns) {
+                    skip_gap(dev, emit);
+                }
+            }
+        }
+
+        // Everything held, in order, gaps skipped (shutdown)
+        template <typename Emit>
+        void flush_all(Emit &&emit)
+        {
+            for (auto &[device, dev] : devices_) {
+                release_all(dev, emit);
+            }
+        }
+
+        // when flush_expired next has something to do, max int64 while nothing is held
+        int64_t next_deadline_ns() const
+        {
+            int64_t deadline = std::numeric_limits<int64_t>::max();
+            for (const auto &[device, dev] : devices_) {
+                if (dev.held > 0) {
+                    int64_t oldest = oldest_arrive_ns(dev);
+                    if (oldest + max_wait_ns_ < deadline)
+                        deadline = oldest + max_wait_ns_;
+                }
+            }
+            return deadline;
+        }
+
+        size_t held() const
+        {
+            size_t n = 0;
+            for (const auto &[device, dev] : devices_)
+                n += dev.held;
+            return n;
+        }
+
+        uint64_t released() const { return released_; }
+        uint64_t late() const { return late_; }         // arrived after their id was skipped, dropped
+        uint64_t skipped() const { return skipped_; }   // ids never seen in time
+        uint64_t restarts() const { return restarts_; }
+
+    private:
+        static constexpr int64_t kUnset = std::numeric_limits<int64_t>::min();
+
+        struct Slot {
+            bool full = false;
+            int64_t id = 0;
+            int64_t arrive_ns = 0;
+            T value{};
+        };
+
+        struct Device {
+            int64_t next = kUnset; // lowest id not released or skipped yet
+            size_t held = 0;
+            int late_run = 0;      // late ids in a row that were released already, each above the one before
+            int64_t last_late = 0;
+            std::vector<Slot> slots; // by id % window, ids in [next, next + window)
+            std::vector<int64_t> skipped_ids; // by id % size, the last kRestartWindows windows of ids
+        };
+
+        Device &device_state(uint16_t device)
+        {
+            Device &dev = devices_[device];
+            if (dev.slots.empty()) {
+                dev.slots.resize(window_);
+                dev.skipped_ids.assign(kRestartWindows * window_, kUnset);
+            }
+            return dev;
+        }
+
+        void mark_skipped(Device &dev, int64_t id)
+        {
+            dev.skipped_ids[static_cast<uint64_t>(id) % dev.skipped_ids.size()] = id;
+        }
+
+        bool was_skipped(const Device &dev, int64_t id) const
+        {
+            return dev.skipped_ids[static_cast<uint64_t>(id) % dev.skipped_ids.size()] == id;
+        }
+
+        Slot &slot_of(Device &dev, int64_t id) { return dev.slots[static_cast<uint64_t>(id) % window_]; }
+
+        int64_t oldest_arrive_ns(const Device &dev) const
+        {
+            int64_t oldest = std::numeric_limits<int64_t>::max();
+            for (const auto &slot : dev.slots) {
+                if (slot.full && slot.arrive_ns < oldest)
+                    oldest = slot.arrive_ns;
+            }
+            return oldest;
+        }
+
+        template <typename Emit>
+        void release_ready(Device &dev, Emit &emit)
+        {
+            for (;;) {
+                Slot &slot = slot_of(dev, dev.next);
+                if (!slot.full || slot.id != dev.next)
+                    return;
+                slot.full = false;
+                dev.held--;
+                dev.next++;
+                released_++;
+                emit(std::move(slot.value));
+            }
+        }
+
+        // gives up on the ids missing in front of the lowest held one, then releases what follows it; dev.held > 0
+        template <typename Emit>
+        void skip_gap(Device &dev, Emit &emit)
+        {
+            while (!slot_of(dev, dev.next).full) {
+                mark_skipped(dev, dev.next);
+                dev.next++;
+                skipped_++;
+            }
+            release_ready(dev, emit);
+        }
+
+        template <typename Emit>
+        void release_all(Device &dev, Emit &emit)
+        {
+            while (dev.held > 0) {
+                skip_gap(dev, emit);
+            }
+        }
+
+        size_t window_;
+        int64_t max_wait_ns_;
+        std::unordered_map<uint16_t, Device> devices_;
+
+        uint64_t released_ = 0;
+        uint64_t late_ = 0;
+        uint64_t skipped_ = 0;
+        uint64_t restarts_ = 0;
+    };
+
+} // namespace vert
+
+#endif /* _REORDER_BUFFER_H_ */
@@ -0,0 +1,95 @@
+#include <algorithm>
+#include "band_pool.h"
+#include "thread_utils.h"
+
+using namespace std;
+
+vert::BandPool::BandPool(int num_threads, const std::string &name)
+    : name_(name)
+{
+    for (int i = 0; i < num_threads; ++i)
+        threads_.emplace_back(&BandPool::loop, this, i);
+}
+
+vert::BandPool::~BandPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    work_cv_.notify_all();
+    for (auto &thread : threads_) {
+        if (thread.joinable())
+            thread.join();
+    }
+}
+
+bool vert::BandPool::claim(Job *&job, int &band)
+{
+    if (jobs_.empty())
+        return false;
+    job = jobs_.front();
+    band = job->next++;
+    // the last band is out, later claims go to the next job
+    if (job->next == job->num_bands)
+        jobs_.pop_front();
+    return true;
+}
+
+void vert::BandPool::finish(Job *job)
+{
+    if (++job->done == job->num_bands)
+        done_cv_.notify_all();
+}
+
+void vert::BandPool::loop(int index)
+{
+    vert::set_current_thread_name(name_ + std::to_string(index));
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        work_cv_.wait(lock, [this] { return stopping_ || !jobs_.empty(); });
+        if (stopping_)
+            break;
+        Job *job = nullptr;
+        int band = 0;
+        if (!claim(job, band))
+            continue;
+        lock.unlock();
+        (*job->fn)(band);
+        lock.lock();
+        // the caller may return once done == num_bands, job is not touched after this
+        finish(job);
+    }
+}
+
+void vert::BandPool::run(int num_bands, const std::function<void(int)> &fn)
+{
+    if (num_bands <= 0)
+        return;
+    if (num_bands == 1 || threads_.empty()) {
+        for (int band = 0; band < num_bands; ++band)
+            fn(band);
+        return;
+    }
+
+    Job job;
+    job.fn = &fn;
+    job.num_bands = num_bands;
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    jobs_.push_back(&job);
+    work_cv_.notify_all();
+
+    // work along on our own bands, then wait for the ones the helpers took
+    while (job.next < job.num_bands) {
+        int band = job.next++;
+        if (job.next == job.num_bands)
+            jobs_.erase(std::find(jobs_.begin(), jobs_.end(), &job));
+        lock.unlock();
+        fn(band);
+        lock.lock();
+        finish(&job);
+    }
+    done_cv_.wait(lock, [&job] { return job.done == job.num_bands; });
+}
@@ -0,0 +1,87 @@
+#include "buffer_pool.h"
+#include <cassert>
+#include "memory_utils.h"
+
+vert::BufferPool::Ptr vert::BufferPool::create(size_t num_buffers, size_t buffer_size, bool hugepages)
+{
+    if (num_buffers == 0 || buffer_size == 0)
+        return nullptr;
+
+    Ptr pool(new BufferPool(num_buffers, buffer_size));
+    pool->arena_size_ = pool->slot_stride_ * num_buffers;
+    pool->arena_ = static_cast<uint8_t *>(vert::alloc_pages(pool->arena_size_, hugepages, &pool->is_huge_));
+    if (!pool->arena_)
+        return nullptr;
+    return pool;
+}
+
+vert::BufferPool::BufferPool(size_t num_buffers, size_t buffer_size)
+    : num_buffers_(num_buffers),
+      buffer_size_(buffer_size),
+      slot_stride_(vert::align_up(buffer_size, vert::page_size())),
+      slot_refs_(new std::atomic<uint32_t>[num_buffers]),
+      free_list_(num_buffers)
+{
+    for (size_t i = 0; i < num_buffers; ++i) {
+        slot_refs_[i].store(0, std::memory_order_relaxed);
+        free_list_.try_push(static_cast<int>(i));
+    }
+}
+
+vert::BufferPool::~BufferPool()
+{
+    vert::free_pages(arena_, arena_size_, is_huge_);
+}
+
+void vert::BufferPool::release()
+{
+    if (refs_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        delete this;
+}
+
+vert::BufferPool::Ptr vert::BufferPool::share()
+{
+    refs_.fetch_add(1, std::memory_order_relaxed);
+    return Ptr(this);
+}
+
+int vert::BufferPool::acquire()
+{
+    int slot = -1;
+    if (!free_list_.try_pop(slot))
+        return -1;
+    return slot;
+}
+
+void vert::BufferPool::give_back(int slot)
+{
+    free_list_.push_spin(slot);
+}
+
+void vert::BufferPool::publish(int slot, uint32_t refs)
+{
+    slot_refs_[slot].store(refs, std::memory_order_release);
+}
+
+zmq::message_t vert::BufferPool::make_message(int slot, void *ptr, size_t size)
+{
+    assert(static_cast<uint8_t *>(ptr) >= data(slot) && static_cast<uint8_t *>(ptr) + size <= data(slot) + buffer_size_);
+    (void)slot;
+    refs_.fetch_add(1, std::memory_order_relaxed);
+    // the slot is recovered from the data pointer, the pool travels as hint
+    return zmq::message_t(ptr, size, &BufferPool::free_message, this);
+}
+
+void vert::BufferPool::release_slot(int slot)
+{
+    if (slot_refs_[slot].fetch_sub(1, std::memory_order_acq_rel) == 1)
+        free_list_.push_spin(slot); // a failed try_push would lose the slot for good
+}
+
+void vert::BufferPool::free_message(void *data, void *hint)
+{
+    auto *pool = static_cast<BufferPool *>(hint);
+    size_t offset = static_cast<size_t>(static_cast<uint8_t *>(data) - pool->arena_);
+    pool->release_slot(static_cast<int>(offset / pool->slot_stride_));
+    pool->release();
+}
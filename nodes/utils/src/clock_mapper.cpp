@@ -0,0 +1,132 @@
+#include "clock_mapper.h"
+#include <algorithm>
+#include <cmath>
+
+vert::ClockMapper::ClockMapper(size_t window, double nominal_ns_per_tick)
+    : window_(std::max<size_t>(window, 2)), nominal_ns_per_tick_(nominal_ns_per_tick)
+{
+    Line line;
+    line.slope = nominal_ns_per_tick;
+    line.nominal_ns_per_tick = nominal_ns_per_tick;
+    publish(line);
+}
+
+void vert::ClockMapper::reset(double nominal_ns_per_tick)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    samples_.clear();
+    nominal_ns_per_tick_ = nominal_ns_per_tick;
+    Line line;
+    line.slope = nominal_ns_per_tick;
+    line.nominal_ns_per_tick = nominal_ns_per_tick;
+    publish(line);
+}
+
+void vert::ClockMapper::add_sample(int64_t ticks, int64_t host_ns)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    // the device counter restarted (reset, power cycle), the old line is useless
+    if (!samples_.empty() && ticks <= samples_.back().ticks)
+        samples_.clear();
+
+    samples_.push_back({ticks, host_ns});
+    if (samples_.size() > window_)
+        samples_.pop_front();
+    publish(fit());
+}
+
+vert::ClockMapper::Line vert::ClockMapper::fit() const
+{
+    Line line;
+    line.nominal_ns_per_tick = nominal_ns_per_tick_;
+    line.num_samples = samples_.size();
+
+    // relative to the oldest sample, keeps the doubles well conditioned
+    line.tick_ref = samples_.front().ticks;
+    line.host_ref = samples_.front().host_ns;
+
+    const double n = static_cast<double>(samples_.size());
+    double mean_x = 0.0, mean_y = 0.0;
+    for (const auto &s : samples_) {
+        mean_x += static_cast<double>(s.ticks - line.tick_ref);
+        mean_y += static_cast<double>(s.host_ns - line.host_ref);
+    }
+    mean_x /= n;
+    mean_y /= n;
+
+    double sxx = 0.0, sxy = 0.0;
+    for (const auto &s : samples_) {
+        double dx = static_cast<double>(s.ticks - line.tick_ref) - mean_x;
+        double dy = static_cast<double>(s.host_ns - line.host_ref) - mean_y;
+        sxx += dx * dx;
+        sxy += dx * dy;
+    }
+
+    line.slope = sxx > 0.0 ? sxy / sxx : nominal_ns_per_tick_;
+    line.offset = mean_y - line.slope * mean_x;
+    return line;
+}
+
+// Called with mutex_ held, so there is a single writer
+void vert::ClockMapper::publish(const Line &line)
+{
+    uint32_t seq = seq_.load(std::memory_order_relaxed);
+    seq_.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    tick_ref_.store(line.tick_ref, std::memory_order_relaxed);
+    host_ref_.store(line.host_ref, std::memory_order_relaxed);
+    offset_.store(line.offset, std::memory_order_relaxed);
+    slope_.store(line.slope, std::memory_order_relaxed);
+    nominal_.store(line.nominal_ns_per_tick, std::memory_order_relaxed);
+    num_samples_.store(line.num_samples, std::memory_order_relaxed);
+
+    seq_.store(seq + 2, std::memory_order_release);
+}
+
+vert::ClockMapper::Line vert::ClockMapper::snapshot() const
+{
+    Line line;
+    for (;;) {
+        uint32_t seq = seq_.load(std::memory_order_acquire);
+        if (seq & 1)
+            continue; // a sample is being published, a few ns
+
+        line.tick_ref = tick_ref_.load(std::memory_order_relaxed);
+        line.host_ref = host_ref_.load(std::memory_order_relaxed);
+        line.offset = offset_.load(std::memory_order_relaxed);
+        line.slope = slope_.load(std::memory_order_relaxed);
+        line.nominal_ns_per_tick = nominal_.load(std::memory_order_relaxed);
+        line.num_samples = num_samples_.load(std::memory_order_relaxed);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (seq_.load(std::memory_order_relaxed) == seq)
+            return line;
+    }
+}
+
+int64_t vert::ClockMapper::to_host_ns(int64_t ticks) const
+{
+    Line line = snapshot();
+    if (line.num_samples == 0)
+        return 0;
+    return line.host_ref + static_cast<int64_t>(std::llround(line.offset + line.slope * static_cast<double>(ticks - line.tick_ref)));
+}
+
+bool vert::ClockMapper::ready() const
+{
+    return num_samples() > 0;
+}
+
+size_t vert::ClockMapper::num_samples() const
+{
+    return num_samples_.load(std::memory_order_acquire);
+}
+
+double vert::ClockMapper::drift_ppm() const
+{
+    Line line = snapshot();
+    if (line.num_samples < 2 || line.nominal_ns_per_tick <= 0.0)
+        return 0.0;
+    return (line.slope / line.nominal_ns_per_tick - 1.0) * 1e6;
+}
@@ -0,0 +1,117 @@
+#include "cpu_features.h"
+#include <cstdint>
+#include "string_utils.h"
+
+#if defined(VERT_X86_SIMD)
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+using namespace std;
+
+#if defined(VERT_X86_SIMD)
+static void cpuid(int leaf, int subleaf, uint32_t regs[4])
+{
+#if defined(_MSC_VER)
+    int r[4];
+    __cpuidex(r, leaf, subleaf);
+    for (int i = 0; i < 4; ++i)
+        regs[i] = static_cast<uint32_t>(r[i]);
+#else
+    __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+// XCR0, which register states the OS saves on context switch
+static uint64_t xgetbv0()
+{
+#if defined(_MSC_VER)
+    return _xgetbv(0);
+#else
+    uint32_t eax, edx;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return (static_cast<uint64_t>(edx) << 32) | eax;
+#endif
+}
+
+static vert::SimdLevel detect_simd_level()
+{
+    uint32_t r[4];
+    cpuid(0, 0, r);
+    uint32_t max_leaf = r[0];
+
+    cpuid(1, 0, r);
+    bool sse41 = r[2] & (1u << 19);
+    bool osxsave = r[2] & (1u << 27);
+    bool avx = r[2] & (1u << 28);
+    if (!sse41)
+        return vert::SimdLevel::Scalar;
+    if (!osxsave || !avx || max_leaf < 7)
+        return vert::SimdLevel::SSE41;
+
+    uint64_t xcr0 = xgetbv0();
+    bool os_ymm = (xcr0 & 0x6) == 0x6;    // xmm, ymm
+    bool os_zmm = (xcr0 & 0xe6) == 0xe6;  // + opmask, zmm 0-15 upper halves, zmm 16-31
+
+    cpuid(7, 0, r);
+    bool avx2 = r[1] & (1u << 5);
+    bool avx512f = r[1] & (1u << 16);
+    bool avx512bw = r[1] & (1u << 30);
+
+    if (avx512f && avx512bw && os_zmm)
+        return vert::SimdLevel::AVX512;
+    if (avx2 && os_ymm)
+        return vert::SimdLevel::AVX2;
+    return vert::SimdLevel::SSE41;
+}
+#endif
+
+vert::SimdLevel vert::cpu_simd_level()
+{
+#if defined(VERT_X86_SIMD)
+    static const SimdLevel level = detect_simd_level();
+    return level;
+#else
+    return SimdLevel::Scalar;
+#endif
+}
+
+vert::SimdLevel vert::clamp_simd_level(SimdLevel wanted)
+{
+    SimdLevel have = cpu_simd_level();
+    return static_cast<int>(wanted) < static_cast<int>(have) ? wanted : have;
+}
+
+bool vert::simd_level_from_string(std::string_view s, SimdLevel &level)
+{
+    string lower = vert::to_lower(s);
+    if (lower == "scalar") {
+        level = SimdLevel::Scalar;
+    } else if (lower == "sse4.1" || lower == "sse41") {
+        level = SimdLevel::SSE41;
+    } else if (lower == "avx2") {
+        level = SimdLevel::AVX2;
+    } else if (lower == "avx512") {
+        level = SimdLevel::AVX512;
+    } else if (lower == "best" || lower == "auto") {
+        level = SimdLevel::Best;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char *vert::simd_level_to_string(SimdLevel level)
+{
+    switch (level) {
+    case SimdLevel::Scalar: return "scalar";
+    case SimdLevel::SSE41: return "sse4.1";
+    case SimdLevel::AVX2: return "avx2";
+    case SimdLevel::AVX512: return "avx512";
+    case SimdLevel::Best: return "best";
+    }
+    return "unknown";
+}
@@ -1 +1,137 @@
-#include "cv_utils.h"
\ No newline at end of file
+#include <atomic>
+#include <mutex>
+#include <opencv2/imgproc.hpp>
+#include "cv_utils.h"
+
+namespace
+{
+#if CV_VERSION_MAJOR >= 4
+    using AccessFlags = cv::AccessFlag;
+#else
+    using AccessFlags = int;
+#endif
+
+    thread_local uint64_t t_mat_allocations = 0;
+    thread_local std::atomic<uint64_t> *t_mat_alloc_scope = nullptr;
+    std::atomic<uint64_t> g_mat_allocations{0};
+    std::atomic<bool> g_mat_alloc_counter_installed{false};
+
+    // Forwards to the allocator it replaced. Buffers it hands out keep that one as their currAllocator, so
+    // freeing them never comes through here.
+    class CountingMatAllocator : public cv::MatAllocator
+    {
+    public:
+        explicit CountingMatAllocator(cv::MatAllocator *inner) : inner_(inner) {}
+
+        cv::UMatData *allocate(int dims, const int *sizes, int type, void *data, size_t *step, AccessFlags flags,
+                               cv::UMatUsageFlags usage) const override
+        {
+            cv::UMatData *u = inner_->allocate(dims, sizes, type, data, step, flags, usage);
+            if (u && !data) { // data: wraps user memory
+                t_mat_allocations++;
+                g_mat_allocations.fetch_add(1, std::memory_order_relaxed);
+                if (t_mat_alloc_scope)
+                    t_mat_alloc_scope->fetch_add(1, std::memory_order_relaxed);
+            }
+            return u;
+        }
+
+        bool allocate(cv::UMatData *u, AccessFlags flags, cv::UMatUsageFlags usage) const override
+        {
+            return inner_->allocate(u, flags, usage);
+        }
+
+        void deallocate(cv::UMatData *u) const override { inner_->deallocate(u); }
+
+    private:
+        cv::MatAllocator *inner_;
+    };
+} // namespace
+
+void vert::bgr_to_bayer(const cv::Mat &bgr, cv::Mat &bayer, BayerPattern pattern)
+{
+    CV_Assert(bgr.type() == CV_8UC3);
+
+    // BGR channel index at (y % 2, x % 2)
+    static const int channel_table[4][2][2] = {
+        {{2, 1}, {1, 0}}, // RG
+        {{1, 2}, {0, 1}}, // GR
+        {{0, 1}, {1, 2}}, // BG
+        {{1, 0}, {2, 1}}, // GB
+    };
+    const auto &channels = channel_table[static_cast<int>(pattern)];
+
+    bayer.create(bgr.rows, bgr.cols, CV_8UC1);
+    for (int y = 0; y < bgr.rows; ++y) {
+        const uint8_t *src = bgr.ptr<uint8_t>(y);
+        uint8_t *dst = bayer.ptr<uint8_t>(y);
+        const int *row = channels[y & 1];
+        for (int x = 0; x < bgr.cols; ++x) {
+            dst[x] = src[x * 3 + row[x & 1]];
+        }
+    }
+}
+
+int vert::cv_bayer_to_bgr_code(BayerPattern pattern)
+{
+    switch (pattern) {
+    case BayerPattern::RG: return cv::COLOR_BayerBG2BGR;
+    case BayerPattern::GR: return cv::COLOR_BayerGB2BGR;
+    case BayerPattern::BG: return cv::COLOR_BayerRG2BGR;
+    case BayerPattern::GB: return cv::COLOR_BayerGR2BGR;
+    }
+    return -1;
+}
+
+int vert::cv_bayer_to_gray_code(BayerPattern pattern)
+{
+    switch (pattern) {
+    case BayerPattern::RG: return cv::COLOR_BayerBG2GRAY;
+    case BayerPattern::GR: return cv::COLOR_BayerGB2GRAY;
+    case BayerPattern::BG: return cv::COLOR_BayerRG2GRAY;
+    case BayerPattern::GB: return cv::COLOR_BayerGR2GRAY;
+    }
+    return -1;
+}
+
+void vert::install_mat_alloc_counter()
+{
+    static std::once_flag once;
+    std::call_once(once, [] {
+        // never destroyed: Mats may outlive static destruction
+        auto *counter = new CountingMatAllocator(cv::Mat::getDefaultAllocator());
+        cv::Mat::setDefaultAllocator(counter);
+        g_mat_alloc_counter_installed = true;
+    });
+}
+
+bool vert::mat_alloc_counter_installed()
+{
+    return g_mat_alloc_counter_installed.load();
+}
+
+uint64_t vert::mat_allocations_this_thread()
+{
+    return t_mat_allocations;
+}
+
+uint64_t vert::mat_allocations_total()
+{
+    return g_mat_allocations.load(std::memory_order_relaxed);
+}
+
+vert::MatAllocScope::MatAllocScope(std::atomic<uint64_t> *counter)
+    : prev_(t_mat_alloc_scope)
+{
+    t_mat_alloc_scope = counter;
+}
+
+vert::MatAllocScope::~MatAllocScope()
+{
+    t_mat_alloc_scope = prev_;
+}
+
+std::atomic<uint64_t> *vert::current_mat_alloc_scope()
+{
+    return t_mat_alloc_scope;
+}
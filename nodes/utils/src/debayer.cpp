@@ -0,0 +1,89 @@
+#include "debayer.h"
+#include "debayer_kernel.h"
+#include "downscale.h"
+
+using namespace std;
+
+namespace
+{
+    struct ScalarKernel {
+        static constexpr int kWidth = 0;
+        static void block(const vert::debayer_detail::Rows &, int, vert::debayer_detail::RowKind, uint8_t *) {}
+    };
+} // namespace
+
+void vert::debayer_detail::rows_scalar(const uint8_t *src, size_t src_stride, uint8_t *dst, size_t dst_stride,
+                                       int width, int height, BayerPattern pattern, int row_begin, int row_end)
+{
+    rows<ScalarKernel>(src, src_stride, dst, dst_stride, width, height, pattern, row_begin, row_end);
+}
+
+vert::SimdLevel vert::debayer_simd_level(SimdLevel wanted)
+{
+    return clamp_simd_level(wanted);
+}
+
+static vert::debayer_detail::RowsFn rows_fn(vert::SimdLevel level)
+{
+    using namespace vert;
+    debayer_detail::RowsFn fn = debayer_detail::rows_scalar;
+    switch (debayer_simd_level(level)) {
+#if defined(VERT_X86_SIMD)
+    case SimdLevel::AVX512:
+        fn = debayer_detail::rows_avx512;
+        break;
+    case SimdLevel::AVX2:
+        fn = debayer_detail::rows_avx2;
+        break;
+    case SimdLevel::SSE41:
+        fn = debayer_detail::rows_sse41;
+        break;
+#endif
+    default:
+        break;
+    }
+    return fn;
+}
+
+void vert::debayer_bilinear_rows(const uint8_t *src, size_t src_stride, uint8_t *dst, size_t dst_stride,
+                                 int width, int height, BayerPattern pattern, int row_begin, int row_end,
+                                 SimdLevel level)
+{
+    if (width < 2 || height < 2 || row_begin >= row_end)
+        return;
+    rows_fn(level)(src, src_stride, dst, dst_stride, width, height, pattern, row_begin, row_end);
+}
+
+void vert::debayer_bilinear(const uint8_t *src, size_t src_stride, uint8_t *dst, size_t dst_stride,
+                            int width, int height, BayerPattern pattern, SimdLevel level)
+{
+    debayer_bilinear_rows(src, src_stride, dst, dst_stride, width, height, pattern, 0, height, level);
+}
+
+void vert::debayer_bilinear_preview(const uint8_t *src, size_t src_stride, uint8_t *dst, size_t dst_stride,
+                                    int width, int height, BayerPattern pattern, int factor,
+                                    uint8_t *preview, size_t preview_stride, SimdLevel level)
+{
+    debayer_bilinear_preview_rows(src, src_stride, dst, dst_stride, width, height, pattern, factor,
+                                  preview, preview_stride, 0, height, level);
+}
+
+void vert::debayer_bilinear_preview_rows(const uint8_t *src, size_t src_stride, uint8_t *dst, size_t dst_stride,
+                                         int width, int height, BayerPattern pattern, int factor,
+                                         uint8_t *preview, size_t preview_stride, int row_begin, int row_end,
+                                         SimdLevel level)
+{
+    if (width < 2 || height < 2 || row_begin >= row_end)
+        return;
+
+    debayer_detail::RowsFn fn = rows_fn(level);
+    int preview_rows = downscaled_size(height, factor);
+    int y = row_begin;
+    for (; y + factor <= row_end && y / factor < preview_rows; y += factor) {
+        fn(src, src_stride, dst, dst_stride, width, height, pattern, y, y + factor);
+        box_downscale_rows(dst, dst_stride, width, 3, factor, preview, preview_stride, y / factor, y / factor + 1);
+    }
+    // rows below the last full block
+    if (y < row_end)
+        fn(src, src_stride, dst, dst_stride, width, height, pattern, y, row_end);
+}
@@ -0,0 +1,78 @@
+// compiled with -mavx2, only reached through debayer.cpp after cpu_simd_level() said so
+#include <immintrin.h>
+#include "debayer_kernel.h"
+
+using namespace vert::debayer_detail;
+
+namespace
+{
+    // (a + b + c + d + 2) >> 2 per byte, in 16 bit. unpack and pack both work per 128 bit lane,
+    // so the byte order survives the round trip.
+    inline __m256i avg4(__m256i a, __m256i b, __m256i c, __m256i d)
+    {
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i two = _mm256_set1_epi16(2);
+        __m256i lo = _mm256_add_epi16(_mm256_add_epi16(_mm256_unpacklo_epi8(a, zero), _mm256_unpacklo_epi8(b, zero)),
+                                      _mm256_add_epi16(_mm256_unpacklo_epi8(c, zero), _mm256_unpacklo_epi8(d, zero)));
+        __m256i hi = _mm256_add_epi16(_mm256_add_epi16(_mm256_unpackhi_epi8(a, zero), _mm256_unpackhi_epi8(b, zero)),
+                                      _mm256_add_epi16(_mm256_unpackhi_epi8(c, zero), _mm256_unpackhi_epi8(d, zero)));
+        lo = _mm256_srli_epi16(_mm256_add_epi16(lo, two), 2);
+        hi = _mm256_srli_epi16(_mm256_add_epi16(hi, two), 2);
+        return _mm256_packus_epi16(lo, hi);
+    }
+
+    inline void store_bgr16(__m128i b, __m128i g, __m128i r, uint8_t *out)
+    {
+        for (int k = 0; k < 3; ++k) {
+            __m128i v = _mm_or_si128(
+                _mm_or_si128(_mm_shuffle_epi8(b, _mm_load_si128(reinterpret_cast<const __m128i *>(kInterleave.m[k][0]))),
+                             _mm_shuffle_epi8(g, _mm_load_si128(reinterpret_cast<const __m128i *>(kInterleave.m[k][1])))),
+                _mm_shuffle_epi8(r, _mm_load_si128(reinterpret_cast<const __m128i *>(kInterleave.m[k][2]))));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 16 * k), v);
+        }
+    }
+
+    // vpshufb cannot cross 128 bit lanes, interleave each half on its own
+    inline void store_bgr(__m256i b, __m256i g, __m256i r, uint8_t *out)
+    {
+        store_bgr16(_mm256_castsi256_si128(b), _mm256_castsi256_si128(g), _mm256_castsi256_si128(r), out);
+        store_bgr16(_mm256_extracti128_si256(b, 1), _mm256_extracti128_si256(g, 1), _mm256_extracti128_si256(r, 1), out + 48);
+    }
+
+    inline __m256i load(const uint8_t *p)
+    {
+        return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+    }
+
+    struct Avx2Kernel {
+        static constexpr int kWidth = 32;
+
+        static void block(const Rows &r, int x, RowKind kind, uint8_t *out)
+        {
+            __m256i c = load(r.cur + x), l = load(r.cur + x - 1), rt = load(r.cur + x + 1);
+            __m256i u = load(r.up + x), d = load(r.down + x);
+            __m256i h2 = _mm256_avg_epu8(l, rt);
+            __m256i v2 = _mm256_avg_epu8(u, d);
+            __m256i cross = avg4(l, rt, u, d);
+            __m256i diag = avg4(load(r.up + x - 1), load(r.up + x + 1), load(r.down + x - 1), load(r.down + x + 1));
+
+            // x is odd: lane i holds the row's R / B when (i + 1) % 2 == color_parity
+            __m256i at_color = kind.color_parity == 0 ? _mm256_set1_epi16(static_cast<short>(0xff00))
+                                                       : _mm256_set1_epi16(0x00ff);
+            __m256i own = _mm256_blendv_epi8(h2, c, at_color);
+            __m256i g = _mm256_blendv_epi8(c, cross, at_color);
+            __m256i other = _mm256_blendv_epi8(v2, diag, at_color);
+
+            if (kind.red_row)
+                store_bgr(other, g, own, out);
+            else
+                store_bgr(own, g, other, out);
+        }
+    };
+} // namespace
+
+void vert::debayer_detail::rows_avx2(const uint8_t *src, size_t src_stride, uint8_t *dst, size_t dst_stride,
+                                     int width, int height, BayerPattern pattern, int row_begin, int row_end)
+{
+    rows<Avx2Kernel>(src, src_stride, dst, dst_stride, width, height, pattern, row_begin, row_end);
+}
@@ -0,0 +1,78 @@
+// compiled with -mavx512f -mavx512bw, only reached through debayer.cpp after cpu_simd_level() said so
+#include <immintrin.h>
+#include "debayer_kernel.h"
+
+using namespace vert::debayer_detail;
+
+namespace
+{
+    // (a + b + c + d + 2) >> 2 per byte, in 16 bit, unpack / pack stay within 128 bit lanes
+    inline __m512i avg4(__m512i a, __m512i b, __m512i c, __m512i d)
+    {
+        const __m512i zero = _mm512_setzero_si512();
+        const __m512i two = _mm512_set1_epi16(2);
+        __m512i lo = _mm512_add_epi16(_mm512_add_epi16(_mm512_unpacklo_epi8(a, zero), _mm512_unpacklo_epi8(b, zero)),
+                                      _mm512_add_epi16(_mm512_unpacklo_epi8(c, zero), _mm512_unpacklo_epi8(d, zero)));
+        __m512i hi = _mm512_add_epi16(_mm512_add_epi16(_mm512_unpackhi_epi8(a, zero), _mm512_unpackhi_epi8(b, zero)),
+                                      _mm512_add_epi16(_mm512_unpackhi_epi8(c, zero), _mm512_unpackhi_epi8(d, zero)));
+        lo = _mm512_srli_epi16(_mm512_add_epi16(lo, two), 2);
+        hi = _mm512_srli_epi16(_mm512_add_epi16(hi, two), 2);
+        return _mm512_packus_epi16(lo, hi);
+    }
+
+    inline void store_bgr16(__m128i b, __m128i g, __m128i r, uint8_t *out)
+    {
+        for (int k = 0; k < 3; ++k) {
+            __m128i v = _mm_or_si128(
+                _mm_or_si128(_mm_shuffle_epi8(b, _mm_load_si128(reinterpret_cast<const __m128i *>(kInterleave.m[k][0]))),
+                             _mm_shuffle_epi8(g, _mm_load_si128(reinterpret_cast<const __m128i *>(kInterleave.m[k][1])))),
+                _mm_shuffle_epi8(r, _mm_load_si128(reinterpret_cast<const __m128i *>(kInterleave.m[k][2]))));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 16 * k), v);
+        }
+    }
+
+    // byte shuffles cannot cross 128 bit lanes without VBMI, interleave each quarter on its own
+    inline void store_bgr(__m512i b, __m512i g, __m512i r, uint8_t *out)
+    {
+        store_bgr16(_mm512_extracti32x4_epi32(b, 0), _mm512_extracti32x4_epi32(g, 0), _mm512_extracti32x4_epi32(r, 0), out);
+        store_bgr16(_mm512_extracti32x4_epi32(b, 1), _mm512_extracti32x4_epi32(g, 1), _mm512_extracti32x4_epi32(r, 1), out + 48);
+        store_bgr16(_mm512_extracti32x4_epi32(b, 2), _mm512_extracti32x4_epi32(g, 2), _mm512_extracti32x4_epi32(r, 2), out + 96);
+        store_bgr16(_mm512_extracti32x4_epi32(b, 3), _mm512_extracti32x4_epi32(g, 3), _mm512_extracti32x4_epi32(r, 3), out + 144);
+    }
+
+    inline __m512i load(const uint8_t *p)
+    {
+        return _mm512_loadu_si512(p);
+    }
+
+    struct Avx512Kernel {
+        static constexpr int kWidth = 64;
+
+        static void block(const Rows &r, int x, RowKind kind, uint8_t *out)
+        {
+            __m512i c = load(r.cur + x), l = load(r.cur + x - 1), rt = load(r.cur + x + 1);
+            __m512i u = load(r.up + x), d = load(r.down + x);
+            __m512i h2 = _mm512_avg_epu8(l, rt);
+            __m512i v2 = _mm512_avg_epu8(u, d);
+            __m512i cross = avg4(l, rt, u, d);
+            __m512i diag = avg4(load(r.up + x - 1), load(r.up + x + 1), load(r.down + x - 1), load(r.down + x + 1));
+
+            // x is odd: lane i holds the row's R / B when (i + 1) % 2 == color_parity
+            __mmask64 at_color = kind.color_parity == 0 ? 0xaaaaaaaaaaaaaaaaull : 0x5555555555555555ull;
+            __m512i own = _mm512_mask_blend_epi8(at_color, h2, c);
+            __m512i g = _mm512_mask_blend_epi8(at_color, c, cross);
+            __m512i other = _mm512_mask_blend_epi8(at_color, v2, diag);
+
+            if (kind.red_row)
+                store_bgr(other, g, own, out);
+            else
+                store_bgr(own, g, other, out);
+        }
+    };
+} // namespace
+
+void vert::debayer_detail::rows_avx512(const uint8_t *src, size_t src_stride, uint8_t *dst, size_t dst_stride,
+                                       int width, int height, BayerPattern pattern, int row_begin, int row_end)
+{
+    rows<Avx512Kernel>(src, src_stride, dst, dst_stride, width, height, pattern, row_begin, row_end);
+}
@@ -0,0 +1,129 @@
+#ifndef _DEBAYER_KERNEL_H_
+#define _DEBAYER_KERNEL_H_
+
+#include <cstddef>
+#include <cstdint>
+#include "debayer.h"
+
+// Shared by debayer.cpp and the debayer_<isa>.cpp files, each compiled with its own instruction set
+// flags. Everything below has internal linkage: an inline function with external linkage would be
+// merged across those files and the linker may keep the AVX-512 copy for the scalar caller.
+
+namespace vert
+{
+    namespace debayer_detail
+    {
+        using RowsFn = void (*)(const uint8_t *src, size_t src_stride, uint8_t *dst, size_t dst_stride,
+                                int width, int height, BayerPattern pattern, int row_begin, int row_end);
+
+        void rows_scalar(const uint8_t *src, size_t src_stride, uint8_t *dst, size_t dst_stride,
+                         int width, int height, BayerPattern pattern, int row_begin, int row_end);
+#if defined(VERT_X86_SIMD)
+        void rows_sse41(const uint8_t *src, size_t src_stride, uint8_t *dst, size_t dst_stride,
+                        int width, int height, BayerPattern pattern, int row_begin, int row_end);
+        void rows_avx2(const uint8_t *src, size_t src_stride, uint8_t *dst, size_t dst_stride,
+                       int width, int height, BayerPattern pattern, int row_begin, int row_end);
+        void rows_avx512(const uint8_t *src, size_t src_stride, uint8_t *dst, size_t dst_stride,
+                         int width, int height, BayerPattern pattern, int row_begin, int row_end);
+#endif
+
+        namespace
+        {
+            struct Rows {
+                const uint8_t *up;
+                const uint8_t *cur;
+                const uint8_t *down;
+            };
+
+            // A row holds G and one of R / B. `red_row`: it is R (B lives on the rows above and below).
+            // `color_parity`: x % 2 of the R / B samples.
+            struct RowKind {
+                bool red_row;
+                int color_parity;
+            };
+
+            inline RowKind row_kind(BayerPattern pattern, int y)
+            {
+                // first row of the pattern: R or B at even x for RG / BG, at odd x for GR / GB
+                bool first_red = pattern == BayerPattern::RG || pattern == BayerPattern::GR;
+                int first_parity = (pattern == BayerPattern::RG || pattern == BayerPattern::BG) ? 0 : 1;
+                if ((y & 1) == 0)
+                    return {first_red, first_parity};
+                return {!first_red, 1 - first_parity};
+            }
+
+            inline int reflect101(int i, int n)
+            {
+                return i < 0 ? -i : (i >= n ? 2 * n - 2 - i : i);
+            }
+
+            // the reference every vector kernel has to match bit for bit
+            inline void pixel(const Rows &r, int x, int xl, int xr, RowKind kind, uint8_t *out)
+            {
+                int own, g, other; // own: the R or B of this row, other: the one of the rows above / below
+                if ((x & 1) == kind.color_parity) {
+                    own = r.cur[x];
+                    g = (r.cur[xl] + r.cur[xr] + r.up[x] + r.down[x] + 2) >> 2;
+                    other = (r.up[xl] + r.up[xr] + r.down[xl] + r.down[xr] + 2) >> 2;
+                } else {
+                    own = (r.cur[xl] + r.cur[xr] + 1) >> 1;
+                    g = r.cur[x];
+                    other = (r.up[x] + r.down[x] + 1) >> 1;
+                }
+                out[0] = static_cast<uint8_t>(kind.red_row ? other : own);
+                out[1] = static_cast<uint8_t>(g);
+                out[2] = static_cast<uint8_t>(kind.red_row ? own : other);
+            }
+
+            // Kernel::kWidth pixels per Kernel::block(rows, x, kind, out) call, x is always odd and
+            // x - 1 .. x + kWidth lie inside the row. kWidth 0: scalar only.
+            template <typename Kernel>
+            void rows(const uint8_t *src, size_t src_stride, uint8_t *dst, size_t dst_stride,
+                      int width, int height, BayerPattern pattern, int row_begin, int row_end)
+            {
+                for (int y = row_begin; y < row_end; ++y) {
+                    Rows r{src + reflect101(y - 1, height) * src_stride,
+                           src + y * src_stride,
+                           src + reflect101(y + 1, height) * src_stride};
+                    RowKind kind = row_kind(pattern, y);
+                    uint8_t *out = dst + y * dst_stride;
+
+                    pixel(r, 0, 1, 1, kind, out);
+                    int x = 1;
+                    if constexpr (Kernel::kWidth > 0) {
+                        for (; x + Kernel::kWidth < width; x += Kernel::kWidth)
+                            Kernel::block(r, x, kind, out + 3 * x);
+                    }
+                    for (; x < width - 1; ++x)
+                        pixel(r, x, x - 1, x + 1, kind, out + 3 * x);
+                    if (width > 1)
+                        pixel(r, width - 1, width - 2, width - 2, kind, out + 3 * (width - 1));
+                }
+            }
+
+            // pshufb masks scattering 16 B, G and R bytes into 48 bytes of BGR, [output chunk][channel]
+            struct InterleaveMasks {
+                alignas(16) uint8_t m[3][3][16];
+            };
+
+            constexpr InterleaveMasks make_interleave_masks()
+            {
+                InterleaveMasks t{};
+                for (int k = 0; k < 3; ++k)
+                    for (int c = 0; c < 3; ++c)
+                        for (int i = 0; i < 16; ++i) {
+                            int pos = 16 * k + i;
+                            t.m[k][c][i] = static_cast<uint8_t>(pos % 3 == c ? pos / 3 : 0x80);
+                        }
+                return t;
+            }
+
+            constexpr InterleaveMasks kInterleave = make_interleave_masks();
+
+        } // namespace
+
+    } // namespace debayer_detail
+
+} // namespace vert
+
+#endif /* _DEBAYER_KERNEL_H_ */
@@ -0,0 +1,70 @@
+// compiled with -msse4.1, only reached through debayer.cpp after cpu_simd_level() said so
+#include <smmintrin.h>
+#include "debayer_kernel.h"
+
+using namespace vert::debayer_detail;
+
+namespace
+{
+    // (a + b + c + d + 2) >> 2 per byte, in 16 bit
+    inline __m128i avg4(__m128i a, __m128i b, __m128i c, __m128i d)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i two = _mm_set1_epi16(2);
+        __m128i lo = _mm_add_epi16(_mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero)),
+                                   _mm_add_epi16(_mm_unpacklo_epi8(c, zero), _mm_unpacklo_epi8(d, zero)));
+        __m128i hi = _mm_add_epi16(_mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero)),
+                                   _mm_add_epi16(_mm_unpackhi_epi8(c, zero), _mm_unpackhi_epi8(d, zero)));
+        lo = _mm_srli_epi16(_mm_add_epi16(lo, two), 2);
+        hi = _mm_srli_epi16(_mm_add_epi16(hi, two), 2);
+        return _mm_packus_epi16(lo, hi);
+    }
+
+    inline void store_bgr(__m128i b, __m128i g, __m128i r, uint8_t *out)
+    {
+        for (int k = 0; k < 3; ++k) {
+            __m128i v = _mm_or_si128(
+                _mm_or_si128(_mm_shuffle_epi8(b, _mm_load_si128(reinterpret_cast<const __m128i *>(kInterleave.m[k][0]))),
+                             _mm_shuffle_epi8(g, _mm_load_si128(reinterpret_cast<const __m128i *>(kInterleave.m[k][1])))),
+                _mm_shuffle_epi8(r, _mm_load_si128(reinterpret_cast<const __m128i *>(kInterleave.m[k][2]))));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 16 * k), v);
+        }
+    }
+
+    inline __m128i load(const uint8_t *p)
+    {
+        return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+    }
+
+    struct Sse41Kernel {
+        static constexpr int kWidth = 16;
+
+        static void block(const Rows &r, int x, RowKind kind, uint8_t *out)
+        {
+            __m128i c = load(r.cur + x), l = load(r.cur + x - 1), rt = load(r.cur + x + 1);
+            __m128i u = load(r.up + x), d = load(r.down + x);
+            __m128i h2 = _mm_avg_epu8(l, rt);
+            __m128i v2 = _mm_avg_epu8(u, d);
+            __m128i cross = avg4(l, rt, u, d);
+            __m128i diag = avg4(load(r.up + x - 1), load(r.up + x + 1), load(r.down + x - 1), load(r.down + x + 1));
+
+            // x is odd: lane i holds the row's R / B when (i + 1) % 2 == color_parity
+            __m128i at_color = kind.color_parity == 0 ? _mm_set1_epi16(static_cast<short>(0xff00))
+                                                       : _mm_set1_epi16(0x00ff);
+            __m128i own = _mm_blendv_epi8(h2, c, at_color);
+            __m128i g = _mm_blendv_epi8(c, cross, at_color);
+            __m128i other = _mm_blendv_epi8(v2, diag, at_color);
+
+            if (kind.red_row)
+                store_bgr(other, g, own, out);
+            else
+                store_bgr(own, g, other, out);
+        }
+    };
+} // namespace
+
+void vert::debayer_detail::rows_sse41(const uint8_t *src, size_t src_stride, uint8_t *dst, size_t dst_stride,
+                                      int width, int height, BayerPattern pattern, int row_begin, int row_end)
+{
+    rows<Sse41Kernel>(src, src_stride, dst, dst_stride, width, height, pattern, row_begin, row_end);
+}
@@ -0,0 +1,88 @@
+#include "downscale.h"
+#include <vector>
+#include <cassert>
+
+using namespace std;
+
+bool vert::is_valid_downscale_factor(int factor)
+{
+    return factor == 1 || factor == 2 || factor == 4 || factor == 8;
+}
+
+void vert::box_downscale(const uint8_t *src, size_t src_stride, int width, int height, int channels, int factor,
+                         uint8_t *dst, size_t dst_stride)
+{
+    box_downscale_rows(src, src_stride, width, channels, factor, dst, dst_stride, 0, downscaled_size(height, factor));
+}
+
+namespace
+{
+    // fixed factor / channel count, so the compiler unrolls and vectorizes the sums
+    template <int Factor, int Channels>
+    void downscale_rows(const uint8_t *src, size_t src_stride, int out_width, uint8_t *dst, size_t dst_stride,
+                        int row_begin, int row_end, uint16_t *acc)
+    {
+        constexpr int kShift = Factor == 8 ? 6 : (Factor == 4 ? 4 : (Factor == 2 ? 2 : 0));
+        constexpr uint32_t kRound = (1u << kShift) >> 1;
+        const size_t row_len = static_cast<size_t>(out_width) * Factor * Channels;
+
+        for (int oy = row_begin; oy < row_end; ++oy) {
+            const uint8_t *row = src + static_cast<size_t>(oy) * Factor * src_stride;
+            for (size_t i = 0; i < row_len; ++i)
+                acc[i] = row[i];
+            for (int fy = 1; fy < Factor; ++fy) {
+                row += src_stride;
+                for (size_t i = 0; i < row_len; ++i)
+                    acc[i] = static_cast<uint16_t>(acc[i] + row[i]);
+            }
+
+            // horizontal sums by halving: acc[i] += acc[i + span] are plain offset adds the compiler
+            // vectorizes, afterwards acc[ox * Factor * Channels + c] holds the whole block
+            for (int span = Channels; span < Factor * Channels; span *= 2) {
+                for (size_t i = 0; i + span < row_len; ++i)
+                    acc[i] = static_cast<uint16_t>(acc[i] + acc[i + span]);
+            }
+
+            uint8_t *out = dst + static_cast<size_t>(oy) * dst_stride;
+            const uint16_t *a = acc;
+            for (int ox = 0; ox < out_width; ++ox) {
+                for (int c = 0; c < Channels; ++c)
+                    out[c] = static_cast<uint8_t>((a[c] + kRound) >> kShift);
+                a += Factor * Channels;
+                out += Channels;
+            }
+        }
+    }
+
+    template <int Channels>
+    void downscale_rows(int factor, const uint8_t *src, size_t src_stride, int out_width, uint8_t *dst, size_t dst_stride,
+                        int row_begin, int row_end, uint16_t *acc)
+    {
+        switch (factor) {
+        case 1: downscale_rows<1, Channels>(src, src_stride, out_width, dst, dst_stride, row_begin, row_end, acc); break;
+        case 2: downscale_rows<2, Channels>(src, src_stride, out_width, dst, dst_stride, row_begin, row_end, acc); break;
+        case 4: downscale_rows<4, Channels>(src, src_stride, out_width, dst, dst_stride, row_begin, row_end, acc); break;
+        case 8: downscale_rows<8, Channels>(src, src_stride, out_width, dst, dst_stride, row_begin, row_end, acc); break;
+        default: assert(false);
+        }
+    }
+} // namespace
+
+void vert::box_downscale_rows(const uint8_t *src, size_t src_stride, int width, int channels, int factor,
+                              uint8_t *dst, size_t dst_stride, int row_begin, int row_end)
+{
+    assert(is_valid_downscale_factor(factor));
+    assert(channels == 1 || channels == 3);
+    const int out_width = downscaled_size(width, factor);
+
+    // block sums, at most 8 * 8 * 255 so 16 bit lanes; kept per thread across calls
+    thread_local vector<uint16_t> acc;
+    size_t row_len = static_cast<size_t>(out_width) * factor * channels;
+    if (acc.size() < row_len)
+        acc.resize(row_len);
+
+    if (channels == 3)
+        downscale_rows<3>(factor, src, src_stride, out_width, dst, dst_stride, row_begin, row_end, acc.data());
+    else
+        downscale_rows<1>(factor, src, src_stride, out_width, dst, dst_stride, row_begin, row_end, acc.data());
+}
@@ -0,0 +1,154 @@
+#include "frame_header.h"
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include "../third_party/msgpack.hpp"
+#include "string_utils.h"
+
+namespace {
+    constexpr size_t kMaxDevices = 1024;
+
+    std::mutex intern_mutex;
+    std::array<std::string, kMaxDevices> interned;
+    std::atomic<size_t> interned_count{0};
+
+    size_t find_interned(std::string_view device_id, size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; ++i) {
+            if (interned[i] == device_id)
+                return i;
+        }
+        return end;
+    }
+}
+
+uint16_t vert::intern_device(std::string_view device_id)
+{
+    size_t count = interned_count.load(std::memory_order_acquire);
+    size_t index = find_interned(device_id, 0, count);
+    if (index < count)
+        return static_cast<uint16_t>(index);
+
+    std::lock_guard<std::mutex> lock(intern_mutex);
+    size_t new_count = interned_count.load(std::memory_order_relaxed);
+    index = find_interned(device_id, count, new_count);
+    if (index < new_count)
+        return static_cast<uint16_t>(index);
+
+    if (new_count >= kMaxDevices)
+        return kUnknownDevice;
+
+    interned[new_count] = std::string(device_id);
+    interned_count.store(new_count + 1, std::memory_order_release);
+    return static_cast<uint16_t>(new_count);
+}
+
+std::string_view vert::device_name(uint16_t device)
+{
+    if (device < interned_count.load(std::memory_order_acquire))
+        return interned[device];
+    return "unknown";
+}
+
+bool vert::meta_encoding_from_string(std::string_view s, MetaEncoding &encoding)
+{
+    auto name = vert::to_lower(s);
+    if (name == "binary") encoding = MetaEncoding::Binary;
+    else if (name == "msgpack") encoding = MetaEncoding::Msgpack;
+    else return false;
+    return true;
+}
+
+const char *vert::meta_encoding_to_string(MetaEncoding encoding)
+{
+    return encoding == MetaEncoding::Msgpack ? "msgpack" : "binary";
+}
+
+vert::MetaEncoding vert::meta_encoding_for(MetaEncoding requested, std::string_view address)
+{
+    if (address.substr(0, 9) == "inproc://")
+        return requested;
+    return MetaEncoding::Msgpack;
+}
+
+vert::FrameHeader vert::to_frame_header(const GrabMeta &meta)
+{
+    FrameHeader header;
+    header.device = intern_device(meta.device_id);
+    header.id = meta.id;
+    header.timestamp = meta.timestamp;
+    header.error_cnt = meta.error_cnt;
+    header.buffer_size = meta.buffer_size;
+    header.height = meta.height;
+    header.width = meta.width;
+    header.pixel_type = meta.pixel_type;
+    header.padding_x = meta.padding_x;
+    return header;
+}
+
+vert::FrameHeader vert::to_frame_header(const MatMeta &meta)
+{
+    FrameHeader header;
+    header.device = intern_device(meta.device_id);
+    header.id = meta.id;
+    header.timestamp = meta.timestamp;
+    header.error_cnt = meta.error_cnt;
+    header.height = meta.height;
+    header.width = meta.width;
+    header.cv_type = meta.cv_type;
+    header.cn = meta.cn;
+    // bit_depth travels in the binary header only, MatMeta keeps its wire layout for existing consumers
+    return header;
+}
+
+vert::GrabMeta vert::to_grab_meta(const FrameHeader &header)
+{
+    return GrabMeta{std::string(device_name(header.device)),
+                    header.id,
+                    header.height,
+                    header.width,
+                    header.pixel_type,
+                    header.timestamp,
+                    header.error_cnt,
+                    header.padding_x,
+                    header.buffer_size};
+}
+
+vert::MatMeta vert::to_mat_meta(const FrameHeader &header)
+{
+    return MatMeta{std::string(device_name(header.device)),
+                   header.id,
+                   header.height,
+                   header.width,
+                   header.cv_type,
+                   header.cn,
+                   header.timestamp,
+                   header.error_cnt};
+}
+
+bool vert::decode_grab_meta(const void *data, size_t size, FrameHeader &out)
+{
+    if (read_frame_header(data, size, out))
+        return true;
+
+    std::error_code ec;
+    auto meta = msgpack::unpack<GrabMeta>(static_cast<const uint8_t *>(data), size, ec);
+    if (ec)
+        return false;
+    out = to_frame_header(meta);
+    return true;
+}
+
+bool vert::decode_mat_meta(const void *data, size_t size, FrameHeader &out)
+{
+    if (read_frame_header(data, size, out))
+        return true;
+
+    std::error_code ec;
+    auto meta = msgpack::unpack<MatMeta>(static_cast<const uint8_t *>(data), size, ec);
+    if (ec)
+        return false;
+    out = to_frame_header(meta);
+    return true;
+}
@@ -0,0 +1,167 @@
+#include <opencv2/imgproc.hpp>
+#include "lazy_frame.h"
+#include "pylon_utils.h"
+#include "cv_utils.h"
+#include "debayer.h"
+#include "unpack.h"
+#include "string_utils.h"
+
+using namespace std;
+
+bool vert::frame_view_from_string(std::string_view s, FrameView &view)
+{
+    auto name = vert::to_lower(s);
+    if (name == "raw") view = FrameView::Raw;
+    else if (name == "gray" || name == "mono") view = FrameView::Gray;
+    else if (name == "bgr") view = FrameView::BGR;
+    else return false;
+    return true;
+}
+
+vert::LazyFrame::LazyFrame(const FrameHeader &header, const void *data, size_t size, SimdLevel level)
+{
+    reset(header, data, size, level);
+}
+
+void vert::LazyFrame::reset(const FrameHeader &header, const void *data, size_t size, SimdLevel level)
+{
+    header_ = header;
+    data_ = data;
+    size_ = size;
+    level_ = level;
+    // keep only buffers a view owns alone, anything aliasing the previous frame or another view
+    // would be written in place by the next conversion
+    for (int i = 0; i < 3; ++i) {
+        if (!views_[i].u || views_[i].data == raw8_.data)
+            views_[i].release();
+        ready_[i] = false;
+    }
+    if (!raw8_.u)
+        raw8_.release();
+    raw8_ready_ = false;
+    conversions_ = 0;
+}
+
+const cv::Mat &vert::LazyFrame::get(FrameView view)
+{
+    int i = static_cast<int>(view);
+    if (!ready_[i]) {
+        bool ok = false;
+        switch (view) {
+        case FrameView::Raw: ok = make_raw(); break;
+        case FrameView::Gray: ok = make_gray(); break;
+        case FrameView::BGR: ok = make_bgr(); break;
+        }
+        if (!ok)
+            views_[i].release();
+        ready_[i] = true; // failures are not retried either
+    }
+    return views_[i];
+}
+
+bool vert::LazyFrame::make_raw()
+{
+    cv::Mat &out = views_[static_cast<int>(FrameView::Raw)];
+    int height = header_.height, width = header_.width;
+    auto *data = static_cast<uint8_t *>(const_cast<void *>(data_));
+
+    if (!is_raw()) {
+        if (size_ < static_cast<size_t>(height) * width * CV_ELEM_SIZE(header_.cv_type))
+            return false;
+        out = cv::Mat(height, width, header_.cv_type, data);
+        return true;
+    }
+
+    if (int bits = vert::packed_bit_depth(header_.pixel_type)) {
+        out.create(height, width, CV_16UC1);
+        ++conversions_;
+        return vert::unpack_image_to_16(data, size_, width, height, header_.padding_x, bits,
+                                        out.ptr<uint16_t>(), out.step, level_);
+    }
+
+    int cv_type = vert::pixel_type_to_cv_type(header_.pixel_type);
+    if (cv_type == -1)
+        return false;
+    size_t step = static_cast<size_t>(width) * CV_ELEM_SIZE(cv_type) + header_.padding_x;
+    if (height == 0 || size_ < step * (height - 1) + static_cast<size_t>(width) * CV_ELEM_SIZE(cv_type))
+        return false;
+    out = cv::Mat(height, width, cv_type, data, step);
+    return true;
+}
+
+const cv::Mat &vert::LazyFrame::raw8()
+{
+    if (raw8_ready_)
+        return raw8_;
+    raw8_ready_ = true;
+
+    int bits = is_raw() ? vert::packed_bit_depth(header_.pixel_type) : 0;
+    if (bits != 0) {
+        // straight from the packed stream, cheaper than going through the 16 bit view
+        raw8_.create(header_.height, header_.width, CV_8UC1);
+        ++conversions_;
+        if (!vert::unpack_image_to_8(static_cast<const uint8_t *>(data_), size_, header_.width, header_.height,
+                                     header_.padding_x, bits, raw8_.data, raw8_.step, nullptr, level_))
+            raw8_.release();
+        return raw8_;
+    }
+
+    const cv::Mat &raw_view = raw();
+    if (raw_view.empty() || raw_view.depth() == CV_8U) {
+        raw8_ = raw_view;
+    } else {
+        int significant = header_.bit_depth > 8 ? header_.bit_depth : 16;
+        raw_view.convertTo(raw8_, CV_8U, 1.0 / (1 << (significant - 8)));
+        ++conversions_;
+    }
+    return raw8_;
+}
+
+bool vert::LazyFrame::make_gray()
+{
+    cv::Mat &out = views_[static_cast<int>(FrameView::Gray)];
+    const cv::Mat &src = raw8();
+    if (src.empty())
+        return false;
+
+    BayerPattern pattern;
+    if (is_raw() && vert::pixel_type_to_bayer_pattern(header_.pixel_type, pattern)) {
+        cv::cvtColor(src, out, vert::cv_bayer_to_gray_code(pattern));
+    } else if (src.channels() == 1) {
+        out = src;
+        return true;
+    } else if (is_raw() && (Pylon::IsRGB(static_cast<Pylon::EPixelType>(header_.pixel_type)) ||
+                            Pylon::IsRGBPacked(static_cast<Pylon::EPixelType>(header_.pixel_type)))) {
+        cv::cvtColor(src, out, cv::COLOR_RGB2GRAY);
+    } else {
+        cv::cvtColor(src, out, cv::COLOR_BGR2GRAY);
+    }
+    ++conversions_;
+    return true;
+}
+
+bool vert::LazyFrame::make_bgr()
+{
+    cv::Mat &out = views_[static_cast<int>(FrameView::BGR)];
+    const cv::Mat &src = raw8();
+    if (src.empty())
+        return false;
+
+    BayerPattern pattern;
+    if (is_raw() && vert::pixel_type_to_bayer_pattern(header_.pixel_type, pattern)) {
+        out.create(src.rows, src.cols, CV_8UC3);
+        vert::debayer_bilinear(src.data, src.step, out.data, out.step, src.cols, src.rows, pattern, level_);
+    } else if (src.channels() == 3) {
+        if (is_raw() && (Pylon::IsRGB(static_cast<Pylon::EPixelType>(header_.pixel_type)) ||
+                         Pylon::IsRGBPacked(static_cast<Pylon::EPixelType>(header_.pixel_type)))) {
+            cv::cvtColor(src, out, cv::COLOR_RGB2BGR);
+        } else {
+            out = src;
+            return true;
+        }
+    } else {
+        cv::cvtColor(src, out, cv::COLOR_GRAY2BGR);
+    }
+    ++conversions_;
+    return true;
+}
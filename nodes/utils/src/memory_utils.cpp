@@ -0,0 +1,176 @@
+#include "memory_utils.h"
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+size_t vert::page_size()
+{
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwPageSize;
+#else
+    return static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+}
+
+size_t vert::huge_page_size()
+{
+#ifdef _WIN32
+    return GetLargePageMinimum();
+#elif defined(MAP_HUGETLB)
+    return 2 * 1024 * 1024; // default hugetlbfs size on x86_64
+#else
+    return 0;
+#endif
+}
+
+void *vert::alloc_pages(size_t size, bool hugepages, bool *is_huge)
+{
+    if (is_huge)
+        *is_huge = false;
+    if (size == 0)
+        return nullptr;
+
+#ifdef _WIN32
+    if (hugepages && huge_page_size() > 0) {
+        // needs SeLockMemoryPrivilege, silently falls back otherwise
+        void *ptr = VirtualAlloc(nullptr, align_up(size, huge_page_size()),
+                                 MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+        if (ptr) {
+            if (is_huge)
+                *is_huge = true;
+            return ptr;
+        }
+    }
+    void *ptr = VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+    if (ptr)
+        std::memset(ptr, 0, size); // pre-fault
+    return ptr;
+#else
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#ifdef MAP_POPULATE
+    flags |= MAP_POPULATE;
+#endif
+
+#ifdef MAP_HUGETLB
+    if (hugepages) {
+        void *ptr = mmap(nullptr, align_up(size, huge_page_size()), PROT_READ | PROT_WRITE, flags | MAP_HUGETLB, -1, 0);
+        if (ptr != MAP_FAILED) {
+            if (is_huge)
+                *is_huge = true;
+            return ptr;
+        }
+    }
+#endif
+
+    void *ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, flags, -1, 0);
+    if (ptr == MAP_FAILED)
+        return nullptr;
+#ifdef MADV_HUGEPAGE
+    if (hugepages)
+        madvise(ptr, size, MADV_HUGEPAGE); // transparent huge pages as second best
+#endif
+    return ptr;
+#endif
+}
+
+void vert::free_pages(void *ptr, size_t size, bool is_huge)
+{
+    if (!ptr)
+        return;
+#ifdef _WIN32
+    VirtualFree(ptr, 0, MEM_RELEASE);
+#else
+    munmap(ptr, is_huge ? align_up(size, huge_page_size()) : size);
+#endif
+}
+
+vert::MappedFile::~MappedFile()
+{
+    close();
+}
+
+bool vert::MappedFile::open(const std::string &path)
+{
+    close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+        CloseHandle(file);
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping) {
+        CloseHandle(file);
+        return false;
+    }
+
+    void *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!view) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+
+    file_ = file;
+    mapping_ = mapping;
+    data_ = static_cast<const uint8_t *>(view);
+    size_ = static_cast<size_t>(size.QuadPart);
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        ::close(fd);
+        return false;
+    }
+
+    void *view = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd); // the mapping keeps the file referenced
+    if (view == MAP_FAILED)
+        return false;
+
+#ifdef MADV_SEQUENTIAL
+    madvise(view, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+#endif
+
+    data_ = static_cast<const uint8_t *>(view);
+    size_ = static_cast<size_t>(st.st_size);
+#endif
+    return true;
+}
+
+void vert::MappedFile::close()
+{
+    if (!data_)
+        return;
+
+#ifdef _WIN32
+    UnmapViewOfFile(data_);
+    CloseHandle(mapping_);
+    CloseHandle(file_);
+    mapping_ = nullptr;
+    file_ = nullptr;
+#else
+    munmap(const_cast<uint8_t *>(data_), size_);
+#endif
+    data_ = nullptr;
+    size_ = 0;
+}
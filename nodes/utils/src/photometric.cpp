@@ -0,0 +1,152 @@
+#include <algorithm>
+#include <cstring>
+#include "photometric.h"
+#include "photometric_kernel.h"
+
+using namespace std;
+using namespace vert::photometric_detail;
+
+namespace
+{
+    size_t none8(const uint8_t *, const uint16_t *, const uint16_t *, uint16_t *, size_t, uint16_t) { return 0; }
+    size_t none16(const uint16_t *, const uint16_t *, const uint16_t *, uint16_t *, size_t, uint16_t) { return 0; }
+
+    struct Kernels {
+        Gain8Fn gain8 = none8;
+        Gain16Fn gain16 = none16;
+    };
+
+    Kernels kernels(vert::SimdLevel level)
+    {
+        using vert::SimdLevel;
+        Kernels k;
+        switch (vert::photometric_simd_level(level)) {
+#if defined(VERT_X86_SIMD)
+        case SimdLevel::AVX2:
+            k.gain8 = gain8_avx2;
+            k.gain16 = gain16_avx2;
+            break;
+        case SimdLevel::SSE41:
+            k.gain8 = gain8_sse41;
+            k.gain16 = gain16_sse41;
+            break;
+#endif
+        default:
+            break;
+        }
+        return k;
+    }
+
+    // dst[i] = lut of channel i % channels at idx[i], row starts on channel 0.
+    // Clamp: idx may exceed the table (16 bit input straight from the frame)
+    template <bool Clamp, typename I, typename T>
+    void lookup(const I *idx, T *dst, size_t count, int channels, const T *lut, size_t table, uint16_t max_value)
+    {
+        auto at = [max_value](I v) -> size_t { return Clamp ? min<uint16_t>(v, max_value) : v; };
+        if (channels == 3) {
+            const T *l0 = lut, *l1 = lut + table, *l2 = lut + 2 * table;
+            size_t i = 0;
+            for (; i + 3 <= count; i += 3) {
+                I v0 = idx[i], v1 = idx[i + 1], v2 = idx[i + 2];
+                dst[i] = l0[at(v0)];
+                dst[i + 1] = l1[at(v1)];
+                dst[i + 2] = l2[at(v2)];
+            }
+            for (; i < count; ++i)
+                dst[i] = lut[(i % 3) * table + at(idx[i])];
+        } else {
+            for (size_t i = 0; i < count; ++i)
+                dst[i] = lut[at(idx[i])];
+        }
+    }
+
+    template <typename T, typename GainFn>
+    void correct_row(const T *src, T *dst, size_t count, int channels, int bits,
+                     const uint16_t *offset, const uint16_t *gain, const T *lut, GainFn gain_fn)
+    {
+        const uint16_t max_value = static_cast<uint16_t>((1u << bits) - 1);
+        const size_t table = size_t(1) << bits;
+        if (!offset || !gain) {
+            if (lut) {
+                lookup<sizeof(T) != 1>(src, dst, count, channels, lut, table, max_value);
+            } else if (src != dst) {
+                memcpy(dst, src, count * sizeof(T));
+            }
+            return;
+        }
+
+        // dark / flat into a cache sized chunk of 16 bit samples, then through the lut into dst:
+        // still a single pass over the image. Chunks hold whole pixels, every chunk starts on channel 0.
+        constexpr size_t kChunk = 3 * 512;
+        uint16_t tmp[kChunk];
+        for (size_t begin = 0; begin < count; begin += kChunk) {
+            size_t n = min(kChunk, count - begin);
+            size_t i = gain_fn(src + begin, offset + begin, gain + begin, tmp, n, max_value);
+            for (; i < n; ++i)
+                tmp[i] = gain_sample(src[begin + i], offset[begin + i], gain[begin + i], max_value);
+            if (lut) {
+                lookup<false>(tmp, dst + begin, n, channels, lut, table, max_value);
+            } else {
+                for (size_t j = 0; j < n; ++j)
+                    dst[begin + j] = static_cast<T>(tmp[j]);
+            }
+        }
+    }
+
+    template <typename T>
+    const T *row(const T *base, size_t stride, int y)
+    {
+        return base ? reinterpret_cast<const T *>(reinterpret_cast<const uint8_t *>(base) + y * stride) : nullptr;
+    }
+
+    template <typename T>
+    T *row(T *base, size_t stride, int y)
+    {
+        return reinterpret_cast<T *>(reinterpret_cast<uint8_t *>(base) + y * stride);
+    }
+} // namespace
+
+vert::SimdLevel vert::photometric_simd_level(SimdLevel wanted)
+{
+    // no AVX-512 kernel, the scalar lut lookup dominates once the gain step is 16 lanes wide
+    SimdLevel level = clamp_simd_level(wanted);
+    return level == SimdLevel::AVX512 ? SimdLevel::AVX2 : level;
+}
+
+void vert::photometric_row_8(const uint8_t *src, uint8_t *dst, size_t count, int channels,
+                             const uint16_t *offset, const uint16_t *gain, const uint8_t *lut, SimdLevel level)
+{
+    correct_row(src, dst, count, channels, 8, offset, gain, lut, kernels(level).gain8);
+}
+
+void vert::photometric_row_16(const uint16_t *src, uint16_t *dst, size_t count, int channels, int bits,
+                              const uint16_t *offset, const uint16_t *gain, const uint16_t *lut, SimdLevel level)
+{
+    if (!is_supported_photometric_bits(bits))
+        return;
+    correct_row(src, dst, count, channels, bits, offset, gain, lut, kernels(level).gain16);
+}
+
+void vert::photometric_rows_8(const uint8_t *src, size_t src_stride, uint8_t *dst, size_t dst_stride, int width, int channels,
+                              const uint16_t *offset, const uint16_t *gain, size_t map_stride, const uint8_t *lut,
+                              int row_begin, int row_end, SimdLevel level)
+{
+    Kernels k = kernels(level);
+    size_t count = static_cast<size_t>(width) * channels;
+    for (int y = row_begin; y < row_end; ++y)
+        correct_row(row(src, src_stride, y), row(dst, dst_stride, y), count, channels, 8,
+                    row(offset, map_stride, y), row(gain, map_stride, y), lut, k.gain8);
+}
+
+void vert::photometric_rows_16(const uint16_t *src, size_t src_stride, uint16_t *dst, size_t dst_stride, int width, int channels, int bits,
+                               const uint16_t *offset, const uint16_t *gain, size_t map_stride, const uint16_t *lut,
+                               int row_begin, int row_end, SimdLevel level)
+{
+    if (!is_supported_photometric_bits(bits))
+        return;
+    Kernels k = kernels(level);
+    size_t count = static_cast<size_t>(width) * channels;
+    for (int y = row_begin; y < row_end; ++y)
+        correct_row(row(src, src_stride, y), row(dst, dst_stride, y), count, channels, bits,
+                    row(offset, map_stride, y), row(gain, map_stride, y), lut, k.gain16);
+}
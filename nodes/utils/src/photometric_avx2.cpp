@@ -0,0 +1,42 @@
+// compiled with -mavx2, only reached through photometric.cpp after cpu_simd_level() said so
+#include <immintrin.h>
+#include "photometric_kernel.h"
+
+using namespace vert::photometric_detail;
+
+namespace
+{
+    // 16 samples in 16 bit lanes, see gain_sample()
+    inline __m256i gain_block(__m256i v, const uint16_t *offset, const uint16_t *gain, __m256i max_value)
+    {
+        __m256i o = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(offset));
+        __m256i g = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(gain));
+        __m256i t = _mm256_subs_epu16(_mm256_min_epu16(v, max_value), o);
+        t = _mm256_or_si256(_mm256_slli_epi16(t, kLaneShift), _mm256_set1_epi16(kHalfStep));
+        return _mm256_min_epu16(_mm256_mulhi_epu16(t, g), max_value);
+    }
+} // namespace
+
+size_t vert::photometric_detail::gain8_avx2(const uint8_t *src, const uint16_t *offset, const uint16_t *gain, uint16_t *dst,
+                                            size_t count, uint16_t max_value)
+{
+    __m256i max_v = _mm256_set1_epi16(static_cast<short>(max_value));
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m256i v = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), gain_block(v, offset + i, gain + i, max_v));
+    }
+    return i;
+}
+
+size_t vert::photometric_detail::gain16_avx2(const uint16_t *src, const uint16_t *offset, const uint16_t *gain, uint16_t *dst,
+                                             size_t count, uint16_t max_value)
+{
+    __m256i max_v = _mm256_set1_epi16(static_cast<short>(max_value));
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), gain_block(v, offset + i, gain + i, max_v));
+    }
+    return i;
+}
@@ -0,0 +1,50 @@
+#ifndef _PHOTOMETRIC_KERNEL_H_
+#define _PHOTOMETRIC_KERNEL_H_
+
+#include <cstddef>
+#include <cstdint>
+#include "../photometric.h"
+
+// Shared by photometric.cpp and the photometric_<isa>.cpp files, each compiled with its own instruction set flags.
+// Internal linkage only, see debayer_kernel.h.
+
+namespace vert
+{
+    namespace photometric_detail
+    {
+        // The dark / flat step into 16 bit lanes, the lut lookup stays scalar. Each returns how many samples it
+        // handled (a multiple of its block), the caller finishes the tail.
+        using Gain8Fn = size_t (*)(const uint8_t *src, const uint16_t *offset, const uint16_t *gain, uint16_t *dst,
+                                   size_t count, uint16_t max_value);
+        using Gain16Fn = size_t (*)(const uint16_t *src, const uint16_t *offset, const uint16_t *gain, uint16_t *dst,
+                                    size_t count, uint16_t max_value);
+
+#if defined(VERT_X86_SIMD)
+        size_t gain8_sse41(const uint8_t *src, const uint16_t *offset, const uint16_t *gain, uint16_t *dst, size_t count, uint16_t max_value);
+        size_t gain16_sse41(const uint16_t *src, const uint16_t *offset, const uint16_t *gain, uint16_t *dst, size_t count, uint16_t max_value);
+        size_t gain8_avx2(const uint8_t *src, const uint16_t *offset, const uint16_t *gain, uint16_t *dst, size_t count, uint16_t max_value);
+        size_t gain16_avx2(const uint16_t *src, const uint16_t *offset, const uint16_t *gain, uint16_t *dst, size_t count, uint16_t max_value);
+#endif
+
+        namespace
+        {
+            // samples of at most 12 bits move to the top of a 16 bit lane, so one mulhi applies the Q12 gain;
+            // the low bits get the half step (centre of the bin)
+            constexpr int kLaneShift = 16 - kPhotometricGainBits;
+            constexpr uint16_t kHalfStep = 1 << (kLaneShift - 1);
+
+            inline uint16_t gain_sample(uint32_t v, uint32_t offset, uint32_t gain, uint32_t max_value)
+            {
+                v = v < max_value ? v : max_value;
+                uint32_t t = v > offset ? v - offset : 0;
+                uint32_t r = (((t << kLaneShift) | kHalfStep) * gain) >> 16;
+                return static_cast<uint16_t>(r < max_value ? r : max_value);
+            }
+
+        } // namespace
+
+    } // namespace photometric_detail
+
+} // namespace vert
+
+#endif /* _PHOTOMETRIC_KERNEL_H_ */
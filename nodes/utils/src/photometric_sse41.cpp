@@ -0,0 +1,42 @@
+// compiled with -msse4.1, only reached through photometric.cpp after cpu_simd_level() said so
+#include <smmintrin.h>
+#include "photometric_kernel.h"
+
+using namespace vert::photometric_detail;
+
+namespace
+{
+    // 8 samples in 16 bit lanes, see gain_sample()
+    inline __m128i gain_block(__m128i v, const uint16_t *offset, const uint16_t *gain, __m128i max_value)
+    {
+        __m128i o = _mm_loadu_si128(reinterpret_cast<const __m128i *>(offset));
+        __m128i g = _mm_loadu_si128(reinterpret_cast<const __m128i *>(gain));
+        __m128i t = _mm_subs_epu16(_mm_min_epu16(v, max_value), o);
+        t = _mm_or_si128(_mm_slli_epi16(t, kLaneShift), _mm_set1_epi16(kHalfStep));
+        return _mm_min_epu16(_mm_mulhi_epu16(t, g), max_value);
+    }
+} // namespace
+
+size_t vert::photometric_detail::gain8_sse41(const uint8_t *src, const uint16_t *offset, const uint16_t *gain, uint16_t *dst,
+                                             size_t count, uint16_t max_value)
+{
+    __m128i max_v = _mm_set1_epi16(static_cast<short>(max_value));
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i v = _mm_cvtepu8_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(src + i)));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), gain_block(v, offset + i, gain + i, max_v));
+    }
+    return i;
+}
+
+size_t vert::photometric_detail::gain16_sse41(const uint16_t *src, const uint16_t *offset, const uint16_t *gain, uint16_t *dst,
+                                              size_t count, uint16_t max_value)
+{
+    __m128i max_v = _mm_set1_epi16(static_cast<short>(max_value));
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), gain_block(v, offset + i, gain + i, max_v));
+    }
+    return i;
+}
@@ -140,7 +140,15 @@ bool vert::set_pixel_format(Pylon::CBaslerUniversalInstantCamera &camera, std::s
         {"mono8",{BPFE::PixelFormat_Mono8}},
         {"bayer",{
             BPFE::PixelFormat_BayerRG8, BPFE::PixelFormat_BayerBG8, 
-            BPFE::PixelFormat_BayerGR8, BPFE::PixelFormat_BayerGB8}}
+            BPFE::PixelFormat_BayerGR8, BPFE::PixelFormat_BayerGB8}},
+        {"mono10p", {BPFE::PixelFormat_Mono10p}},
+        {"mono12p", {BPFE::PixelFormat_Mono12p}},
+        {"bayer10p",{
+            BPFE::PixelFormat_BayerRG10p, BPFE::PixelFormat_BayerBG10p,
+            BPFE::PixelFormat_BayerGR10p, BPFE::PixelFormat_BayerGB10p}},
+        {"bayer12p",{
+            BPFE::PixelFormat_BayerRG12p, BPFE::PixelFormat_BayerBG12p,
+            BPFE::PixelFormat_BayerGR12p, BPFE::PixelFormat_BayerGB12p}}
     };
 
     if (auto it = format_map.find(format_lower); it != format_map.end()) {
@@ -152,7 +160,9 @@ bool vert::set_pixel_format(Pylon::CBaslerUniversalInstantCamera &camera, std::s
         }
     }
 
-    std::set<std::string> vert_supported_set = {"Mono8", "BGR8Packed", "RGB8Packed", "BayerGR8", "BayerRG8", "BayerGB8", "BayerBG8"};
+    std::set<std::string> vert_supported_set = {"Mono8", "BGR8Packed", "RGB8Packed", "BayerGR8", "BayerRG8", "BayerGB8", "BayerBG8",
+                                                "Mono10p", "Mono12p", "BayerGR10p", "BayerRG10p", "BayerGB10p", "BayerBG10p",
+                                                "BayerGR12p", "BayerRG12p", "BayerGB12p", "BayerBG12p"};
     std::set<std::string> pylon_supported_set;
     GenApi_3_1_Basler_pylon_v3::StringList_t supported_list;
     camera.PixelFormat.GetSettableValues(supported_list);
@@ -0,0 +1,66 @@
+#include "thread_utils.h"
+#include <thread>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+bool vert::set_current_thread_affinity(const std::vector<int> &cpus)
+{
+    if (cpus.empty())
+        return true;
+
+#ifdef _WIN32
+    DWORD_PTR mask = 0;
+    for (int cpu : cpus) {
+        if (cpu < 0 || cpu >= static_cast<int>(sizeof(DWORD_PTR) * 8))
+            return false;
+        mask |= DWORD_PTR(1) << cpu;
+    }
+    return SetThreadAffinityMask(GetCurrentThread(), mask) != 0;
+#elif defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus) {
+        if (cpu < 0 || cpu >= CPU_SETSIZE)
+            return false;
+        CPU_SET(cpu, &set);
+    }
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    return false;
+#endif
+}
+
+void vert::set_current_thread_name(const std::string &name)
+{
+#if defined(_MSC_VER)
+    std::wstring wname(name.begin(), name.end());
+    SetThreadDescription(GetCurrentThread(), wname.c_str());
+#elif defined(__linux__)
+    pthread_setname_np(pthread_self(), name.substr(0, 15).c_str());
+#endif
+}
+
+unsigned int vert::hardware_concurrency()
+{
+    unsigned int n = std::thread::hardware_concurrency();
+    return n > 0 ? n : 1;
+}
+
+std::vector<int> vert::cpus_from_yaml(const YAML::Node &node)
+{
+    std::vector<int> cpus;
+    if (!node)
+        return cpus;
+    if (node.IsSequence()) {
+        for (const auto &cpu : node)
+            cpus.push_back(cpu.as<int>());
+    } else {
+        cpus.push_back(node.as<int>());
+    }
+    return cpus;
+}
@@ -0,0 +1,124 @@
+#include "unpack.h"
+#include "unpack_kernel.h"
+
+using namespace std;
+using namespace vert::unpack_detail;
+
+namespace
+{
+    size_t none16(const uint8_t *, size_t, uint16_t *, size_t, int) { return 0; }
+    size_t none8(const uint8_t *, size_t, uint8_t *, size_t, int) { return 0; }
+
+    struct Kernels {
+        Unpack16Fn to16 = none16;
+        Unpack8Fn to8 = none8;
+    };
+
+    Kernels kernels(vert::SimdLevel level)
+    {
+        using vert::SimdLevel;
+        Kernels k;
+        switch (vert::unpack_simd_level(level)) {
+#if defined(VERT_X86_SIMD)
+        case SimdLevel::AVX2:
+            k.to16 = unpack16_avx2;
+            k.to8 = unpack8_avx2;
+            break;
+        case SimdLevel::SSE41:
+            k.to16 = unpack16_sse41;
+            k.to8 = unpack8_sse41;
+            break;
+#endif
+        default:
+            break;
+        }
+        return k;
+    }
+} // namespace
+
+vert::SimdLevel vert::unpack_simd_level(SimdLevel wanted)
+{
+    // no AVX-512 kernel, two 128 bit lanes already saturate the stores
+    SimdLevel level = clamp_simd_level(wanted);
+    return level == SimdLevel::AVX512 ? SimdLevel::AVX2 : level;
+}
+
+void vert::unpack_to_16(const uint8_t *src, uint16_t *dst, size_t count, int bits, SimdLevel level)
+{
+    if (!is_supported_packed_bits(bits))
+        return;
+    size_t i = kernels(level).to16(src, packed_size(count, bits), dst, count, bits);
+    for (; i < count; ++i)
+        dst[i] = sample(src, i, bits);
+}
+
+void vert::unpack_to_8(const uint8_t *src, uint8_t *dst, size_t count, int bits, SimdLevel level)
+{
+    if (!is_supported_packed_bits(bits))
+        return;
+    size_t i = kernels(level).to8(src, packed_size(count, bits), dst, count, bits);
+    for (; i < count; ++i)
+        dst[i] = static_cast<uint8_t>(sample(src, i, bits) >> (bits - 8));
+}
+
+void vert::unpack_to_8_lut(const uint8_t *src, uint8_t *dst, size_t count, int bits, const uint8_t *lut,
+                           SimdLevel level)
+{
+    if (!is_supported_packed_bits(bits))
+        return;
+    // unpack a cache sized chunk to 16 bit, then look it up. chunks of 8 samples start on a byte boundary.
+    constexpr size_t kChunk = 2048;
+    uint16_t tmp[kChunk];
+    for (size_t begin = 0; begin < count; begin += kChunk) {
+        size_t n = min(kChunk, count - begin);
+        unpack_to_16(src + begin * bits / 8, tmp, n, bits, level);
+        for (size_t i = 0; i < n; ++i)
+            dst[begin + i] = lut[tmp[i]];
+    }
+}
+
+// dst_stride in bytes; unpack_row(src, dst, count) converts one run of samples
+template <typename T, typename F>
+static bool unpack_image(const uint8_t *src, size_t src_size, int width, int height, size_t padding_x, int bits,
+                         T *dst, size_t dst_stride, F &&unpack_row)
+{
+    if (!vert::is_supported_packed_bits(bits) || width <= 0 || height <= 0)
+        return false;
+    size_t row_bits = static_cast<size_t>(width) * bits;
+    bool continuous = padding_x == 0 && dst_stride == width * sizeof(T);
+    if (continuous) {
+        size_t count = static_cast<size_t>(width) * height;
+        if (src_size < vert::packed_size(count, bits))
+            return false;
+        unpack_row(src, dst, count);
+        return true;
+    }
+
+    if (row_bits % 8 != 0)
+        return false;
+    size_t src_stride = row_bits / 8 + padding_x;
+    if (src_size < src_stride * (height - 1) + row_bits / 8)
+        return false;
+    for (int y = 0; y < height; ++y)
+        unpack_row(src + y * src_stride, reinterpret_cast<T *>(reinterpret_cast<uint8_t *>(dst) + y * dst_stride), static_cast<size_t>(width));
+    return true;
+}
+
+bool vert::unpack_image_to_16(const uint8_t *src, size_t src_size, int width, int height, size_t padding_x, int bits,
+                              uint16_t *dst, size_t dst_stride, SimdLevel level)
+{
+    return unpack_image(src, src_size, width, height, padding_x, bits, dst, dst_stride,
+                        [&](const uint8_t *s, uint16_t *d, size_t n) { unpack_to_16(s, d, n, bits, level); });
+}
+
+bool vert::unpack_image_to_8(const uint8_t *src, size_t src_size, int width, int height, size_t padding_x, int bits,
+                             uint8_t *dst, size_t dst_stride, const uint8_t *lut, SimdLevel level)
+{
+    return unpack_image(src, src_size, width, height, padding_x, bits, dst, dst_stride,
+                        [&](const uint8_t *s, uint8_t *d, size_t n) {
+                            if (lut)
+                                unpack_to_8_lut(s, d, n, bits, lut, level);
+                            else
+                                unpack_to_8(s, d, n, bits, level);
+                        });
+}
@@ -0,0 +1,72 @@
+// compiled with -mavx2, only reached through unpack.cpp after cpu_simd_level() said so
+#include <immintrin.h>
+#include "unpack_kernel.h"
+
+using namespace vert::unpack_detail;
+
+namespace
+{
+    // two blocks of 8 samples, one per 128 bit lane, pshufb and the shifts work per lane
+    inline __m256i load2(const uint8_t *p, size_t block_bytes)
+    {
+        return _mm256_inserti128_si256(
+            _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p))),
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + block_bytes)), 1);
+    }
+
+    inline __m256i block10(const uint8_t *p)
+    {
+        __m256i v = _mm256_shuffle_epi8(load2(p, 10), _mm256_broadcastsi128_si256(
+                                                          _mm_load_si128(reinterpret_cast<const __m128i *>(kShuffle10.bytes))));
+        return _mm256_srli_epi16(
+            _mm256_mullo_epi16(v, _mm256_setr_epi16(64, 16, 4, 1, 64, 16, 4, 1, 64, 16, 4, 1, 64, 16, 4, 1)), 6);
+    }
+
+    inline __m256i block12(const uint8_t *p)
+    {
+        __m256i v = _mm256_shuffle_epi8(load2(p, 12), _mm256_broadcastsi128_si256(
+                                                          _mm_load_si128(reinterpret_cast<const __m128i *>(kShuffle12.bytes))));
+        return _mm256_blend_epi16(_mm256_and_si256(v, _mm256_set1_epi16(0x0fff)), _mm256_srli_epi16(v, 4), 0xaa);
+    }
+
+    template <int Bits>
+    inline __m256i block(const uint8_t *p)
+    {
+        return Bits == 10 ? block10(p) : block12(p);
+    }
+
+    template <int Bits>
+    size_t unpack16(const uint8_t *src, size_t src_bytes, uint16_t *dst, size_t count)
+    {
+        constexpr size_t kBlockBytes = Bits;  // 8 samples
+        size_t i = 0, in = 0;
+        for (; i + 16 <= count && in + kBlockBytes + 16 <= src_bytes; i += 16, in += 2 * kBlockBytes)
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), block<Bits>(src + in));
+        return i;
+    }
+
+    template <int Bits>
+    size_t unpack8(const uint8_t *src, size_t src_bytes, uint8_t *dst, size_t count)
+    {
+        constexpr size_t kBlockBytes = Bits;
+        size_t i = 0, in = 0;
+        for (; i + 32 <= count && in + 3 * kBlockBytes + 16 <= src_bytes; i += 32, in += 4 * kBlockBytes) {
+            __m256i lo = _mm256_srli_epi16(block<Bits>(src + in), Bits - 8);
+            __m256i hi = _mm256_srli_epi16(block<Bits>(src + in + 2 * kBlockBytes), Bits - 8);
+            // packus works per lane: a0 b0 a1 b1 -> a0 a1 b0 b1
+            __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(lo, hi), 0xd8);
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), packed);
+        }
+        return i;
+    }
+} // namespace
+
+size_t vert::unpack_detail::unpack16_avx2(const uint8_t *src, size_t src_bytes, uint16_t *dst, size_t count, int bits)
+{
+    return bits == 10 ? unpack16<10>(src, src_bytes, dst, count) : unpack16<12>(src, src_bytes, dst, count);
+}
+
+size_t vert::unpack_detail::unpack8_avx2(const uint8_t *src, size_t src_bytes, uint8_t *dst, size_t count, int bits)
+{
+    return bits == 10 ? unpack8<10>(src, src_bytes, dst, count) : unpack8<12>(src, src_bytes, dst, count);
+}
@@ -0,0 +1,63 @@
+#ifndef _UNPACK_KERNEL_H_
+#define _UNPACK_KERNEL_H_
+
+#include <cstddef>
+#include <cstdint>
+
+// Shared by unpack.cpp and the unpack_<isa>.cpp files, each compiled with its own instruction set flags.
+// Internal linkage only, see debayer_kernel.h.
+
+namespace vert
+{
+    namespace unpack_detail
+    {
+        // Each returns how many samples it converted (a multiple of its block), the caller finishes the tail.
+        // Vector loads may read up to 16 bytes past the last block, so they stop 16 bytes short of the input end.
+        using Unpack16Fn = size_t (*)(const uint8_t *src, size_t src_bytes, uint16_t *dst, size_t count, int bits);
+        using Unpack8Fn = size_t (*)(const uint8_t *src, size_t src_bytes, uint8_t *dst, size_t count, int bits);
+
+#if defined(VERT_X86_SIMD)
+        size_t unpack16_sse41(const uint8_t *src, size_t src_bytes, uint16_t *dst, size_t count, int bits);
+        size_t unpack8_sse41(const uint8_t *src, size_t src_bytes, uint8_t *dst, size_t count, int bits);
+        size_t unpack16_avx2(const uint8_t *src, size_t src_bytes, uint16_t *dst, size_t count, int bits);
+        size_t unpack8_avx2(const uint8_t *src, size_t src_bytes, uint8_t *dst, size_t count, int bits);
+#endif
+
+        namespace
+        {
+            inline uint16_t sample(const uint8_t *src, size_t i, int bits)
+            {
+                size_t bit = i * bits;
+                const uint8_t *p = src + (bit >> 3);
+                uint32_t word = p[0] | (static_cast<uint32_t>(p[1]) << 8);
+                return static_cast<uint16_t>((word >> (bit & 7)) & ((1u << bits) - 1));
+            }
+
+            // byte pairs holding the 8 samples of one block in 16 bit lanes, unused bytes zeroed:
+            // 12 bit: 8 samples in 12 bytes, sample j starts at byte 3j/2 (shift 0 or 4)
+            // 10 bit: 8 samples in 10 bytes, sample j starts at byte 10j/8 (shift 0, 2, 4, 6)
+            struct BlockShuffle {
+                alignas(16) uint8_t bytes[16];
+            };
+
+            constexpr BlockShuffle make_block_shuffle(int bits)
+            {
+                BlockShuffle s{};
+                for (int j = 0; j < 8; ++j) {
+                    int start = (j * bits) / 8;
+                    s.bytes[2 * j] = static_cast<uint8_t>(start);
+                    s.bytes[2 * j + 1] = static_cast<uint8_t>(start + 1);
+                }
+                return s;
+            }
+
+            constexpr BlockShuffle kShuffle10 = make_block_shuffle(10);
+            constexpr BlockShuffle kShuffle12 = make_block_shuffle(12);
+
+        } // namespace
+
+    } // namespace unpack_detail
+
+} // namespace vert
+
+#endif /* _UNPACK_KERNEL_H_ */
@@ -0,0 +1,64 @@
+// compiled with -msse4.1, only reached through unpack.cpp after cpu_simd_level() said so
+#include <smmintrin.h>
+#include "unpack_kernel.h"
+
+using namespace vert::unpack_detail;
+
+namespace
+{
+    // 8 samples of one block, byte pairs gathered by pshufb then shifted into place per lane
+    inline __m128i block10(const uint8_t *p)
+    {
+        __m128i v = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p)),
+                                     _mm_load_si128(reinterpret_cast<const __m128i *>(kShuffle10.bytes)));
+        // lane shifts are 0, 2, 4, 6: move the sample to the top with a multiply, then down by 6
+        return _mm_srli_epi16(_mm_mullo_epi16(v, _mm_setr_epi16(64, 16, 4, 1, 64, 16, 4, 1)), 6);
+    }
+
+    inline __m128i block12(const uint8_t *p)
+    {
+        __m128i v = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p)),
+                                     _mm_load_si128(reinterpret_cast<const __m128i *>(kShuffle12.bytes)));
+        // even lanes low 12 bits, odd lanes top 12 bits
+        return _mm_blend_epi16(_mm_and_si128(v, _mm_set1_epi16(0x0fff)), _mm_srli_epi16(v, 4), 0xaa);
+    }
+
+    template <int Bits>
+    inline __m128i block(const uint8_t *p)
+    {
+        return Bits == 10 ? block10(p) : block12(p);
+    }
+
+    template <int Bits>
+    size_t unpack16(const uint8_t *src, size_t src_bytes, uint16_t *dst, size_t count)
+    {
+        constexpr size_t kBlockBytes = Bits;  // 8 samples
+        size_t i = 0, in = 0;
+        for (; i + 8 <= count && in + 16 <= src_bytes; i += 8, in += kBlockBytes)
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), block<Bits>(src + in));
+        return i;
+    }
+
+    template <int Bits>
+    size_t unpack8(const uint8_t *src, size_t src_bytes, uint8_t *dst, size_t count)
+    {
+        constexpr size_t kBlockBytes = Bits;
+        size_t i = 0, in = 0;
+        for (; i + 16 <= count && in + kBlockBytes + 16 <= src_bytes; i += 16, in += 2 * kBlockBytes) {
+            __m128i lo = _mm_srli_epi16(block<Bits>(src + in), Bits - 8);
+            __m128i hi = _mm_srli_epi16(block<Bits>(src + in + kBlockBytes), Bits - 8);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_packus_epi16(lo, hi));
+        }
+        return i;
+    }
+} // namespace
+
+size_t vert::unpack_detail::unpack16_sse41(const uint8_t *src, size_t src_bytes, uint16_t *dst, size_t count, int bits)
+{
+    return bits == 10 ? unpack16<10>(src, src_bytes, dst, count) : unpack16<12>(src, src_bytes, dst, count);
+}
+
+size_t vert::unpack_detail::unpack8_sse41(const uint8_t *src, size_t src_bytes, uint8_t *dst, size_t count, int bits)
+{
+    return bits == 10 ? unpack8<10>(src, src_bytes, dst, count) : unpack8<12>(src, src_bytes, dst, count);
+}
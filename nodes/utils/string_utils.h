@@ -4,6 +4,7 @@
 #include <string>
 #include <string_view>
 #include <algorithm>
+#include <vector>
 
 namespace vert
 {
@@ -13,6 +14,17 @@ namespace vert
             [](unsigned char c){ return std::tolower(c); });
         return result;
     }
+
+    template <typename T>
+    std::string join(const std::vector<T> &items, std::string_view sep) {
+        std::string result;
+        for (size_t i = 0; i < items.size(); ++i) {
+            if (i > 0)
+                result += sep;
+            result += std::to_string(items[i]);
+        }
+        return result;
+    }
 } // namespace vert
 
 
@@ -0,0 +1,23 @@
+#ifndef _THREAD_UTILS_H_
+#define _THREAD_UTILS_H_
+
+#include <string>
+#include <vector>
+#include <yaml-cpp/yaml.h>
+
+namespace vert
+{
+    // Pins the calling thread to the given logical cpus, empty means no restriction
+    bool set_current_thread_affinity(const std::vector<int> &cpus);
+
+    // Best effort, shows up in debuggers / top -H. Linux truncates to 15 chars.
+    void set_current_thread_name(const std::string &name);
+
+    unsigned int hardware_concurrency();
+
+    // Accepts a single cpu (`cpu_affinity: 3`) or a list (`cpu_affinity: [2, 3]`)
+    std::vector<int> cpus_from_yaml(const YAML::Node &node);
+
+} // namespace vert
+
+#endif /* _THREAD_UTILS_H_ */
@@ -2,12 +2,49 @@
 #define _TIMER_H_
 
 #include <string>
+#include <string_view>
 #include <chrono>
+#include <atomic>
 #include <iostream>
 #include "logging.h"
 
 namespace vert
 {
+// Frame latency accumulator, safe to feed from several worker threads
+class LatencyStats
+{
+public:
+    void add(int64_t ns) {
+        if (ns < 0)
+            return;
+        count_.fetch_add(1, std::memory_order_relaxed);
+        sum_ns_.fetch_add(ns, std::memory_order_relaxed);
+        int64_t prev = max_ns_.load(std::memory_order_relaxed);
+        while (ns > prev && !max_ns_.compare_exchange_weak(prev, ns, std::memory_order_relaxed)) {
+        }
+    }
+
+    void reset() {
+        count_ = 0;
+        sum_ns_ = 0;
+        max_ns_ = 0;
+    }
+
+    size_t count() const { return count_.load(); }
+    double mean_ms() const { return count_ > 0 ? sum_ns_.load() / 1e6 / count_.load() : 0.0; }
+    double max_ms() const { return max_ns_.load() / 1e6; }
+
+    void report(std::string_view name, std::string_view what = "latency") const {
+        if (count_ > 0)
+            vert::logger->info("{} {} over {} frames: mean {:.3f} ms, max {:.3f} ms", name, what, count(), mean_ms(), max_ms());
+    }
+
+private:
+    std::atomic<size_t> count_{0};
+    std::atomic<int64_t> sum_ns_{0};
+    std::atomic<int64_t> max_ns_{0};
+};
+
 #ifdef VERT_DISABLE_TIMING
 class SimpleTimer
 {
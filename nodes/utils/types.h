@@ -38,6 +38,25 @@ namespace vert
             _pack(device_id, id, height, width, cv_type, cn, timestamp, error_cnt);
         }
     };
+
+    // UI preview channel with preview.encoding jpeg / png: MatMeta plus how the image part is encoded.
+    // height / width / cv_type describe the decoded image.
+    struct PreviewMeta {
+        std::string device_id;
+        int64_t id;
+        uint32_t height;
+        uint32_t width;
+        int cv_type;
+        uint8_t cn;
+        uint64_t timestamp;
+        size_t error_cnt;
+        std::string encoding; // raw, jpeg, png
+      
+        template<class T>
+        void pack(T &_pack) {
+            _pack(device_id, id, height, width, cv_type, cn, timestamp, error_cnt, encoding);
+        }
+    };
 } 
 // namespace name
 
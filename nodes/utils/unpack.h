@@ -0,0 +1,42 @@
+#ifndef _UNPACK_H_
+#define _UNPACK_H_
+
+#include <cstddef>
+#include <cstdint>
+#include "cpu_features.h"
+
+namespace vert
+{
+    // GenICam PFNC "p" formats (Mono10p, Mono12p, BayerRG12p, ...): samples of `bits` bits packed LSB first
+    // into one continuous bit stream, 4 samples in 5 bytes for 10 bit, 2 samples in 3 bytes for 12 bit.
+    // Not the legacy GigE "Mono12Packed" layout.
+
+    // bytes holding `count` samples
+    inline size_t packed_size(size_t count, int bits) { return (count * bits + 7) / 8; }
+
+    // 10 or 12
+    inline bool is_supported_packed_bits(int bits) { return bits == 10 || bits == 12; }
+
+    // samples keep their range, 0 .. 2^bits - 1
+    void unpack_to_16(const uint8_t *src, uint16_t *dst, size_t count, int bits, SimdLevel level = SimdLevel::Best);
+
+    // top 8 of the `bits` bits (linear tone map)
+    void unpack_to_8(const uint8_t *src, uint8_t *dst, size_t count, int bits, SimdLevel level = SimdLevel::Best);
+
+    // tone mapped through a 2^bits entry lut
+    void unpack_to_8_lut(const uint8_t *src, uint8_t *dst, size_t count, int bits, const uint8_t *lut, SimdLevel level = SimdLevel::Best);
+
+    // Whole image of `height` rows, `padding_x` bytes after each packed row. Without padding the rows form one
+    // bit stream (any width), with padding every row has to end on a byte. False if that fails or `src_size`
+    // is short. `lut` may be nullptr for the linear tone map.
+    bool unpack_image_to_16(const uint8_t *src, size_t src_size, int width, int height, size_t padding_x, int bits,
+                            uint16_t *dst, size_t dst_stride, SimdLevel level = SimdLevel::Best);
+    bool unpack_image_to_8(const uint8_t *src, size_t src_size, int width, int height, size_t padding_x, int bits,
+                           uint8_t *dst, size_t dst_stride, const uint8_t *lut = nullptr, SimdLevel level = SimdLevel::Best);
+
+    // Level unpack_* actually runs for `wanted` on this cpu / build
+    SimdLevel unpack_simd_level(SimdLevel wanted = SimdLevel::Best);
+
+} // namespace vert
+
+#endif /* _UNPACK_H_ */
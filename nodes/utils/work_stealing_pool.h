@@ -0,0 +1,134 @@
+#ifndef _WORK_STEALING_POOL_H_
+#define _WORK_STEALING_POOL_H_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "mpmc_queue.h"
+
+namespace vert
+{
+    // Hands work from producers to a fixed set of workers without a hop through zmq.
+    //
+    // Every worker has its own bounded lock-free queue. submit() deals items round-robin, a worker takes from
+    // its own queue first and steals from the others' when it runs dry, so a worker stuck on a slow item does
+    // not hold back the ones queued behind it. Stealing is just another MpmcQueue::try_pop, lock free.
+    // Idle workers spin briefly, then sleep on a condition variable; submit() only takes the lock when one sleeps.
+    //
+    // The pool owns no threads: the caller runs worker w as `while (pool.pop(w, item)) ...`.
+    template <typename T>
+    class WorkStealingPool
+    {
+    public:
+        // capacity: items queued per worker, rounded up to a power of two
+        WorkStealingPool(int num_workers, size_t capacity)
+        {
+            for (int i = 0; i < (num_workers > 0 ? num_workers : 1); ++i)
+                queues_.push_back(std::make_unique<MpmcQueue<T>>(capacity));
+        }
+
+        WorkStealingPool(const WorkStealingPool &) = delete;
+        WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+
+        int num_workers() const { return static_cast<int>(queues_.size()); }
+
+        // false if every queue is full (or the pool stopped), `item` is left to the caller then
+        bool submit(T &item)
+        {
+            if (stopping_.load(std::memory_order_relaxed))
+                return false;
+            size_t n = queues_.size();
+            size_t first = next_.fetch_add(1, std::memory_order_relaxed);
+            for (size_t i = 0; i < n; ++i) {
+                if (queues_[(first + i) % n]->try_push(std::move(item))) {
+                    pending_.fetch_add(1);
+                    if (sleeping_.load() > 0) {
+                        std::lock_guard<std::mutex> lock(mutex_);
+                        cv_.notify_one();
+                    }
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        // Next item for `worker`: its own queue, then the others'. Waits for one; false once stop()ped.
+        bool pop(int worker, T &item)
+        {
+            for (int spins = 0; !stopping_.load(std::memory_order_relaxed); ++spins) {
+                if (try_pop(worker, item))
+                    return true;
+                if (spins < kSpins) {
+                    std::this_thread::yield();
+                    continue;
+                }
+
+                // announce the sleep before the last look, submit() checks sleeping_ after publishing its item
+                sleeping_.fetch_add(1);
+                if (try_pop(worker, item)) {
+                    sleeping_.fetch_sub(1);
+                    return true;
+                }
+                {
+                    std::unique_lock<std::mutex> lock(mutex_);
+                    cv_.wait(lock, [this] { return pending_.load() > 0 || stopping_.load(); });
+                }
+                sleeping_.fetch_sub(1);
+                spins = 0;
+            }
+            return false;
+        }
+
+        // wakes every worker, pop() returns false from now on; queued items are dropped with the pool
+        void stop()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                stopping_ = true;
+            }
+            cv_.notify_all();
+        }
+
+        uint64_t stolen() const { return stolen_.load(std::memory_order_relaxed); }
+        size_t queued_approx() const
+        {
+            int64_t n = pending_.load(std::memory_order_relaxed);
+            return n > 0 ? static_cast<size_t>(n) : 0;
+        }
+
+    private:
+        static constexpr int kSpins = 64;
+
+        bool try_pop(int worker, T &item)
+        {
+            size_t n = queues_.size();
+            for (size_t i = 0; i < n; ++i) {
+                if (queues_[(worker + i) % n]->try_pop(item)) {
+                    pending_.fetch_sub(1);
+                    if (i > 0)
+                        stolen_.fetch_add(1, std::memory_order_relaxed);
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        std::vector<std::unique_ptr<MpmcQueue<T>>> queues_;
+        std::atomic<size_t> next_{0};
+        std::atomic<int64_t> pending_{0}; // pushed and not popped yet, over all queues
+        std::atomic<int> sleeping_{0};
+        std::atomic<bool> stopping_{false};
+        std::atomic<uint64_t> stolen_{0};
+
+        std::mutex mutex_;
+        std::condition_variable cv_;
+    };
+
+} // namespace vert
+
+#endif /* _WORK_STEALING_POOL_H_ */
@@ -0,0 +1,40 @@
+#ifndef _ZMQ_UTILS_H_
+#define _ZMQ_UTILS_H_
+
+#include <utility>
+#include <type_traits>
+#include "../third_party/zmq.hpp"
+#include "../third_party/msgpack.hpp"
+#include "frame_header.h"
+
+namespace vert
+{
+    // Build a zero-copy message over `data`. `owner` is moved to the heap and
+    // destroyed by zmq when the last reference to the message is dropped,
+    // so whatever it holds (grab result, cv::Mat, ...) keeps `data` alive.
+    template<typename Owner>
+    zmq::message_t make_owned_message(void *data, size_t size, Owner &&owner) {
+        using OwnerT = std::decay_t<Owner>;
+        auto *holder = new OwnerT(std::forward<Owner>(owner));
+        return zmq::message_t(data, size,
+                              [](void *, void *hint) { delete static_cast<OwnerT *>(hint); },
+                              holder);
+    }
+
+    inline zmq::message_t make_grab_meta_msg(const FrameHeader &header, MetaEncoding encoding) {
+        if (encoding == MetaEncoding::Binary)
+            return zmq::message_t(&header, sizeof(header));
+        auto meta_data = msgpack::pack(to_grab_meta(header));
+        return zmq::message_t(meta_data.data(), meta_data.size());
+    }
+
+    inline zmq::message_t make_mat_meta_msg(const FrameHeader &header, MetaEncoding encoding) {
+        if (encoding == MetaEncoding::Binary)
+            return zmq::message_t(&header, sizeof(header));
+        auto meta_data = msgpack::pack(to_mat_meta(header));
+        return zmq::message_t(meta_data.data(), meta_data.size());
+    }
+
+} // namespace vert
+
+#endif /* _ZMQ_UTILS_H_ */
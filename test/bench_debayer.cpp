@@ -0,0 +1,148 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <vector>
+#include <random>
+#include <thread>
+#include <string>
+#include <cmath>
+#include <algorithm>
+#include <pylon/PylonIncludes.h>
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+#include "../nodes/utils/debayer.h"
+#include "../nodes/utils/downscale.h"
+#include "../nodes/utils/band_pool.h"
+#include "../nodes/utils/photometric.h"
+
+using namespace std;
+using namespace std::chrono;
+
+// BayerRG8 -> BGR8 per frame: native kernels per instruction set and in 2..N row bands, with the UI preview and
+// the photometric correction fused or separate, OpenCV bilinear, pylon converter 1..N threads.
+// usage: bench_debayer [iterations] [max pylon threads]
+template <typename F>
+static double ms_per_frame(int iterations, F &&convert)
+{
+    convert(); // warm up, first touch of the output
+    auto t0 = steady_clock::now();
+    for (int i = 0; i < iterations; i++)
+        convert();
+    return duration<double, std::milli>(steady_clock::now() - t0).count() / iterations;
+}
+
+static void report(const string &what, double ms)
+{
+    cout << "  " << left << setw(22) << what << right << fixed << setprecision(2) << setw(8) << ms << " ms  "
+         << setw(8) << 1000.0 / ms << " fps" << endl;
+}
+
+int main(int argc, char **argv) {
+
+    const int iterations = argc > 1 ? std::stoi(argv[1]) : 50;
+    const int max_threads = argc > 2 ? std::stoi(argv[2]) : static_cast<int>(std::thread::hardware_concurrency());
+
+    const struct { const char *name; int width, height; } sizes[] = {
+        {"5 MP", 2448, 2048},
+        {"20 MP", 5472, 3648},
+    };
+
+    cout << "cpu: " << vert::simd_level_to_string(vert::cpu_simd_level()) << endl;
+
+    Pylon::PylonInitialize();
+    {
+        for (const auto &size : sizes) {
+            cv::Mat src(size.height, size.width, CV_8UC1);
+            cv::randu(src, 0, 256);
+            cv::Mat dst(size.height, size.width, CV_8UC3);
+            cout << size.name << " (" << size.width << " x " << size.height << ")" << endl;
+
+            for (int level = 0; level <= static_cast<int>(vert::cpu_simd_level()); ++level) {
+                auto simd = static_cast<vert::SimdLevel>(level);
+                double ms = ms_per_frame(iterations, [&] {
+                    vert::debayer_bilinear(src.data, src.step, dst.data, dst.step, src.cols, src.rows, vert::BayerPattern::RG, simd);
+                });
+                report(string("native ") + vert::simd_level_to_string(simd), ms);
+            }
+
+            // one frame split into row bands on a persistent pool, what converter.num_bands does
+            for (int bands = 2; bands <= max_threads; bands *= 2) {
+                vert::BandPool pool(bands - 1);
+                double ms = ms_per_frame(iterations, [&] {
+                    pool.run(bands, [&](int band) {
+                        auto [begin, end] = vert::band_rows(band, bands, src.rows);
+                        vert::debayer_bilinear_rows(src.data, src.step, dst.data, dst.step, src.cols, src.rows, vert::BayerPattern::RG, begin, end);
+                    });
+                });
+                report("native " + to_string(bands) + " bands", ms);
+            }
+
+            // full frame plus UI preview: fused pass vs converting and downscaling one after the other
+            cv::Mat preview(size.height / 4, size.width / 4, CV_8UC3);
+            report("native + 1/4 fused", ms_per_frame(iterations, [&] {
+                vert::debayer_bilinear_preview(src.data, src.step, dst.data, dst.step, src.cols, src.rows, vert::BayerPattern::RG, 4,
+                                               preview.data, preview.step);
+            }));
+            report("native + 1/4 separate", ms_per_frame(iterations, [&] {
+                vert::debayer_bilinear(src.data, src.step, dst.data, dst.step, src.cols, src.rows, vert::BayerPattern::RG);
+                vert::box_downscale(dst.data, dst.step, dst.cols, dst.rows, 3, 4, preview.data, preview.step);
+            }));
+
+            // dark / flat / white balance / gamma: fused per 16 rows as the adapter does, one more pass, or the
+            // OpenCV passes it replaces
+            cv::Mat offset(size.height, size.width, CV_16UC3, cv::Scalar::all(4));
+            cv::Mat gain(size.height, size.width, CV_16UC3, cv::Scalar::all(1.2 * (1 << vert::kPhotometricGainBits)));
+            cv::Mat cv_lut(1, 256, CV_8UC3);
+            std::vector<uint8_t> lut(3 * 256);
+            for (int v = 0; v < 256; ++v) {
+                for (int c = 0; c < 3; ++c) {
+                    lut[c * 256 + v] = cv::saturate_cast<uint8_t>(255.0 * std::pow(v / 255.0, 1 / 2.2));
+                    cv_lut.at<cv::Vec3b>(v)[c] = lut[c * 256 + v];
+                }
+            }
+            auto correct = [&](int begin, int end) {
+                vert::photometric_rows_8(dst.data, dst.step, dst.data, dst.step, dst.cols, 3, offset.ptr<uint16_t>(), gain.ptr<uint16_t>(),
+                                         offset.step, lut.data(), begin, end);
+            };
+            report("native + corr fused", ms_per_frame(iterations, [&] {
+                for (int y = 0; y < src.rows; y += 16) {
+                    int y_end = min(src.rows, y + 16);
+                    vert::debayer_bilinear_rows(src.data, src.step, dst.data, dst.step, src.cols, src.rows, vert::BayerPattern::RG, y, y_end);
+                    correct(y, y_end);
+                }
+            }));
+            report("native + corr separate", ms_per_frame(iterations, [&] {
+                vert::debayer_bilinear(src.data, src.step, dst.data, dst.step, src.cols, src.rows, vert::BayerPattern::RG);
+                correct(0, src.rows);
+            }));
+            cv::Mat dark8(size.height, size.width, CV_8UC3, cv::Scalar::all(4));
+            cv::Mat flat_gain(size.height, size.width, CV_32FC3, cv::Scalar::all(1.2));
+            report("native + opencv passes", ms_per_frame(iterations, [&] {
+                vert::debayer_bilinear(src.data, src.step, dst.data, dst.step, src.cols, src.rows, vert::BayerPattern::RG);
+                cv::subtract(dst, dark8, dst);
+                cv::multiply(dst, flat_gain, dst, 1.0, CV_8U);
+                cv::multiply(dst, cv::Scalar(1.1, 1.0, 1.3), dst);
+                cv::LUT(dst, cv_lut, dst);
+            }));
+
+            // GenICam RG is OpenCV's BG, OpenCV names the pattern after the second row
+            double cv_ms = ms_per_frame(iterations, [&] { cv::demosaicing(src, dst, cv::COLOR_BayerBG2BGR); });
+            report("opencv bilinear", cv_ms);
+
+            Pylon::CImageFormatConverter converter;
+            converter.OutputPixelFormat = Pylon::PixelType_BGR8packed;
+            converter.OutputOrientation = Pylon::OutputOrientation_Unchanged;
+            for (int threads = 1; threads <= max_threads; threads *= 2) {
+                converter.MaxNumThreads.TrySetValue(threads);
+                double ms = ms_per_frame(iterations, [&] {
+                    converter.Convert(dst.data, dst.total() * dst.elemSize(), src.data, src.total(),
+                                      Pylon::PixelType_BayerRG8, src.cols, src.rows, 0, Pylon::ImageOrientation_TopDown);
+                });
+                report("pylon " + to_string(threads) + " thread(s)", ms);
+            }
+        }
+    }
+    Pylon::PylonTerminate();
+
+    return 0;
+}
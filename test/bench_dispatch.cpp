@@ -0,0 +1,167 @@
+#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../nodes/third_party/zmq.hpp"
+#include "../nodes/third_party/zmq_addon.hpp"
+#include "../nodes/utils/frame_header.h"
+#include "../nodes/utils/work_stealing_pool.h"
+
+using namespace std;
+
+// ImageProcessor's frame dispatch: zmq push -> inproc -> pull workers (as before) vs vert::WorkStealingPool.
+// Each job is a 2 part frame (header + zero copy payload), workers busy-wait `work_us` per frame.
+// Reports submit -> worker latency and frames/s, once paced (latency) and once flat out (throughput).
+namespace
+{
+    constexpr int kQueued = 16; // frames buffered per worker
+
+    struct Job {
+        zmq::message_t meta;
+        zmq::message_t data;
+        int64_t submit_ns = 0;
+    };
+
+    void busy_wait_us(int us)
+    {
+        int64_t until = vert::steady_now_ns() + us * 1000LL;
+        while (vert::steady_now_ns() < until) {
+        }
+    }
+
+    void report(const string &name, vector<int64_t> &latency_ns, double seconds)
+    {
+        sort(latency_ns.begin(), latency_ns.end());
+        size_t n = latency_ns.size();
+        auto at = [&](double q) { return n ? latency_ns[min(n - 1, static_cast<size_t>(q * n))] / 1000.0 : 0.0; };
+        double mean = 0;
+        for (auto v : latency_ns)
+            mean += v;
+        mean = n ? mean / n / 1000.0 : 0.0;
+        cout << name << ": " << n << " frames, " << n / seconds << " frames/s, dispatch us mean " << mean << " p50 "
+             << at(0.5) << " p99 " << at(0.99) << " max " << at(1.0) << endl;
+    }
+
+    // period_us 0: as fast as the workers take them
+    void run_zmq(zmq::context_t &ctx, int workers, int frames, int work_us, int period_us, const string &name)
+    {
+        static uint8_t payload[4096];
+        zmq::socket_t push(ctx, zmq::socket_type::push);
+        push.set(zmq::sockopt::sndhwm, kQueued); // as much buffering as the pool has
+        push.bind("inproc://bench_worker");
+
+        vector<vector<int64_t>> latency(workers);
+        atomic<int> done{0};
+        atomic<int64_t> end_ns{0};
+        vector<thread> threads;
+        for (int w = 0; w < workers; ++w) {
+            threads.emplace_back([&, w] {
+                zmq::socket_t pull(ctx, zmq::socket_type::pull);
+                pull.connect("inproc://bench_worker");
+                pull.set(zmq::sockopt::rcvtimeo, 100);
+                pull.set(zmq::sockopt::rcvhwm, kQueued);
+                while (done.load() < frames) {
+                    vector<zmq::message_t> msgs;
+                    if (!zmq::recv_multipart(pull, std::back_inserter(msgs)))
+                        continue;
+                    vert::FrameHeader header;
+                    std::memcpy(&header, msgs[0].data(), sizeof(header));
+                    latency[w].push_back(vert::steady_now_ns() - header.grab_ns);
+                    busy_wait_us(work_us);
+                    if (++done == frames)
+                        end_ns = vert::steady_now_ns();
+                }
+            });
+        }
+
+        int64_t begin_ns = vert::steady_now_ns();
+        for (int i = 0; i < frames; ++i) {
+            vert::FrameHeader header;
+            header.id = i;
+            header.grab_ns = vert::steady_now_ns();
+            push.send(zmq::message_t(&header, sizeof(header)), zmq::send_flags::sndmore);
+            push.send(zmq::message_t(payload, sizeof(payload), nullptr, nullptr), zmq::send_flags::none);
+            if (period_us > 0)
+                busy_wait_us(period_us);
+        }
+        for (auto &t : threads)
+            t.join();
+        double seconds = (end_ns - begin_ns) / 1e9;
+        push.close();
+
+        vector<int64_t> all;
+        for (auto &l : latency)
+            all.insert(all.end(), l.begin(), l.end());
+        report(name, all, seconds);
+    }
+
+    void run_pool(int workers, int frames, int work_us, int period_us, const string &name)
+    {
+        static uint8_t payload[4096];
+        vert::WorkStealingPool<Job> pool(workers, kQueued);
+
+        vector<vector<int64_t>> latency(workers);
+        atomic<int> done{0};
+        atomic<int64_t> end_ns{0};
+        vector<thread> threads;
+        for (int w = 0; w < workers; ++w) {
+            threads.emplace_back([&, w] {
+                Job job;
+                while (pool.pop(w, job)) {
+                    latency[w].push_back(vert::steady_now_ns() - job.submit_ns);
+                    busy_wait_us(work_us);
+                    if (++done == frames)
+                        end_ns = vert::steady_now_ns();
+                }
+            });
+        }
+
+        int64_t begin_ns = vert::steady_now_ns();
+        for (int i = 0; i < frames; ++i) {
+            vert::FrameHeader header;
+            header.id = i;
+            Job job;
+            job.meta = zmq::message_t(&header, sizeof(header));
+            job.data = zmq::message_t(payload, sizeof(payload), nullptr, nullptr);
+            job.submit_ns = vert::steady_now_ns();
+            while (!pool.submit(job)) // back-pressure, like a full zmq pipe
+                std::this_thread::yield();
+            if (period_us > 0)
+                busy_wait_us(period_us);
+        }
+        while (done.load() < frames)
+            std::this_thread::yield();
+        pool.stop();
+        for (auto &t : threads)
+            t.join();
+        double seconds = (end_ns - begin_ns) / 1e9;
+
+        vector<int64_t> all;
+        for (auto &l : latency)
+            all.insert(all.end(), l.begin(), l.end());
+        report(name, all, seconds);
+    }
+} // namespace
+
+// bench_dispatch [frames] [workers] [work_us]
+int main(int argc, char **argv) {
+
+    const int frames = argc > 1 ? std::stoi(argv[1]) : 20000;
+    const int workers = argc > 2 ? std::stoi(argv[2]) : 5;
+    const int work_us = argc > 3 ? std::stoi(argv[3]) : 200;
+    // paced a little below what the workers can take: dispatch latency, not queueing
+    const int period_us = work_us / workers + work_us / (4 * workers) + 1;
+
+    cout << frames << " frames, " << workers << " workers, " << work_us << " us work per frame" << endl;
+
+    zmq::context_t ctx(1);
+    run_zmq(ctx, workers, frames, work_us, period_us, "zmq fan-out, paced ");
+    run_pool(workers, frames, work_us, period_us, "work stealing, paced");
+    run_zmq(ctx, workers, frames, work_us, 0, "zmq fan-out, flat   ");
+    run_pool(workers, frames, work_us, 0, "work stealing, flat ");
+
+    return 0;
+}
@@ -0,0 +1,68 @@
+#include <iostream>
+#include <chrono>
+#include <vector>
+#include <cstring>
+#include "../nodes/third_party/msgpack.hpp"
+#include "../nodes/utils/types.h"
+#include "../nodes/utils/frame_header.h"
+
+using namespace std;
+using namespace std::chrono;
+
+// Per frame cost of the meta encodings: encode on the sender, decode on one receiver
+int main(int argc, char **argv) {
+
+    const size_t iterations = argc > 1 ? std::stoul(argv[1]) : 1000000;
+
+    uint64_t checksum = 0; // keep the optimizer honest
+
+    // msgpack GrabMeta (compat mode)
+    auto t0 = steady_clock::now();
+    for (size_t i = 0; i < iterations; i++) {
+        vert::GrabMeta meta{"cam#0", (int64_t)i, 4096, 5120, 0x01080009, i * 1000, 0, 0, 4096 * 5120};
+        auto data = msgpack::pack(meta);
+        auto decoded = msgpack::unpack<vert::GrabMeta>(data.data(), data.size());
+        checksum += decoded.id + decoded.device_id.size();
+    }
+    auto t1 = steady_clock::now();
+
+    // binary FrameHeader
+    uint16_t device = vert::intern_device("cam#0");
+    alignas(vert::FrameHeader) uint8_t wire[sizeof(vert::FrameHeader)];
+    for (size_t i = 0; i < iterations; i++) {
+        vert::FrameHeader header;
+        header.device = device;
+        header.id = (int64_t)i;
+        header.height = 4096;
+        header.width = 5120;
+        header.pixel_type = 0x01080009;
+        header.timestamp = i * 1000;
+        header.buffer_size = 4096 * 5120;
+        std::memcpy(wire, &header, sizeof(header)); // what zmq::message_t does
+
+        vert::FrameHeader decoded;
+        vert::decode_grab_meta(wire, sizeof(wire), decoded);
+        checksum += decoded.id + vert::device_name(decoded.device).size();
+    }
+    auto t2 = steady_clock::now();
+
+    // binary FrameHeader, read in place
+    for (size_t i = 0; i < iterations; i++) {
+        reinterpret_cast<vert::FrameHeader *>(wire)->id = (int64_t)i;
+        const vert::FrameHeader *header = vert::peek_frame_header(wire, sizeof(wire));
+        checksum += header->id;
+    }
+    auto t3 = steady_clock::now();
+
+    auto per_frame = [iterations](auto d) {
+        return duration<double, std::nano>(d).count() / iterations;
+    };
+
+    cout << "iterations:        " << iterations << endl;
+    cout << "msgpack GrabMeta:  " << per_frame(t1 - t0) << " ns/frame" << endl;
+    cout << "binary header:     " << per_frame(t2 - t1) << " ns/frame" << endl;
+    cout << "binary in place:   " << per_frame(t3 - t2) << " ns/frame" << endl;
+    cout << "checksum:          " << checksum << endl;
+
+    return 0;
+}
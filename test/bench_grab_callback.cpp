@@ -0,0 +1,103 @@
+#include <iostream>
+#include <chrono>
+#include <thread>
+#include <string>
+#include <pylon/PylonIncludes.h>
+#include <spdlog/spdlog.h>
+#include <spdlog/sinks/stdout_color_sinks.h>
+#include "../nodes/third_party/zmq_addon.hpp"
+#include "../nodes/third_party/fmt/format.h"
+#include "basler_emulator.h"
+
+using namespace std;
+using namespace std::chrono;
+
+// Per frame cost of the grab callback on a pylon camera emulator.
+// Needs PYLON_CAMEMU=1 (or more) in the environment.
+// usage: bench_grab_callback <image folder for camemu> [frames] [fps]
+int main(int argc, char **argv) {
+
+    if (argc < 2) {
+        cout << "usage: bench_grab_callback <image folder> [frames] [fps]" << endl;
+        return 1;
+    }
+    const string file_path = argv[1];
+    const int frames = argc > 2 ? std::stoi(argv[2]) : 2000;
+    const double fps = argc > 3 ? std::stod(argv[3]) : 1000.0;
+
+    vert::logger = spdlog::stdout_color_mt("bench");
+    vert::logger->set_level(spdlog::level::info);
+
+    Pylon::PylonInitialize();
+    {
+        // 1. what the callback used to do per frame: GenApi node read + formatted debug line
+        Pylon::CDeviceInfo di;
+        di.SetDeviceClass(Pylon::BaslerCamEmuDeviceClass);
+        Pylon::CBaslerUniversalInstantCamera camera(Pylon::CTlFactory::GetInstance().CreateFirstDevice(di));
+        camera.Open();
+
+        const int iterations = 10000;
+        size_t checksum = 0;
+
+        auto t0 = steady_clock::now();
+        for (int i = 0; i < iterations; i++) {
+            std::string user_id = camera.DeviceUserID.GetValue().c_str();
+            checksum += fmt::format("Grab from Device: '{}' ID: {} Type: {}", user_id, i,
+                                    vert::pixel_type_to_string(Pylon::PixelType_BayerRG8)).size();
+        }
+        auto t1 = steady_clock::now();
+
+        const std::string cached_user_id = camera.DeviceUserID.GetValue().c_str();
+        for (int i = 0; i < iterations; i++) {
+            checksum += cached_user_id.size() + (vert::logger->should_log(spdlog::level::debug) ? 1 : 0);
+        }
+        auto t2 = steady_clock::now();
+        camera.Close();
+
+        cout << "node read + log format: " << duration<double, std::nano>(t1 - t0).count() / iterations << " ns/frame" << endl;
+        cout << "cached + level check:   " << duration<double, std::nano>(t2 - t1).count() / iterations << " ns/frame" << endl;
+        cout << "checksum:               " << checksum << endl;
+    }
+
+    {
+        // 2. the real callback, camemu -> BaslerEmulator -> inproc consumer
+        zmq::context_t context(1);
+        zmq::socket_t consumer(context, zmq::socket_type::pull);
+        consumer.bind("inproc://bench");
+        consumer.set(zmq::sockopt::rcvtimeo, 1000);
+
+        YAML::Node config;
+        config["name"] = "BenchEmulator";
+        config["port"] = "inproc://bench";
+        config["user_id"] = "bench#0";
+        config["file_path"] = file_path;
+        config["fps"] = fps;
+        config["max_images"] = frames;
+        config["zero_copy"] = true;
+        config["num_buffers"] = 16;
+        config["clock_sync_period"] = 0;
+
+        vert::BaslerEmulator emulator(&context);
+        if (!emulator.init(config))
+            return 1;
+
+        emulator.start();
+        int received = 0;
+        vector<zmq::message_t> msgs;
+        while (received < frames) {
+            msgs.clear();
+            if (!zmq::recv_multipart(consumer, std::back_inserter(msgs)))
+                break;
+            received++;
+        }
+        emulator.stop();
+
+        const auto &stats = emulator.callback_stats();
+        cout << "frames:                 " << received << endl;
+        cout << "callback mean:          " << stats.mean_ms() * 1000.0 << " us" << endl;
+        cout << "callback max:           " << stats.max_ms() * 1000.0 << " us" << endl;
+    }
+    Pylon::PylonTerminate();
+
+    return 0;
+}
@@ -0,0 +1,83 @@
+#include <iostream>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <opencv2/imgproc.hpp>
+#include <spdlog/sinks/stdout_color_sinks.h>
+#include "../nodes/image_processor/stage_chain.h"
+#include "../nodes/utils/band_pool.h"
+#include "../nodes/utils/logging.h"
+#include "../nodes/utils/thread_utils.h"
+
+using namespace std;
+using namespace std::chrono;
+
+// Latency of one large frame through test_process: whole frame on one worker vs split into tiles on a band pool.
+// bench_tiles [width] [height] [frames] [tiles...]
+int main(int argc, char **argv) {
+
+    vert::logger = spdlog::stdout_color_mt("bench");
+
+    const int width = argc > 1 ? std::stoi(argv[1]) : 5120;
+    const int height = argc > 2 ? std::stoi(argv[2]) : 5120; // 25 MP
+    const int frames = argc > 3 ? std::stoi(argv[3]) : 10;
+    vector<int> tile_counts;
+    for (int i = 4; i < argc; ++i)
+        tile_counts.push_back(std::stoi(argv[i]));
+    if (tile_counts.empty())
+        tile_counts = {1, 2, 4, 8, static_cast<int>(vert::hardware_concurrency())};
+
+    // saturated blobs on noise, so the masks have something to keep
+    cv::Mat bgr(height, width, CV_8UC3);
+    cv::randu(bgr, 0, 256);
+    for (int i = 0; i < 400; ++i) {
+        cv::Rect blob((i * 7919) % width, (i * 104729) % height, 60 + i % 200, 40 + i % 150);
+        cv::rectangle(bgr, blob, cv::Scalar(255 * (i % 2), (37 * i) % 256, 255), cv::FILLED);
+    }
+    vert::FrameHeader header;
+    header.width = width;
+    header.height = height;
+    header.cv_type = CV_8UC3;
+    header.cn = 3;
+    header.buffer_size = bgr.total() * bgr.elemSize();
+
+    cout << width << " x " << height << ", " << frames << " frames per mode" << endl;
+    cv::Mat reference;
+    for (int tiles : tile_counts) {
+        vert::BandPool pool(max(0, tiles - 1), "bench");
+        vert::StageChain::Timings timings;
+        vert::StageChain chain;
+        if (!chain.init(YAML::Load("[{type: test_process}]"), "bench", timings))
+            return 1;
+        vert::StageFrame frame;
+        frame.set_tiling(tiles, &pool);
+
+        vector<double> ms;
+        for (int i = 0; i <= frames; ++i) {
+            header.id = i;
+            auto t0 = steady_clock::now();
+            frame.reset(header, bgr.data, header.buffer_size);
+            chain.process(frame);
+            auto t1 = steady_clock::now();
+            if (i > 0) // the first one allocates
+                ms.push_back(duration<double, std::milli>(t1 - t0).count());
+        }
+        sort(ms.begin(), ms.end());
+        double mean = 0;
+        for (double v : ms)
+            mean += v;
+        mean /= ms.size();
+
+        const cv::Mat &dst = *frame.image("dst");
+        if (reference.empty())
+            reference = dst.clone();
+        bool same = cv::norm(dst, reference, cv::NORM_INF) == 0;
+
+        cout << (tiles == 1 ? "frame mode   " : "tiles " + to_string(tiles) + string(tiles < 10 ? "      " : "     "))
+             << " mean " << mean << " ms, min " << ms.front() << " ms, max " << ms.back() << " ms"
+             << (same ? "" : "  OUTPUT DIFFERS") << endl;
+    }
+
+    return 0;
+}
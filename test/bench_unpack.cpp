@@ -0,0 +1,99 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <vector>
+#include <random>
+#include <thread>
+#include <string>
+#include <pylon/PylonIncludes.h>
+#include <opencv2/core.hpp>
+#include "../nodes/utils/unpack.h"
+#include "../nodes/utils/debayer.h"
+
+using namespace std;
+using namespace std::chrono;
+
+// Packed 10 / 12 bit -> 16 bit and 8 bit per frame: native kernels per instruction set vs pylon converter 1..N threads,
+// plus BayerRG12p -> BGR8 (unpack + native debayer vs pylon).
+// usage: bench_unpack [iterations] [max pylon threads]
+template <typename F>
+static double ms_per_frame(int iterations, F &&convert)
+{
+    convert(); // warm up, first touch of the output
+    auto t0 = steady_clock::now();
+    for (int i = 0; i < iterations; i++)
+        convert();
+    return duration<double, std::milli>(steady_clock::now() - t0).count() / iterations;
+}
+
+static void report(const string &what, double ms)
+{
+    cout << "  " << left << setw(26) << what << right << fixed << setprecision(2) << setw(8) << ms << " ms  "
+         << setw(8) << 1000.0 / ms << " fps" << endl;
+}
+
+int main(int argc, char **argv) {
+
+    const int iterations = argc > 1 ? std::stoi(argv[1]) : 50;
+    const int max_threads = argc > 2 ? std::stoi(argv[2]) : static_cast<int>(std::thread::hardware_concurrency());
+    const int width = 2448, height = 2048;
+    const size_t count = static_cast<size_t>(width) * height;
+
+    cout << "cpu: " << vert::simd_level_to_string(vert::cpu_simd_level()) << ", 5 MP (" << width << " x " << height << ")" << endl;
+
+    const struct { Pylon::EPixelType mono, bayer; int bits; } formats[] = {
+        {Pylon::PixelType_Mono10p, Pylon::PixelType_BayerRG10p, 10},
+        {Pylon::PixelType_Mono12p, Pylon::PixelType_BayerRG12p, 12},
+    };
+
+    Pylon::PylonInitialize();
+    {
+        std::mt19937 rng(42);
+        for (const auto &format : formats) {
+            vector<uint8_t> src(vert::packed_size(count, format.bits));
+            for (auto &b : src)
+                b = static_cast<uint8_t>(rng());
+            cv::Mat dst16(height, width, CV_16UC1), dst8(height, width, CV_8UC1), bgr(height, width, CV_8UC3);
+            cout << Pylon::CPixelTypeMapper::GetNameByPixelType(format.mono) << endl;
+
+            for (int level = 0; level <= static_cast<int>(vert::unpack_simd_level()); ++level) {
+                auto simd = static_cast<vert::SimdLevel>(level);
+                report(string("native 16 bit ") + vert::simd_level_to_string(simd), ms_per_frame(iterations, [&] {
+                    vert::unpack_to_16(src.data(), dst16.ptr<uint16_t>(), count, format.bits, simd);
+                }));
+                report(string("native 8 bit ") + vert::simd_level_to_string(simd), ms_per_frame(iterations, [&] {
+                    vert::unpack_to_8(src.data(), dst8.data, count, format.bits, simd);
+                }));
+            }
+            report("native bayer -> bgr8", ms_per_frame(iterations, [&] {
+                vert::unpack_to_8(src.data(), dst8.data, count, format.bits);
+                vert::debayer_bilinear(dst8.data, dst8.step, bgr.data, bgr.step, width, height, vert::BayerPattern::RG);
+            }));
+
+            Pylon::CImageFormatConverter converter;
+            converter.OutputOrientation = Pylon::OutputOrientation_Unchanged;
+            for (int threads = 1; threads <= max_threads; threads *= 2) {
+                converter.MaxNumThreads.TrySetValue(threads);
+                string suffix = " " + to_string(threads) + " thread(s)";
+                converter.OutputPixelFormat = Pylon::PixelType_Mono16;
+                report("pylon 16 bit" + suffix, ms_per_frame(iterations, [&] {
+                    converter.Convert(dst16.data, dst16.total() * dst16.elemSize(), src.data(), src.size(),
+                                      format.mono, width, height, 0, Pylon::ImageOrientation_TopDown);
+                }));
+                converter.OutputPixelFormat = Pylon::PixelType_Mono8;
+                report("pylon 8 bit" + suffix, ms_per_frame(iterations, [&] {
+                    converter.Convert(dst8.data, dst8.total(), src.data(), src.size(),
+                                      format.mono, width, height, 0, Pylon::ImageOrientation_TopDown);
+                }));
+                converter.OutputPixelFormat = Pylon::PixelType_BGR8packed;
+                report("pylon bayer -> bgr8" + suffix, ms_per_frame(iterations, [&] {
+                    converter.Convert(bgr.data, bgr.total() * bgr.elemSize(), src.data(), src.size(),
+                                      format.bayer, width, height, 0, Pylon::ImageOrientation_TopDown);
+                }));
+            }
+        }
+    }
+    Pylon::PylonTerminate();
+
+    return 0;
+}
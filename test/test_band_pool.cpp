@@ -0,0 +1,64 @@
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include "../nodes/utils/band_pool.h"
+
+using namespace std;
+
+// Every band of every caller runs exactly once, with several callers sharing the helpers
+int main(int argc, char **argv) {
+
+    const int callers = 4;
+    const int rounds = argc > 1 ? std::stoi(argv[1]) : 2000;
+    const int num_bands = 7;
+
+    for (int height : {1, 2, 9, 64, 2048}) {
+        for (int align : {2, 8}) {
+            int expected_begin = 0;
+            for (int band = 0; band < num_bands; ++band) {
+                auto [begin, end] = vert::band_rows(band, num_bands, height, align);
+                if (begin != expected_begin || end < begin || (end != height && end % align != 0)) {
+                    cout << "FAILED: band_rows " << band << " of " << height << " rows = [" << begin << ", " << end << ")" << endl;
+                    return 1;
+                }
+                expected_begin = end;
+            }
+            if (expected_begin != height) {
+                cout << "FAILED: band_rows cover " << expected_begin << " of " << height << " rows" << endl;
+                return 1;
+            }
+        }
+    }
+
+    vert::BandPool pool(3, "test");
+    vector<vector<atomic<int>>> runs(callers);
+    for (auto &r : runs)
+        r = vector<atomic<int>>(rounds * num_bands);
+
+    vector<thread> threads;
+    atomic<bool> failed{false};
+    for (int c = 0; c < callers; ++c) {
+        threads.emplace_back([&, c] {
+            for (int round = 0; round < rounds; ++round) {
+                pool.run(num_bands, [&](int band) { runs[c][round * num_bands + band]++; });
+                // everything of this round must be done once run() returns
+                for (int band = 0; band < num_bands; ++band)
+                    if (runs[c][round * num_bands + band] != 1)
+                        failed = true;
+            }
+        });
+    }
+    for (auto &t : threads)
+        t.join();
+
+    if (failed) {
+        cout << "FAILED: run() returned before all of its bands ran exactly once" << endl;
+        return 1;
+    }
+
+    cout << callers << " callers x " << rounds << " rounds x " << num_bands << " bands" << endl;
+
+    cout << "Test Finish" << endl;
+    return 0;
+}
@@ -0,0 +1,113 @@
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <cstring>
+#include "../nodes/utils/buffer_pool.h"
+
+using namespace std;
+
+// A slot is recycled only after every message over it is released, an exhausted pool says so instead of
+// handing out a live slot, and the pool outlives its owner while messages are in flight
+int main(int argc, char **argv) {
+
+    const int rounds = argc > 1 ? std::stoi(argv[1]) : 200000;
+    const size_t size = 4096;
+
+    {
+        auto pool = vert::BufferPool::create(2, size);
+        int a = pool->acquire();
+        int b = pool->acquire();
+        if (a < 0 || b < 0 || a == b || pool->acquire() != -1) {
+            cout << "FAILED: acquire from a pool of 2" << endl;
+            return 1;
+        }
+
+        // meta + image over slot a, like CameraAdapter with a binary header
+        std::memset(pool->data(a), 0xAA, size);
+        pool->publish(a, 2);
+        zmq::message_t meta = pool->make_message(a, pool->data(a), 128);
+        zmq::message_t image = pool->make_message(a, pool->data(a) + 128, size - 128);
+        std::memset(pool->data(b), 0xBB, size);
+        pool->publish(b, 1);
+        zmq::message_t other = pool->make_message(b, pool->data(b), size);
+
+        zmq::message_t subscriber;
+        subscriber.copy(image); // a second subscriber shares the image, zmq refcounts it
+        image = zmq::message_t();
+        meta = zmq::message_t();
+        if (pool->acquire() != -1) {
+            cout << "FAILED: slot recycled while a subscriber still holds its image" << endl;
+            return 1;
+        }
+        subscriber = zmq::message_t();
+        int again = pool->acquire();
+        if (again != a || pool->acquire() != -1) {
+            cout << "FAILED: slot " << a << " not recycled after its last message, got " << again << endl;
+            return 1;
+        }
+        for (size_t i = 0; i < size; ++i) {
+            if (static_cast<uint8_t *>(other.data())[i] != 0xBB) {
+                cout << "FAILED: live slot " << b << " overwritten" << endl;
+                return 1;
+            }
+        }
+
+        pool->give_back(again);
+        if (pool->available() != 1) {
+            cout << "FAILED: give_back, " << pool->available() << " available" << endl;
+            return 1;
+        }
+
+        // the owner goes first, the last message deletes the pool (leaks / use after free show under ASan)
+        pool.reset();
+        if (static_cast<uint8_t *>(other.data())[size - 1] != 0xBB) {
+            cout << "FAILED: frame changed after the owner dropped the pool" << endl;
+            return 1;
+        }
+    }
+
+    // messages are released on other threads (zmq io threads in the nodes), a slot must never be handed
+    // out twice while live
+    auto pool = vert::BufferPool::create(3, size); // fewer slots than threads, acquire runs dry now and then
+    vector<atomic<int>> live(pool->num_buffers());
+    atomic<int> exhausted{0};
+    atomic<bool> failed{false};
+    vector<thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&] {
+            for (int i = 0; i < rounds && !failed; ++i) {
+                int slot = pool->acquire();
+                if (slot < 0) {
+                    exhausted++;
+                    continue;
+                }
+                if (live[slot].exchange(1) != 0) {
+                    failed = true;
+                    break;
+                }
+                pool->publish(slot, 2);
+                zmq::message_t meta = pool->make_message(slot, pool->data(slot), 64);
+                zmq::message_t image = pool->make_message(slot, pool->data(slot) + 64, size - 64);
+                meta = zmq::message_t(); // the slot is still held by image
+                live[slot] = 0;          // before the last release, the slot may be reacquired right after
+                image = zmq::message_t();
+            }
+        });
+    }
+    for (auto &t : threads)
+        t.join();
+
+    if (failed) {
+        cout << "FAILED: a slot was handed out while still held" << endl;
+        return 1;
+    }
+    if (pool->available() != pool->num_buffers()) {
+        cout << "FAILED: " << pool->available() << " of " << pool->num_buffers() << " slots back" << endl;
+        return 1;
+    }
+    cout << exhausted.load() << " acquires found the pool exhausted" << endl;
+
+    cout << "Test Finish" << endl;
+    return 0;
+}
@@ -0,0 +1,146 @@
+#include <iostream>
+#include <vector>
+#include <random>
+#include <cstring>
+#include <algorithm>
+#include "../nodes/utils/debayer.h"
+#include "../nodes/utils/downscale.h"
+#include "../nodes/utils/band_pool.h"
+
+using namespace std;
+
+static const vert::BayerPattern kPatterns[] = {vert::BayerPattern::RG, vert::BayerPattern::GR, vert::BayerPattern::BG, vert::BayerPattern::GB};
+static const char *kPatternNames[] = {"RG", "GR", "BG", "GB"};
+
+// mosaic of a flat color, GenICam pattern semantics
+static vector<uint8_t> flat_mosaic(int width, int height, vert::BayerPattern pattern, uint8_t b, uint8_t g, uint8_t r)
+{
+    // color at (0, 0), (1, 0), (0, 1), (1, 1)
+    uint8_t cell[4];
+    switch (pattern) {
+    case vert::BayerPattern::RG: cell[0] = r; cell[1] = g; cell[2] = g; cell[3] = b; break;
+    case vert::BayerPattern::GR: cell[0] = g; cell[1] = r; cell[2] = b; cell[3] = g; break;
+    case vert::BayerPattern::BG: cell[0] = b; cell[1] = g; cell[2] = g; cell[3] = r; break;
+    case vert::BayerPattern::GB: cell[0] = g; cell[1] = b; cell[2] = r; cell[3] = g; break;
+    }
+    vector<uint8_t> img(static_cast<size_t>(width) * height);
+    for (int y = 0; y < height; ++y)
+        for (int x = 0; x < width; ++x)
+            img[y * width + x] = cell[(y & 1) * 2 + (x & 1)];
+    return img;
+}
+
+// Every vector level must match the scalar reference bit for bit, including borders and row tails
+int main(int argc, char **argv) {
+
+    const int rounds = argc > 1 ? std::stoi(argv[1]) : 200;
+    vert::SimdLevel best = vert::debayer_simd_level();
+    cout << "cpu: " << vert::simd_level_to_string(best) << endl;
+
+    // a flat color has to come back unchanged everywhere
+    for (int p = 0; p < 4; ++p) {
+        const int width = 37, height = 9;
+        auto src = flat_mosaic(width, height, kPatterns[p], 50, 100, 200);
+        vector<uint8_t> dst(static_cast<size_t>(width) * height * 3);
+        vert::debayer_bilinear(src.data(), width, dst.data(), width * 3, width, height, kPatterns[p], vert::SimdLevel::Scalar);
+        for (size_t i = 0; i < dst.size(); i += 3) {
+            if (dst[i] != 50 || dst[i + 1] != 100 || dst[i + 2] != 200) {
+                cout << "FAILED: flat " << kPatternNames[p] << " pixel " << i / 3 << " = "
+                     << (int)dst[i] << "," << (int)dst[i + 1] << "," << (int)dst[i + 2] << endl;
+                return 1;
+            }
+        }
+    }
+
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> dim(2, 300);
+    std::uniform_int_distribution<int> byte(0, 255);
+    std::uniform_int_distribution<int> pad(0, 7);
+
+    size_t compared = 0;
+    for (int round = 0; round < rounds; ++round) {
+        int width = dim(rng), height = dim(rng) / 8 + 2;
+        size_t src_stride = width + pad(rng), dst_stride = width * 3 + pad(rng);
+        vert::BayerPattern pattern = kPatterns[round % 4];
+
+        vector<uint8_t> src(src_stride * height);
+        for (auto &v : src)
+            v = static_cast<uint8_t>(byte(rng));
+
+        vector<uint8_t> ref(dst_stride * height, 0);
+        vert::debayer_bilinear(src.data(), src_stride, ref.data(), dst_stride, width, height, pattern, vert::SimdLevel::Scalar);
+
+        for (int level = 1; level <= static_cast<int>(best); ++level) {
+            vector<uint8_t> out(dst_stride * height, 0);
+            vert::debayer_bilinear(src.data(), src_stride, out.data(), dst_stride, width, height, pattern, static_cast<vert::SimdLevel>(level));
+            for (int y = 0; y < height; ++y) {
+                if (std::memcmp(ref.data() + y * dst_stride, out.data() + y * dst_stride, width * 3) != 0) {
+                    cout << "FAILED: " << vert::simd_level_to_string(static_cast<vert::SimdLevel>(level)) << " " << kPatternNames[round % 4]
+                         << " " << width << "x" << height << " differs from scalar in row " << y << endl;
+                    return 1;
+                }
+            }
+            compared++;
+        }
+
+        // row bands put together give the whole image
+        vector<uint8_t> bands(dst_stride * height, 0);
+        int mid = height / 2;
+        vert::debayer_bilinear_rows(src.data(), src_stride, bands.data(), dst_stride, width, height, pattern, 0, mid);
+        vert::debayer_bilinear_rows(src.data(), src_stride, bands.data(), dst_stride, width, height, pattern, mid, height);
+        for (int y = 0; y < height; ++y) {
+            if (std::memcmp(ref.data() + y * dst_stride, bands.data() + y * dst_stride, width * 3) != 0) {
+                cout << "FAILED: row bands " << width << "x" << height << " differ in row " << y << endl;
+                return 1;
+            }
+        }
+
+        // fused preview: same full frame, preview equal to downscaling it afterwards
+        for (int factor : {2, 4, 8}) {
+            int pw = vert::downscaled_size(width, factor), ph = vert::downscaled_size(height, factor);
+            vector<uint8_t> full(dst_stride * height, 0), preview(static_cast<size_t>(pw) * ph * 3 + 1, 0), expected(preview.size(), 0);
+            vert::debayer_bilinear_preview(src.data(), src_stride, full.data(), dst_stride, width, height, pattern, factor, preview.data(), pw * 3);
+            vert::box_downscale(ref.data(), dst_stride, width, height, 3, factor, expected.data(), pw * 3);
+            bool same = preview == expected;
+            for (int y = 0; y < height && same; ++y)
+                same = std::memcmp(ref.data() + y * dst_stride, full.data() + y * dst_stride, width * 3) == 0;
+            if (!same) {
+                cout << "FAILED: fused preview 1/" << factor << " " << width << "x" << height << endl;
+                return 1;
+            }
+
+            // the same in row bands on whole preview rows, as the adapter runs it
+            std::fill(full.begin(), full.end(), 0);
+            std::fill(preview.begin(), preview.end(), 0);
+            for (int band = 0; band < 3; ++band) {
+                auto [begin, end] = vert::band_rows(band, 3, height, factor);
+                vert::debayer_bilinear_preview_rows(src.data(), src_stride, full.data(), dst_stride, width, height, pattern, factor,
+                                                    preview.data(), pw * 3, begin, end);
+            }
+            same = preview == expected;
+            for (int y = 0; y < height && same; ++y)
+                same = std::memcmp(ref.data() + y * dst_stride, full.data() + y * dst_stride, width * 3) == 0;
+            if (!same) {
+                cout << "FAILED: banded preview 1/" << factor << " " << width << "x" << height << endl;
+                return 1;
+            }
+        }
+    }
+
+    {
+        // 2x2 blocks of 0, 1, 2, 4 -> 7 / 4 rounds to 2
+        const uint8_t src[8] = {0, 1, 10, 10,
+                                2, 4, 10, 10};
+        uint8_t dst[2] = {};
+        vert::box_downscale(src, 4, 4, 2, 1, 2, dst, 2);
+        if (dst[0] != 2 || dst[1] != 10) {
+            cout << "FAILED: box_downscale " << (int)dst[0] << " " << (int)dst[1] << endl;
+            return 1;
+        }
+    }
+
+    cout << compared << " vector conversions match scalar" << endl;
+
+    cout << "Test Finish" << endl;
+    return 0;
+}
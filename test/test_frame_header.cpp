@@ -0,0 +1,71 @@
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include "../nodes/utils/frame_header.h"
+#include "../nodes/utils/zmq_utils.h"
+#include "../nodes/utils/types.h"
+
+using namespace std;
+
+#define CHECK(cond)                                                   \
+    do {                                                              \
+        if (!(cond)) {                                                \
+            cout << "FAILED: " #cond " (line " << __LINE__ << ")" << endl; \
+            return 1;                                                 \
+        }                                                             \
+    } while (0)
+
+// MatMeta as existing consumers (UI, recorders) pack and unpack it, 8 fields
+struct LegacyMatMeta {
+    std::string device_id;
+    int64_t id;
+    uint32_t height;
+    uint32_t width;
+    int cv_type;
+    uint8_t cn;
+    uint64_t timestamp;
+    size_t error_cnt;
+
+    template<class T>
+    void pack(T &_pack) {
+        _pack(device_id, id, height, width, cv_type, cn, timestamp, error_cnt);
+    }
+};
+
+// The msgpack MatMeta keeps its wire layout both ways, bit_depth only travels in the binary header
+int main(int argc, char **argv) {
+
+    const int cv_16uc1 = 2; // CV_16UC1, no OpenCV needed here
+
+    // old publisher -> this tree
+    LegacyMatMeta legacy{"cam0", 42, 480, 640, cv_16uc1, 1, 1234567890123ull, 3};
+    auto legacy_data = msgpack::pack(legacy);
+    vert::FrameHeader header;
+    CHECK(vert::decode_mat_meta(legacy_data.data(), legacy_data.size(), header));
+    CHECK(vert::device_name(header.device) == "cam0");
+    CHECK(header.id == 42 && header.height == 480 && header.width == 640);
+    CHECK(header.cv_type == cv_16uc1 && header.cn == 1);
+    CHECK(header.timestamp == 1234567890123ull && header.error_cnt == 3);
+    CHECK(header.bit_depth == 8);
+
+    // this tree -> old consumer, byte for byte what it used to get
+    header.bit_depth = 12;
+    zmq::message_t msg = vert::make_mat_meta_msg(header, vert::MetaEncoding::Msgpack);
+    CHECK(msg.size() == legacy_data.size());
+    CHECK(std::equal(legacy_data.begin(), legacy_data.end(), static_cast<const uint8_t *>(msg.data())));
+    std::error_code ec;
+    auto decoded = msgpack::unpack<LegacyMatMeta>(static_cast<const uint8_t *>(msg.data()), msg.size(), ec);
+    CHECK(!ec);
+    CHECK(decoded.device_id == "cam0" && decoded.id == 42 && decoded.error_cnt == 3);
+
+    // in process the binary header keeps bit_depth
+    zmq::message_t binary = vert::make_mat_meta_msg(header, vert::MetaEncoding::Binary);
+    vert::FrameHeader out;
+    CHECK(vert::decode_mat_meta(binary.data(), binary.size(), out));
+    CHECK(out.bit_depth == 12 && out.id == 42 && out.cv_type == cv_16uc1);
+
+    cout << "MatMeta " << legacy_data.size() << " bytes, FrameHeader " << sizeof(vert::FrameHeader) << " bytes" << endl;
+
+    cout << "Test Finish" << endl;
+    return 0;
+}
@@ -0,0 +1,121 @@
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <memory>
+#include <cstring>
+#include "../nodes/utils/in_flight.h"
+#include "../nodes/utils/zmq_utils.h"
+
+using namespace std;
+
+// Lends its device memory to zmq like BaslerBase does with grab buffers: close() frees the device
+// only once every lent frame is released
+class Producer {
+public:
+    explicit Producer(size_t size) : device_(new uint8_t[size]), size_(size) {
+        std::memset(device_.get(), 0x5A, size_);
+    }
+    ~Producer() { close(); }
+
+    zmq::message_t lend() {
+        return vert::make_owned_message(device_.get(), size_, vert::InFlightToken(in_flight_));
+    }
+
+    void close() {
+        while (!in_flight_->wait_idle(std::chrono::milliseconds(1000)))
+            cout << in_flight_->count() << " frames still in flight on close" << endl;
+        device_.reset();
+    }
+
+    bool closed() const { return device_ == nullptr; }
+    vert::InFlightCounter::Ptr counter() const { return in_flight_; }
+
+private:
+    std::unique_ptr<uint8_t[]> device_;
+    size_t size_;
+    vert::InFlightCounter::Ptr in_flight_ = vert::InFlightCounter::create();
+};
+
+// A frame held across close keeps the device open until it is released, and the count it was lent
+// under stays valid even when its producer is gone (use after free shows under ASan)
+int main(int argc, char **argv) {
+
+    const int rounds = argc > 1 ? std::stoi(argv[1]) : 100000;
+    const size_t size = 4096;
+
+    {
+        auto producer = std::make_unique<Producer>(size);
+        zmq::message_t frame = producer->lend();
+        zmq::message_t subscriber;
+        subscriber.copy(frame); // a second subscriber shares it, zmq refcounts the owner
+        frame = zmq::message_t();
+
+        atomic<bool> closed{false};
+        thread closer([&] {
+            producer->close();
+            closed = true;
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        if (closed) {
+            cout << "FAILED: close returned while a frame was held" << endl;
+            return 1;
+        }
+        if (static_cast<uint8_t *>(subscriber.data())[size - 1] != 0x5A) {
+            cout << "FAILED: frame changed while held across close" << endl;
+            return 1;
+        }
+        subscriber = zmq::message_t();
+        closer.join();
+        if (!producer->closed() || producer->counter()->count() != 0) {
+            cout << "FAILED: close did not finish after the last frame was released" << endl;
+            return 1;
+        }
+    }
+
+    {
+        // the frame outlives its producer and the producer's own reference to the count
+        zmq::message_t frame;
+        std::weak_ptr<vert::InFlightCounter> counter;
+        {
+            vert::InFlightCounter::Ptr in_flight = vert::InFlightCounter::create();
+            counter = in_flight;
+            static const uint8_t pixels[16] = {};
+            frame = vert::make_owned_message(const_cast<uint8_t *>(pixels), sizeof(pixels), vert::InFlightToken(in_flight));
+        }
+        if (counter.expired() || counter.lock()->count() != 1) {
+            cout << "FAILED: the count did not stay with its frame" << endl;
+            return 1;
+        }
+        frame = zmq::message_t();
+        if (!counter.expired()) {
+            cout << "FAILED: the count outlived its last frame" << endl;
+            return 1;
+        }
+    }
+
+    // frames are released on other threads (zmq io threads in the nodes)
+    Producer producer(size);
+    vector<thread> threads;
+    atomic<size_t> peak{0};
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&] {
+            for (int i = 0; i < rounds; ++i) {
+                zmq::message_t frame = producer.lend();
+                size_t count = producer.counter()->count();
+                size_t seen = peak.load();
+                while (count > seen && !peak.compare_exchange_weak(seen, count)) {}
+            }
+        });
+    }
+    for (auto &t : threads)
+        t.join();
+    if (producer.counter()->count() != 0 || !producer.counter()->wait_idle(std::chrono::milliseconds(0))) {
+        cout << "FAILED: " << producer.counter()->count() << " frames counted after all were released" << endl;
+        return 1;
+    }
+    cout << "at most " << peak.load() << " frames in flight" << endl;
+
+    cout << "Test Finish" << endl;
+    return 0;
+}
@@ -0,0 +1,73 @@
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <numeric>
+#include "../nodes/utils/mpmc_queue.h"
+
+using namespace std;
+
+// Every pushed value must be popped exactly once, whatever the interleaving
+int main(int argc, char **argv) {
+
+    const int producers = 4;
+    const int consumers = 4;
+    const int per_producer = argc > 1 ? std::stoi(argv[1]) : 1000000;
+
+    vert::MpmcQueue<int> queue(1024);
+
+    {
+        vert::MpmcQueue<int> small(3);
+        int v = 0;
+        bool ok = small.capacity() == 4 && !small.try_pop(v);
+        for (int i = 0; i < 4; i++)
+            ok = ok && small.try_push(i);
+        ok = ok && !small.try_push(4);
+        for (int i = 0; i < 4; i++)
+            ok = ok && small.try_pop(v) && v == i;
+        if (!ok) {
+            cout << "FAILED: single thread fifo / full / empty" << endl;
+            return 1;
+        }
+    }
+
+    vector<atomic<int>> seen(producers * per_producer);
+    for (auto &s : seen)
+        s = 0;
+    atomic<int> popped{0};
+
+    vector<thread> threads;
+    for (int p = 0; p < producers; p++) {
+        threads.emplace_back([&, p] {
+            for (int i = 0; i < per_producer; i++) {
+                while (!queue.try_push(p * per_producer + i))
+                    this_thread::yield();
+            }
+        });
+    }
+    for (int c = 0; c < consumers; c++) {
+        threads.emplace_back([&] {
+            int v;
+            while (popped.load() < producers * per_producer) {
+                if (queue.try_pop(v)) {
+                    seen[v]++;
+                    popped++;
+                } else {
+                    this_thread::yield();
+                }
+            }
+        });
+    }
+    for (auto &t : threads)
+        t.join();
+
+    for (size_t i = 0; i < seen.size(); i++) {
+        if (seen[i] != 1) {
+            cout << "FAILED: value " << i << " popped " << seen[i] << " times" << endl;
+            return 1;
+        }
+    }
+
+    cout << "Test Finish" << endl;
+    return 0;
+}
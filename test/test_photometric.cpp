@@ -0,0 +1,116 @@
+#include <iostream>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include "../nodes/utils/photometric.h"
+
+using namespace std;
+
+// the documented formula, written out independently of the kernels
+static uint16_t reference(uint32_t v, const uint16_t *offset, const uint16_t *gain, size_t i, int bits)
+{
+    uint32_t max_value = (1u << bits) - 1;
+    v = min(v, max_value);
+    if (!offset)
+        return static_cast<uint16_t>(v);
+    double t = v > offset[i] ? v - offset[i] : 0;
+    double r = (t + 0.5) * gain[i] / (1 << vert::kPhotometricGainBits);
+    return static_cast<uint16_t>(min<double>(static_cast<uint32_t>(r), max_value));
+}
+
+// Every level must match the formula for any length, channel count, depth and map / lut combination,
+// and unity gain without an offset must give back the input
+int main(int argc, char **argv) {
+
+    const int rounds = argc > 1 ? std::stoi(argv[1]) : 400;
+    vert::SimdLevel best = vert::photometric_simd_level();
+    cout << "cpu: " << vert::simd_level_to_string(best) << endl;
+
+    vector<vert::SimdLevel> levels = {vert::SimdLevel::Scalar};
+    for (vert::SimdLevel l : {vert::SimdLevel::SSE41, vert::SimdLevel::AVX2})
+        if (vert::photometric_simd_level(l) == l)
+            levels.push_back(l);
+
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int> len(0, 4000);
+    std::uniform_int_distribution<int> gain_value(0, 4 << vert::kPhotometricGainBits);
+
+    size_t compared = 0;
+    for (int round = 0; round < rounds; ++round) {
+        const int bits_choice[] = {8, 10, 12};
+        int bits = bits_choice[round % 3];
+        int channels = round / 3 % 2 ? 3 : 1;
+        bool with_maps = round / 6 % 2 == 0;
+        bool with_lut = round / 12 % 2 == 0;
+        size_t count = len(rng) / channels * channels;
+        size_t table = size_t(1) << bits;
+
+        // a few samples above 2^bits - 1 in the 16 bit case, they must be clamped
+        std::uniform_int_distribution<int> value(0, bits == 8 ? 255 : (1 << bits) + 16);
+        std::uniform_int_distribution<int> dark(0, (1 << bits) / 16);
+        vector<uint16_t> src(count), offset(count), gain(count);
+        for (size_t i = 0; i < count; ++i) {
+            src[i] = static_cast<uint16_t>(value(rng));
+            offset[i] = static_cast<uint16_t>(dark(rng));
+            gain[i] = static_cast<uint16_t>(gain_value(rng));
+        }
+        vector<uint16_t> lut(channels * table);
+        for (size_t i = 0; i < lut.size(); ++i)
+            lut[i] = static_cast<uint16_t>((i * 7 + i / table * 13) % table);
+        vector<uint8_t> src8(src.begin(), src.end()), lut8(lut.begin(), lut.end());
+
+        const uint16_t *o = with_maps ? offset.data() : nullptr;
+        const uint16_t *g = with_maps ? gain.data() : nullptr;
+        for (vert::SimdLevel level : levels) {
+            vector<uint16_t> out16(count + 1, 0xbeef);
+            vector<uint8_t> out8(count + 1, 0xa5);
+            if (bits == 8) {
+                vert::photometric_row_8(src8.data(), out8.data(), count, channels, o, g, with_lut ? lut8.data() : nullptr, level);
+            } else {
+                vert::photometric_row_16(src.data(), out16.data(), count, channels, bits, o, g, with_lut ? lut.data() : nullptr, level);
+            }
+            for (size_t i = 0; i <= count; ++i) {
+                uint16_t got = bits == 8 ? out8[i] : out16[i];
+                uint16_t want = bits == 8 ? 0xa5 : 0xbeef;  // nothing written past the row
+                if (i < count) {
+                    uint16_t t = reference(bits == 8 ? src8[i] : src[i], o, g, i, bits);
+                    want = with_lut ? lut[(i % channels) * table + t] : t;
+                    if (!with_maps && !with_lut)
+                        want = bits == 8 ? src8[i] : src[i];  // a plain copy
+                    if (bits == 8)
+                        want &= 0xff;
+                }
+                if (got != want) {
+                    cout << "FAILED: " << vert::simd_level_to_string(level) << " " << bits << " bit, " << channels << " channels, count " << count
+                         << (with_maps ? ", maps" : "") << (with_lut ? ", lut" : "") << ", sample " << i << " got " << got << " want " << want << endl;
+                    return 1;
+                }
+            }
+            compared += count;
+        }
+    }
+
+    // unity gain, no dark, no lut: in place over a strided image leaves it as it was
+    {
+        const int width = 333, height = 7, channels = 3;
+        const size_t stride = width * channels + 21;
+        vector<uint8_t> img(stride * height);
+        for (auto &v : img)
+            v = static_cast<uint8_t>(rng());
+        vector<uint8_t> before = img;
+        vector<uint16_t> zero(width * channels * height, 0), unity(width * channels * height, 1 << vert::kPhotometricGainBits);
+        for (vert::SimdLevel level : levels) {
+            vert::photometric_rows_8(img.data(), stride, img.data(), stride, width, channels, zero.data(), unity.data(),
+                                     width * channels * sizeof(uint16_t), nullptr, 0, height, level);
+            if (img != before) {
+                cout << "FAILED: " << vert::simd_level_to_string(level) << " unity gain changed the image" << endl;
+                return 1;
+            }
+        }
+    }
+
+    cout << compared << " samples" << endl;
+
+    cout << "Test Finish" << endl;
+    return 0;
+}
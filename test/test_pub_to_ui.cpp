@@ -7,8 +7,16 @@
 #include "../nodes/third_party/msgpack.hpp"
 #include "../nodes/utils/types.h"
 
+// Publishes what CameraAdapter sends on port.to_ui: `test_pub_to_ui` or `test_pub_to_ui raw` gives
+// msgpack MatMeta + pixels, `test_pub_to_ui jpeg|png` gives msgpack PreviewMeta + the encoded image
 int main(int argc, char **argv) {
     
+    std::string encoding = argc > 1 ? argv[1] : "raw";
+    if (encoding != "raw" && encoding != "jpeg" && encoding != "png") {
+        std::cerr << "unknown encoding " << encoding << ", use raw, jpeg or png" << std::endl;
+        return 1;
+    }
+
     zmq::context_t context(1);
     zmq::socket_t publisher;
 
@@ -25,18 +33,28 @@ int main(int argc, char **argv) {
     }
 
     cv::Mat image;
+    std::vector<uchar> encoded;
     for (size_t i = 0; i < 9999; i++) {
 
         image.create(1024, 1024, CV_8UC3);
         cv::randn(image, cv::Scalar(128, 128, 128), cv::Scalar(128, 128, 128));
-        vert::MatMeta meta{"cam", (int64_t)i, 1024, 1024, CV_8UC3, 3, 0};
-        
-        auto meta_data = msgpack::pack(meta);
+
+        std::vector<uint8_t> meta_data;
+        zmq::message_t img_msg;
+        if (encoding == "raw") {
+            vert::MatMeta meta{"cam", (int64_t)i, 1024, 1024, CV_8UC3, 3, 0};
+            meta_data = msgpack::pack(meta);
+            img_msg.rebuild(image.data ,image.total() * image.elemSize());
+        } else {
+            // height / width / cv_type describe the decoded image
+            vert::PreviewMeta meta{"cam", (int64_t)i, 1024, 1024, CV_8UC3, 3, 0, 0, encoding};
+            meta_data = msgpack::pack(meta);
+            cv::imencode(encoding == "jpeg" ? ".jpg" : ".png", image, encoded);
+            img_msg.rebuild(encoded.data(), encoded.size());
+        }
+
         zmq::message_t meta_msg(meta_data.data(), meta_data.size());
         publisher.send(meta_msg, zmq::send_flags::sndmore);
-        
-        zmq::message_t img_msg;
-        img_msg.rebuild(image.data ,image.total() * image.elemSize());
         publisher.send(img_msg, zmq::send_flags::dontwait);
         
         std::cout << "send image " << i << std::endl;
@@ -0,0 +1,136 @@
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include "../nodes/utils/reorder_buffer.h"
+
+using namespace std;
+
+#define CHECK(cond) \
+    if (!(cond)) { cout << "FAILED: " #cond " (line " << __LINE__ << ")" << endl; return 1; }
+
+// In order release per device, gaps skipped by window and by max wait, late drops, restarts, shuffled completion
+int main(int argc, char **argv) {
+
+    const int64_t ms = 1'000'000;
+    vector<int64_t> out;
+    auto emit = [&](int64_t &&v) { out.push_back(v); };
+
+    // out of order within the window: held until the gap fills
+    {
+        vert::ReorderBuffer<int64_t> buffer(8, 100 * ms);
+        out.clear();
+        CHECK(buffer.push(0, 10, 10, 0, emit));
+        CHECK(buffer.push(0, 12, 12, 0, emit));
+        CHECK(buffer.push(0, 13, 13, 0, emit));
+        CHECK(out == vector<int64_t>({10}) && buffer.held() == 2);
+        CHECK(buffer.push(0, 11, 11, 0, emit));
+        CHECK(out == vector<int64_t>({10, 11, 12, 13}) && buffer.held() == 0);
+        CHECK(buffer.next_deadline_ns() == numeric_limits<int64_t>::max());
+
+        // devices are independent
+        CHECK(buffer.push(1, 0, 100, 0, emit));
+        CHECK(buffer.push(0, 15, 15, 0, emit));
+        CHECK(buffer.push(1, 1, 101, 0, emit));
+        CHECK(out.back() == 101 && buffer.held() == 1);
+    }
+
+    // a gap wider than the window is skipped, the id behind it arrives late
+    {
+        vert::ReorderBuffer<int64_t> buffer(4, 100 * ms);
+        out.clear();
+        CHECK(buffer.push(0, 0, 0, 0, emit));
+        CHECK(buffer.push(0, 2, 2, 0, emit));
+        CHECK(buffer.push(0, 3, 3, 0, emit));
+        CHECK(buffer.push(0, 4, 4, 0, emit));
+        CHECK(out == vector<int64_t>({0}));
+        CHECK(buffer.push(0, 5, 5, 0, emit)); // 1 missing, 5 - 1 >= window
+        CHECK(out == vector<int64_t>({0, 2, 3, 4, 5}) && buffer.skipped() == 1);
+        CHECK(!buffer.push(0, 1, 1, 0, emit) && buffer.late() == 1);
+        CHECK(!buffer.push(0, 5, 5, 0, emit) && buffer.late() == 2);
+
+        // a jump with nothing held moves on directly
+        CHECK(buffer.push(0, 1000, 1000, 0, emit));
+        CHECK(out.back() == 1000 && buffer.skipped() == 1 + 994);
+
+        // far behind: the camera restarted its numbering
+        CHECK(buffer.push(0, 0, 0, 0, emit));
+        CHECK(out.back() == 0 && buffer.restarts() == 1);
+    }
+
+    // restarting close to the old ids: late ids that were released already mean a restart, stragglers do not
+    {
+        vert::ReorderBuffer<int64_t> buffer(32, 100 * ms);
+        out.clear();
+        for (int64_t id = 0; id < 100; ++id) {
+            if (id < 50 || id > 56)
+                CHECK(buffer.push(0, id, id, 0, emit));
+        }
+        CHECK(buffer.skipped() == 7 && out.back() == 99);
+        // stragglers of the skipped ids, even a burst of them counting up, are late
+        for (int64_t id = 50; id <= 56; ++id)
+            CHECK(!buffer.push(0, id, id, 0, emit));
+        CHECK(buffer.push(0, 100, 100, 0, emit));
+        CHECK(buffer.late() == 7 && buffer.restarts() == 0 && out.back() == 100);
+
+        // a single repeated id is late too
+        CHECK(!buffer.push(0, 98, 98, 0, emit));
+        CHECK(buffer.push(0, 101, 101, 0, emit));
+        CHECK(buffer.late() == 8 && buffer.restarts() == 0);
+
+        // the camera starts over at 0, 101 ids back (within kRestartWindows windows)
+        const int64_t first = vert::ReorderBuffer<int64_t>::kRestartLateRun - 1;
+        for (int64_t id = 0; id < first; ++id)
+            CHECK(!buffer.push(0, id, id, 0, emit));
+        CHECK(buffer.push(0, first, first, 0, emit));
+        CHECK(buffer.restarts() == 1 && out.back() == first);
+        CHECK(buffer.push(0, first + 2, first + 2, 0, emit));
+        CHECK(buffer.push(0, first + 1, first + 1, 0, emit));
+        CHECK(out.back() == first + 2 && buffer.held() == 0 && buffer.late() == 8 + static_cast<uint64_t>(first));
+    }
+
+    // the wait for a gap ends after max_wait
+    {
+        vert::ReorderBuffer<int64_t> buffer(16, 10 * ms);
+        out.clear();
+        CHECK(buffer.push(0, 0, 0, 0, emit));
+        CHECK(buffer.push(0, 2, 2, 1 * ms, emit));
+        CHECK(buffer.push(0, 3, 3, 5 * ms, emit));
+        CHECK(buffer.next_deadline_ns() == 11 * ms);
+        buffer.flush_expired(10 * ms, emit);
+        CHECK(out.size() == 1);
+        buffer.flush_expired(11 * ms, emit);
+        CHECK(out == vector<int64_t>({0, 2, 3}) && buffer.skipped() == 1 && buffer.held() == 0);
+
+        CHECK(buffer.push(0, 5, 5, 20 * ms, emit));
+        buffer.flush_all(emit);
+        CHECK(out.back() == 5 && buffer.skipped() == 2);
+    }
+
+    // workers finishing in random order, nothing lost: release order is id order
+    {
+        const int rounds = argc > 1 ? std::stoi(argv[1]) : 20000;
+        const int workers = 5;
+        vert::ReorderBuffer<int64_t> buffer(32, 100 * ms);
+        out.clear();
+        mt19937 rng(7);
+        CHECK(buffer.push(3, 0, 0, 0, emit)); // where the device starts
+        vector<int64_t> in_flight;
+        int64_t next_id = 1;
+        while (next_id <= rounds || !in_flight.empty()) {
+            while (next_id <= rounds && static_cast<int>(in_flight.size()) < workers)
+                in_flight.push_back(next_id++);
+            // any of them, but none stays in flight for half a window
+            size_t done = in_flight.front() < next_id - 16 ? 0 : rng() % in_flight.size();
+            int64_t id = in_flight[done];
+            in_flight.erase(in_flight.begin() + done);
+            CHECK(buffer.push(3, id, id, 0, emit));
+        }
+        CHECK(static_cast<int>(out.size()) == rounds + 1 && is_sorted(out.begin(), out.end()) && out.back() == rounds);
+        CHECK(buffer.late() == 0 && buffer.skipped() == 0);
+    }
+
+    cout << "Test Finish" << endl;
+    return 0;
+}
@@ -0,0 +1,258 @@
+#include <iostream>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <vector>
+#include <string>
+#include <opencv2/imgproc.hpp>
+#include "../nodes/image_processor/stage_chain.h"
+#include <spdlog/sinks/stdout_color_sinks.h>
+#include "../nodes/utils/logging.h"
+#include "../nodes/utils/cv_utils.h"
+
+using namespace std;
+
+#define CHECK(cond) \
+    if (!(cond)) { cout << "FAILED: " #cond " (line " << __LINE__ << ")" << endl; return 1; }
+
+namespace
+{
+    // Sums the "inverted" image of an earlier stage row by row into its scratch, rejects frames whose id is odd
+    class RowSumStage : public vert::Stage
+    {
+    public:
+        bool init(const YAML::Node &params) override
+        {
+            reject_odd_ = params && params["reject_odd"] && params["reject_odd"].as<bool>();
+            return true;
+        }
+
+        std::vector<vert::ScratchSpec> scratch(const cv::Size &frame_size, int) const override
+        {
+            return {{cv::Size(1, frame_size.height), CV_64FC1}};
+        }
+
+        bool process(vert::StageFrame &frame, std::vector<cv::Mat> &scratch) override
+        {
+            const cv::Mat *inverted = frame.image("inverted");
+            if (!inverted || scratch.size() != 1 || scratch[0].rows != inverted->rows)
+                return false;
+            seen_scratch.push_back(scratch[0].data);
+            for (int y = 0; y < inverted->rows; ++y)
+                scratch[0].at<double>(y) = cv::sum(inverted->row(y))[0];
+
+            vert::StageResult result;
+            result.label = "sum";
+            result.value = cv::sum(scratch[0])[0];
+            frame.add_result(std::move(result));
+            return !reject_odd_ || frame.header().id % 2 == 0;
+        }
+
+        static std::vector<uchar *> seen_scratch;
+
+    private:
+        bool reject_odd_ = false;
+    };
+
+    std::vector<uchar *> RowSumStage::seen_scratch;
+
+    // Allocates a Mat in every tile, wherever the tile runs
+    class TileAllocStage : public vert::Stage
+    {
+    public:
+        bool init(const YAML::Node &) override
+        {
+            tile_fn_ = [](int) { cv::Mat m(8, 8, CV_8UC1); };
+            return true;
+        }
+
+        bool process(vert::StageFrame &frame, std::vector<cv::Mat> &) override
+        {
+            frame.run_tiles(tile_fn_);
+            return true;
+        }
+
+    private:
+        std::function<void(int)> tile_fn_;
+    };
+
+    vert::FrameHeader gray_header(int64_t id, int width, int height)
+    {
+        vert::FrameHeader meta;
+        meta.id = id;
+        meta.width = width;
+        meta.height = height;
+        meta.cv_type = CV_8UC1;
+        meta.cn = 1;
+        meta.buffer_size = static_cast<uint64_t>(width) * height;
+        return meta;
+    }
+} // namespace
+
+// Registry, plugin loading, chain order, per frame images / results, scratch reuse, early exit and tiling
+int main(int argc, char **argv) {
+
+    vert::logger = spdlog::stdout_color_mt("test");
+
+    auto &registry = vert::StageRegistry::instance();
+    CHECK(registry.create("test_process") != nullptr);
+    CHECK(registry.create("no_such_stage") == nullptr);
+    CHECK(registry.add("row_sum", vert::make_stage_factory<RowSumStage>()));
+    CHECK(!registry.add("row_sum", vert::make_stage_factory<RowSumStage>()));
+
+    string error;
+    CHECK(!registry.load("no_such_library", error) && !error.empty());
+    const string plugin = argc > 1 ? argv[1] : TEST_STAGE_PLUGIN_PATH;
+    if (!registry.load(plugin, error)) {
+        cout << "FAILED: cannot load " << plugin << ": " << error << endl;
+        return 1;
+    }
+    CHECK(registry.load(plugin, error)); // loaded once
+    CHECK(registry.create("plugin_invert") != nullptr);
+
+    // unknown types and bad lists fail init
+    vert::StageChain::Timings timings;
+    vert::StageChain bad;
+    CHECK(!bad.init(YAML::Load("[{type: no_such_stage}]"), "test", timings));
+    CHECK(!bad.init(YAML::Load("[]"), "test", timings));
+    timings.clear();
+
+    YAML::Node config = YAML::Load(R"(
+        - type: plugin_invert
+          name: invert
+        - type: row_sum
+          params: {reject_odd: true}
+        - type: test_process
+          params: {iterations: 1}
+    )");
+    vert::StageChain chain_a, chain_b;
+    CHECK(chain_a.init(config, "test", timings));
+    CHECK(chain_b.init(config, "test", timings));
+    CHECK(timings.size() == 3 && timings[0]->name == "invert" && timings[1]->name == "row_sum" && timings[2]->name == "test_process");
+
+    const int width = 64, height = 48;
+    vert::StageFrame frame;
+    for (int64_t id = 0; id < 6; ++id) {
+        int w = id < 4 ? width : width * 2, h = id < 4 ? height : height * 2; // size change at id 4
+        vector<uint8_t> pixels(static_cast<size_t>(w) * h, static_cast<uint8_t>(10 * id));
+        frame.reset(gray_header(id, w, h), pixels.data(), pixels.size());
+        vert::StageChain &chain = id % 3 == 2 ? chain_b : chain_a;
+        bool passed = chain.process(frame);
+
+        CHECK(passed == (id % 2 == 0));
+        CHECK(frame.image("inverted") && frame.image("inverted")->at<uint8_t>(0, 0) == 255 - 10 * id);
+        double sum = static_cast<double>(255 - 10 * id) * w * h;
+        CHECK(frame.results().size() >= 2);
+        CHECK(frame.results()[0].stage == "invert" && frame.results()[0].label == "mean" && frame.results()[0].value == 10 * id);
+        CHECK(frame.results()[1].stage == "row_sum" && frame.results()[1].value == sum);
+        if (passed) {
+            CHECK(frame.num_images() == 2 && frame.image_name(1) == "dst" && frame.image("dst")->size() == cv::Size(w, h));
+            CHECK(frame.results().size() == 3 && frame.results()[2].stage == "test_process");
+        } else {
+            CHECK(frame.num_images() == 1 && frame.image("dst") == nullptr && frame.results().size() == 2);
+        }
+    }
+
+    // chain_a saw ids 0, 1, 3 at one size and 4 at the next: same scratch until the size changed
+    auto &seen = RowSumStage::seen_scratch;
+    CHECK(seen.size() == 6);
+    CHECK(seen[0] == seen[1] && seen[1] == seen[3]);
+    CHECK(timings[0]->time.count() == 6 && timings[1]->time.count() == 6 && timings[2]->time.count() == 3);
+
+    // steady state: no Mat allocated per frame, with the last outputs still held elsewhere (published)
+    vert::install_mat_alloc_counter();
+    vert::StageChain::Timings timings_c;
+    vert::StageChain chain_c;
+    CHECK(chain_c.init(YAML::Load("[{type: test_process, params: {iterations: 2}}]"), "test", timings_c));
+    vector<uint8_t> pixels(static_cast<size_t>(width) * height, 77);
+    deque<cv::Mat> in_flight;
+    uint64_t allocations = 0;
+    for (int64_t id = 0; id < 40; ++id) {
+        if (id == 20)
+            allocations = vert::mat_allocations_this_thread();
+        frame.reset(gray_header(id, width, height), pixels.data(), pixels.size());
+        CHECK(chain_c.process(frame));
+        in_flight.push_back(*frame.image("dst"));
+        if (in_flight.size() > 3)
+            in_flight.pop_front();
+        for (size_t i = 0; i + 1 < in_flight.size(); ++i)
+            CHECK(in_flight[i].data != in_flight.back().data); // never written while held
+    }
+    CHECK(vert::mat_allocations_this_thread() == allocations);
+
+    // tiled, the tiles allocate on the band pool's threads: counted per frame through its scope
+    {
+        vert::BandPool pool(3, "test");
+        CHECK(registry.add("tile_alloc", vert::make_stage_factory<TileAllocStage>()));
+        vert::StageChain::Timings alloc_timings;
+        vert::StageChain alloc_chain;
+        CHECK(alloc_chain.init(YAML::Load("[{type: tile_alloc}]"), "test", alloc_timings));
+        vert::StageFrame tiled;
+        tiled.set_tiling(8, &pool);
+        std::atomic<uint64_t> frame_allocations{0};
+        uint64_t total = vert::mat_allocations_total();
+        for (int64_t id = 0; id < 20; ++id) {
+            vert::MatAllocScope scope(&frame_allocations);
+            tiled.reset(gray_header(id, width, height), pixels.data(), pixels.size());
+            CHECK(alloc_chain.process(tiled));
+        }
+        // whichever thread ran a tile, every allocation of the process went to the frames
+        CHECK(frame_allocations.load() >= 20 * 8 && frame_allocations.load() == vert::mat_allocations_total() - total);
+
+        vert::StageChain::Timings tiled_timings;
+        vert::StageChain tiled_chain;
+        CHECK(tiled_chain.init(YAML::Load("[{type: test_process, params: {iterations: 2}}]"), "test", tiled_timings));
+        in_flight.clear();
+        uint64_t steady = 0;
+        for (int64_t id = 0; id < 40; ++id) {
+            if (id == 20)
+                steady = frame_allocations.load();
+            {
+                vert::MatAllocScope scope(&frame_allocations);
+                tiled.reset(gray_header(id, width, height), pixels.data(), pixels.size());
+                CHECK(tiled_chain.process(tiled));
+            }
+            in_flight.push_back(*tiled.image("dst"));
+            if (in_flight.size() > 3)
+                in_flight.pop_front();
+        }
+        CHECK(frame_allocations.load() == steady);
+    }
+
+    // tiled rounds match the whole frame exactly, also with tiles thinner than the halo
+    {
+        const int w = 320, h = 241;
+        cv::Mat bgr(h, w, CV_8UC3);
+        cv::randu(bgr, 0, 256);
+        for (int i = 0; i < 12; ++i)
+            cv::rectangle(bgr, cv::Rect((i * 37) % w, (i * 53) % h, 40, 30), cv::Scalar(255 * (i % 2), (40 * i) % 256, 255), cv::FILLED);
+        vert::FrameHeader header = gray_header(0, w, h);
+        header.cv_type = CV_8UC3;
+        header.cn = 3;
+        header.buffer_size = bgr.total() * bgr.elemSize();
+
+        vert::BandPool pool(3, "test");
+        cv::Mat reference;
+        double reference_share = -1;
+        for (int tiles : {1, 2, 4, 7, 16}) {
+            vert::StageChain::Timings tiled_timings;
+            vert::StageChain tiled_chain;
+            CHECK(tiled_chain.init(YAML::Load("[{type: test_process}]"), "test", tiled_timings));
+            vert::StageFrame tiled;
+            tiled.set_tiling(tiles, &pool);
+            tiled.reset(header, bgr.data, header.buffer_size);
+            CHECK(tiled_chain.process(tiled) && tiled.image("dst") && tiled.results().size() == 1);
+            if (tiles == 1) {
+                reference = tiled.image("dst")->clone();
+                reference_share = tiled.results()[0].value;
+                CHECK(reference_share > 0 && reference_share < 1);
+            } else {
+                CHECK(cv::norm(*tiled.image("dst"), reference, cv::NORM_INF) == 0);
+                CHECK(tiled.results()[0].value == reference_share);
+            }
+        }
+    }
+
+    cout << "Test Finish" << endl;
+    return 0;
+}
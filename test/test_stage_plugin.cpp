@@ -0,0 +1,31 @@
+#include "../nodes/image_processor/stage.h"
+
+// Stage plugin loaded by test_stage_chain at run time, the way an inspection library would be
+
+namespace
+{
+    // "inverted": 255 - gray, result "mean" of the input
+    class InvertStage : public vert::Stage
+    {
+    public:
+        bool process(vert::StageFrame &frame, std::vector<cv::Mat> &) override
+        {
+            const cv::Mat &gray = frame.input().gray();
+            if (gray.empty())
+                return false;
+            cv::Mat &out = frame.output("inverted");
+            cv::bitwise_not(gray, out);
+
+            vert::StageResult result;
+            result.label = "mean";
+            result.value = cv::mean(gray)[0];
+            frame.add_result(std::move(result));
+            return true;
+        }
+    };
+} // namespace
+
+VERT_STAGE_PLUGIN_ENTRY(registry)
+{
+    return registry.add("plugin_invert", vert::make_stage_factory<InvertStage>());
+}
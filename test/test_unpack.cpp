@@ -0,0 +1,104 @@
+#include <iostream>
+#include <vector>
+#include <random>
+#include "../nodes/utils/unpack.h"
+
+using namespace std;
+
+// PFNC "p" packing: sample i occupies bits [i * bits, (i + 1) * bits) of the stream, LSB first
+static vector<uint8_t> pack(const vector<uint16_t> &samples, int bits)
+{
+    vector<uint8_t> out(vert::packed_size(samples.size(), bits), 0);
+    for (size_t i = 0; i < samples.size(); ++i)
+        for (int b = 0; b < bits; ++b)
+            if (samples[i] >> b & 1) {
+                size_t bit = i * bits + b;
+                out[bit >> 3] |= static_cast<uint8_t>(1 << (bit & 7));
+            }
+    return out;
+}
+
+// Unpacking must invert pack() at every level, for every length and both depths
+int main(int argc, char **argv) {
+
+    const int rounds = argc > 1 ? std::stoi(argv[1]) : 500;
+    vert::SimdLevel best = vert::unpack_simd_level();
+    cout << "cpu: " << vert::simd_level_to_string(best) << endl;
+
+    vector<vert::SimdLevel> levels = {vert::SimdLevel::Scalar};
+    for (vert::SimdLevel l : {vert::SimdLevel::SSE41, vert::SimdLevel::AVX2})
+        if (vert::unpack_simd_level(l) == l)
+            levels.push_back(l);
+
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> len(0, 700);
+
+    size_t compared = 0;
+    for (int round = 0; round < rounds; ++round) {
+        int bits = round % 2 ? 12 : 10;
+        size_t count = len(rng);
+        std::uniform_int_distribution<int> value(0, (1 << bits) - 1);
+        vector<uint16_t> samples(count);
+        for (auto &s : samples)
+            s = static_cast<uint16_t>(value(rng));
+        // exact size, no slack after the stream
+        vector<uint8_t> packed = pack(samples, bits);
+
+        vector<uint8_t> lut(size_t(1) << bits);
+        for (size_t v = 0; v < lut.size(); ++v)
+            lut[v] = static_cast<uint8_t>(255 - (v >> (bits - 8)));
+
+        for (vert::SimdLevel level : levels) {
+            vector<uint16_t> out16(count + 1, 0xbeef);
+            vector<uint8_t> out8(count + 1, 0xa5), out_lut(count + 1, 0xa5);
+            vert::unpack_to_16(packed.data(), out16.data(), count, bits, level);
+            vert::unpack_to_8(packed.data(), out8.data(), count, bits, level);
+            vert::unpack_to_8_lut(packed.data(), out_lut.data(), count, bits, lut.data(), level);
+            for (size_t i = 0; i < count; ++i) {
+                if (out16[i] != samples[i] || out8[i] != samples[i] >> (bits - 8) || out_lut[i] != lut[samples[i]]) {
+                    cout << "FAILED: " << vert::simd_level_to_string(level) << " " << bits << " bit, count " << count
+                         << ", sample " << i << " = " << samples[i] << " got " << out16[i] << " / " << (int)out8[i]
+                         << " / " << (int)out_lut[i] << endl;
+                    return 1;
+                }
+            }
+            if (out16[count] != 0xbeef || out8[count] != 0xa5 || out_lut[count] != 0xa5) {
+                cout << "FAILED: " << vert::simd_level_to_string(level) << " wrote past " << count << " samples" << endl;
+                return 1;
+            }
+            compared += count;
+        }
+    }
+
+    // padded rows: each row starts on its own byte
+    for (int bits : {10, 12}) {
+        const int width = 52, height = 7, padding = 3;
+        size_t row_bytes = vert::packed_size(width, bits);
+        vector<uint16_t> row(width);
+        vector<uint8_t> image;
+        vector<uint16_t> expected;
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width; ++x)
+                row[x] = static_cast<uint16_t>((x * 37 + y * 101) & ((1 << bits) - 1));
+            auto packed = pack(row, bits);
+            image.insert(image.end(), packed.begin(), packed.end());
+            image.insert(image.end(), padding, 0xff);
+            expected.insert(expected.end(), row.begin(), row.end());
+        }
+        vector<uint16_t> out(expected.size());
+        bool ok = vert::unpack_image_to_16(image.data(), image.size(), width, height, padding, bits, out.data(), width * 2);
+        if (!ok || out != expected) {
+            cout << "FAILED: padded " << bits << " bit image, " << row_bytes << " bytes per row" << endl;
+            return 1;
+        }
+        if (vert::unpack_image_to_16(image.data(), image.size() - padding - 1, width, height, padding, bits, out.data(), width * 2)) {
+            cout << "FAILED: short " << bits << " bit image accepted" << endl;
+            return 1;
+        }
+    }
+
+    cout << rounds << " rounds, " << compared << " samples match the packed input" << endl;
+
+    cout << "Test Finish" << endl;
+    return 0;
+}
@@ -0,0 +1,75 @@
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include "../nodes/utils/work_stealing_pool.h"
+
+using namespace std;
+
+// Every submitted item is popped exactly once, a slow worker's queue is drained by the others, stop() wakes idle workers
+int main(int argc, char **argv) {
+
+    const int workers = 4;
+    const int items = argc > 1 ? std::stoi(argv[1]) : 200000;
+
+    {
+        vert::WorkStealingPool<int> small(2, 2);
+        int v = 0;
+        bool ok = true;
+        for (int i = 0; i < 4; i++) {
+            v = i;
+            ok = ok && small.submit(v);
+        }
+        v = 4;
+        ok = ok && !small.submit(v) && v == 4; // all full, the item stays with the caller
+        if (!ok) {
+            cout << "FAILED: submit into full queues" << endl;
+            return 1;
+        }
+    }
+
+    vert::WorkStealingPool<int> pool(workers, 64);
+    vector<atomic<int>> seen(items);
+    vector<thread> threads;
+    for (int w = 0; w < workers; ++w) {
+        threads.emplace_back([&, w] {
+            int item = -1;
+            while (pool.pop(w, item)) {
+                seen[item]++;
+                if (w == 0)
+                    this_thread::sleep_for(chrono::microseconds(50)); // the slow one
+            }
+        });
+    }
+
+    for (int i = 0; i < items; ++i) {
+        int item = i;
+        while (!pool.submit(item))
+            this_thread::yield();
+        if (i % 1000 == 0)
+            this_thread::sleep_for(chrono::milliseconds(1)); // let the workers go idle now and then
+    }
+    while (pool.queued_approx() > 0)
+        this_thread::sleep_for(chrono::milliseconds(1));
+    this_thread::sleep_for(chrono::milliseconds(10));
+    pool.stop();
+    for (auto &t : threads)
+        t.join();
+
+    for (int i = 0; i < items; ++i) {
+        if (seen[i] != 1) {
+            cout << "FAILED: item " << i << " popped " << seen[i] << " times" << endl;
+            return 1;
+        }
+    }
+    if (pool.stolen() == 0) {
+        cout << "FAILED: nothing was stolen from the slow worker" << endl;
+        return 1;
+    }
+
+    cout << workers << " workers x " << items << " items, " << pool.stolen() << " stolen" << endl;
+
+    cout << "Test Finish" << endl;
+    return 0;
+}